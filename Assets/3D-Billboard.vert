@@ -9,9 +9,13 @@ out vec4 fColor;
 out vec2 fUV1;
 
 // Built-in uniforms
-uniform mat4 gViewMatrix;
-uniform mat4 gProjMatrix;
-uniform mat4 gWorldToProjMatrix;
+// Camera matrices are shared by all shaders, and are set once per camera change rather than per draw.
+layout(std140) uniform CameraUniforms
+{
+    mat4 gViewMatrix;
+    mat4 gProjMatrix;
+    mat4 gWorldToProjMatrix;
+};
 uniform mat4 gObjectToWorldMatrix;
 
 // User-defined uniforms
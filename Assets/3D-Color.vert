@@ -6,9 +6,13 @@ in vec4 vColor;
 out vec4 fColor;
 
 // Built-in uniforms
-uniform mat4 gViewMatrix;
-uniform mat4 gProjMatrix;
-uniform mat4 gWorldToProjMatrix;
+// Camera matrices are shared by all shaders, and are set once per camera change rather than per draw.
+layout(std140) uniform CameraUniforms
+{
+    mat4 gViewMatrix;
+    mat4 gProjMatrix;
+    mat4 gWorldToProjMatrix;
+};
 uniform mat4 gObjectToWorldMatrix;
 
 // User-defined uniforms
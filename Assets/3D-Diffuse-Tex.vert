@@ -1,21 +1,43 @@
 #version 150
 
 in vec3 vPos;
-in vec3 vNormal;
+in vec2 vNormal; // Octahedral encoded (see VertexCompression) - not used for lighting yet.
 in vec2 vUV1;
+in mat4 vInstanceMatrix; // Per-instance object to world matrix, only used for instanced draws.
 
 out vec4 fColor;
 out vec2 fUV1;
 
 // Built-in uniforms
-uniform mat4 gViewMatrix;
-uniform mat4 gProjMatrix;
-uniform mat4 gWorldToProjMatrix;
+// Camera matrices are shared by all shaders, and are set once per camera change rather than per draw.
+layout(std140) uniform CameraUniforms
+{
+    mat4 gViewMatrix;
+    mat4 gProjMatrix;
+    mat4 gWorldToProjMatrix;
+};
 uniform mat4 gObjectToWorldMatrix;
+uniform int gInstanced = 0;
+
+// Built-in vertex animation uniforms
+// When enabled, positions come from two keyframes in a texture buffer (three floats per position), rather than vPos.
+uniform samplerBuffer gVertexAnimation;
+uniform int gVertexAnimationEnabled = 0;
+uniform int gVertexAnimationOffset0 = 0;
+uniform int gVertexAnimationOffset1 = 0;
+uniform float gVertexAnimationBlend = 0.0f;
 
 // User-defined uniforms
 uniform vec4 uColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
 
+vec3 GetKeyframePosition(int keyframeOffset)
+{
+    int index = (keyframeOffset + gl_VertexID) * 3;
+    return vec3(texelFetch(gVertexAnimation, index).r,
+                texelFetch(gVertexAnimation, index + 1).r,
+                texelFetch(gVertexAnimation, index + 2).r);
+}
+
 void main()
 {
     // Pass through color attribute.
@@ -24,6 +46,15 @@ void main()
     // Pass through the UV attribute.
     fUV1 = vUV1;
     
+    // Get position, interpolating between vertex animation keyframes if needed.
+    vec3 position = vPos;
+    if(gVertexAnimationEnabled != 0)
+    {
+        position = mix(GetKeyframePosition(gVertexAnimationOffset0), GetKeyframePosition(gVertexAnimationOffset1), gVertexAnimationBlend);
+    }
+    
     // Transform position obj->world->view->proj
-    gl_Position = gWorldToProjMatrix * gObjectToWorldMatrix * vec4(vPos, 1.0f);
+    // Instanced draws have a different object to world matrix for each instance.
+    mat4 objectToWorldMatrix = gInstanced != 0 ? vInstanceMatrix : gObjectToWorldMatrix;
+    gl_Position = gWorldToProjMatrix * objectToWorldMatrix * vec4(position, 1.0f);
 }
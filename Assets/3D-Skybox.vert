@@ -5,7 +5,13 @@ in vec3 vPos;
 out vec3 fTexCoords;
 
 // Built-in uniforms
-uniform mat4 gWorldToProjMatrix;
+// Camera matrices are shared by all shaders, and are set once per camera change rather than per draw.
+layout(std140) uniform CameraUniforms
+{
+    mat4 gViewMatrix;
+    mat4 gProjMatrix;
+    mat4 gWorldToProjMatrix;
+};
 
 void main()
 {
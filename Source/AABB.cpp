@@ -32,6 +32,14 @@ void AABB::GrowToContain(const Vector3& point)
 	mMax.z = Math::Max(mMax.z, point.z);
 }
 
+void AABB::GrowToContain(const AABB& other)
+{
+	// Invalid (empty) boxes contain nothing, so there's nothing to grow to.
+	if(!other.IsValid()) { return; }
+	GrowToContain(other.mMin);
+	GrowToContain(other.mMax);
+}
+
 bool AABB::ContainsPoint(const Vector3& point) const
 {
 	// Point should be greater than min and less than max.
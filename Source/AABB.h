@@ -23,6 +23,7 @@ public:
 	Vector3 GetExtents() const { return ((mMax - mMin) * 0.5f); }
 	
 	void GrowToContain(const Vector3& point);
+	void GrowToContain(const AABB& other);
 	
 	bool IsValid() const { return mMin.x <= mMax.x && mMin.y <= mMax.y && mMin.z <= mMax.z; }
 	
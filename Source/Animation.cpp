@@ -5,9 +5,11 @@
 //
 #include "Animation.h"
 
+#include <algorithm>
 #include <cctype>
 
 #include "AnimationNodes.h"
+#include "GMath.h"
 #include "IniParser.h"
 #include "Services.h"
 #include "StringUtil.h"
@@ -17,13 +19,11 @@ Animation::Animation(std::string name, char* data, int dataLength) : Asset(name)
     ParseFromData(data, dataLength);
 }
 
-std::vector<AnimNode*>* Animation::GetFrame(int frameNumber)
+int Animation::GetFrameStart(int frameNumber) const
 {
-    if(mFrames.find(frameNumber) != mFrames.end())
-    {
-        return &mFrames[frameNumber];
-    }
-    return nullptr;
+	if(frameNumber <= 0) { return mFrameStarts.empty() ? 0 : mFrameStarts[0]; }
+	if(frameNumber >= mFrameStarts.size()) { return static_cast<int>(mNodes.size()); }
+	return mFrameStarts[frameNumber];
 }
 
 VertexAnimation* Animation::GetVertexAnimationOnFrameForModel(int frameNumber, const std::string& modelName)
@@ -74,9 +74,8 @@ void Animation::ParseFromData(char *data, int dataLength)
 				
 				// Create and push back the animation node. Remaining fields are optional.
                 VertexAnimNode* node = new VertexAnimNode();
-                node->frameNumber = frameNumber;
 				node->vertexAnimation = vertexAnim;
-                mFrames[frameNumber].push_back(node);
+                AddNode(frameNumber, node);
 				mVertexAnimNodes.push_back(node);
 				
 				// See if there are enough args for the (x1, y1, z1) and (angle1) values.
@@ -125,11 +124,10 @@ void Animation::ParseFromData(char *data, int dataLength)
 				
 				// Create and add the anim node.
 				SceneTextureAnimNode* node = new SceneTextureAnimNode();
-				node->frameNumber = frameNumber;
 				node->sceneName = sceneName;
 				node->sceneModelName = sceneModelName;
 				node->textureName = textureName;
-                mFrames[frameNumber].push_back(node);
+                AddNode(frameNumber, node);
             }
         }
 		// "SVisibility" changes the visibility of a scene (BSP) model.
@@ -158,7 +156,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 				node->sceneName = sceneName;
 				node->sceneModelName = sceneModelName;
 				node->visible = visible;
-                mFrames[frameNumber].push_back(node);
+                AddNode(frameNumber, node);
             }
         }
 		// "MTextures" changes textures on a model or actor.
@@ -191,7 +189,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 				node->meshIndex = static_cast<unsigned char>(meshIndex);
 				node->submeshIndex = static_cast<unsigned char>(submeshIndex);
 				node->textureName = textureName;
-				mFrames[frameNumber].push_back(node);
+				AddNode(frameNumber, node);
             }
         }
 		// "MVisibility" changes visibility on a model or actor.
@@ -216,7 +214,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 				ModelVisibilityAnimNode* node = new ModelVisibilityAnimNode();
 				node->modelName = modelName;
 				node->visible = visible;
-                mFrames[frameNumber].push_back(node);
+                AddNode(frameNumber, node);
             }
         }
 		// Triggers sounds to play on certain frames at certain locations.
@@ -245,10 +243,9 @@ void Animation::ParseFromData(char *data, int dataLength)
 				
 				// Create node here - remaining entries are optional.
 				SoundAnimNode* node = new SoundAnimNode();
-				node->frameNumber = frameNumber;
 				node->audio = Services::GetAssets()->LoadAudio(soundName);
 				node->volume = volume;
-				mFrames[frameNumber].push_back(node);
+				AddNode(frameNumber, node);
 				
 				// Below here, arguments are optional.
 				if(line.entries.size() < 4) { continue; }
@@ -337,7 +334,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					FootstepAnimNode* node = new FootstepAnimNode();
 					node->actorNoun = actorNoun;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "FOOTSCUFF"))
                 {
@@ -346,7 +343,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					FootscuffAnimNode* node = new FootscuffAnimNode();
 					node->actorNoun = actorNoun;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "STOPSOUNDTRACK"))
                 {
@@ -355,7 +352,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					StopSoundtrackAnimNode* node = new StopSoundtrackAnimNode();
 					node->soundtrackName = soundtrackName;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "PLAYSOUNDTRACK"))
                 {
@@ -364,7 +361,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					PlaySoundtrackAnimNode* node = new PlaySoundtrackAnimNode();
 					node->soundtrackName = soundtrackName;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "PLAYSOUNDTRACKTBS"))
                 {
@@ -373,12 +370,12 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					PlaySoundtrackAnimNode* node = new PlaySoundtrackAnimNode();
 					node->soundtrackName = soundtrackName;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "STOPALLSOUNDTRACKS"))
                 {
 					// Create and add node.
-					mFrames[frameNumber].push_back(new StopSoundtrackAnimNode());
+					AddNode(frameNumber, new StopSoundtrackAnimNode());
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "CAMERA"))
                 {
@@ -387,7 +384,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					CameraAnimNode* node = new CameraAnimNode();
 					node->cameraPositionName = cameraPositionName;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "LIPSYNCH"))
                 {
@@ -398,7 +395,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					LipSyncAnimNode* node = new LipSyncAnimNode();
 					node->actorNoun = actorNoun;
 					node->mouthTextureName = mouthTexName;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "FACETEX"))
                 {
@@ -435,7 +432,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					node->actorNoun = actorNoun;
 					node->textureName = textureName;
 					node->faceElement = faceElement;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "UNFACETEX"))
                 {
@@ -466,7 +463,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					UnFaceTexAnimNode* node = new UnFaceTexAnimNode();
 					node->actorNoun = actorNoun;
 					node->faceElement = faceElement;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "GLANCE"))
                 {
@@ -482,7 +479,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					GlanceAnimNode* node = new GlanceAnimNode();
 					node->actorNoun = actorNoun;
 					node->position = Vector3(x, y, z);
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
 				else if(StringUtil::EqualsIgnoreCase(keyword, "MOOD"))
 				{
@@ -496,7 +493,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					MoodAnimNode* node = new MoodAnimNode();
 					node->actorNoun = actorNoun;
 					node->moodName = moodName;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
 				}
 				else if(StringUtil::EqualsIgnoreCase(keyword, "SPEAKER"))
                 {
@@ -506,7 +503,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					SpeakerAnimNode* node = new SpeakerAnimNode();
 					node->actorNoun = actorNoun;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "CAPTION"))
                 {
@@ -516,7 +513,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					// Create and add node.
 					CaptionAnimNode* node = new CaptionAnimNode();
 					node->caption = caption;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else if(StringUtil::EqualsIgnoreCase(keyword, "SPEAKERCAPTION"))
                 {
@@ -533,7 +530,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					node->endFrame = endFrame;
 					node->actorNoun = actorNoun;
 					node->caption = caption;
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
 				else if(StringUtil::EqualsIgnoreCase(keyword, "DIALOGUECUE"))
                 {
@@ -541,7 +538,7 @@ void Animation::ParseFromData(char *data, int dataLength)
 					
                     // Create and add node.
 					DialogueCueAnimNode* node = new DialogueCueAnimNode();
-					mFrames[frameNumber].push_back(node);
+					AddNode(frameNumber, node);
                 }
                 else
                 {
@@ -554,4 +551,28 @@ void Animation::ParseFromData(char *data, int dataLength)
             std::cout << "Unexpected animation header: " << section.name << std::endl;
         }
     }
+	
+	// Sections aren't in frame order, so sort nodes by frame. Stable sort keeps nodes on the same frame in file order.
+	std::stable_sort(mNodes.begin(), mNodes.end(), [](const AnimNode* a, const AnimNode* b) {
+		return a->frameNumber < b->frameNumber;
+	});
+	
+	// Record where each frame's nodes start. Frames with no nodes start at the same index as the next frame.
+	int lastFrame = mNodes.empty() ? mFrameCount : Math::Max(mFrameCount, mNodes.back()->frameNumber);
+	mFrameStarts.resize(lastFrame + 2);
+	int nodeIndex = 0;
+	for(int i = 0; i < mFrameStarts.size(); ++i)
+	{
+		while(nodeIndex < mNodes.size() && mNodes[nodeIndex]->frameNumber < i)
+		{
+			++nodeIndex;
+		}
+		mFrameStarts[i] = nodeIndex;
+	}
+}
+
+void Animation::AddNode(int frameNumber, AnimNode* node)
+{
+	node->frameNumber = frameNumber;
+	mNodes.push_back(node);
 }
@@ -11,7 +11,6 @@
 #pragma once
 #include "Asset.h"
 
-#include <unordered_map>
 #include <vector>
 
 struct AnimNode;
@@ -23,10 +22,13 @@ class Animation : public Asset
 public:
     Animation(std::string name, char* data, int dataLength);
     
-	// Gets all anim nodes associated with a particular frame number. Null may be returned!
+	// Gets all anim nodes, sorted by frame number.
 	// Mainly used by Animator to get frame data as needed and play/sample.
-	//TODO: Might be better to move code from Animator that uses this into Animation directly.
-    std::vector<AnimNode*>* GetFrame(int frameNumber);
+	const std::vector<AnimNode*>& GetNodes() const { return mNodes; }
+	
+	// Gets index of the first anim node on or after a frame number.
+	// Nodes for frames "first" through "last" are at indexes [GetFrameStart(first), GetFrameStart(last + 1)).
+	int GetFrameStart(int frameNumber) const;
 	
 	// Just returns all vertex anim nodes! Used for stopping an animation.
 	//TODO: Again, might make sense to move code from Animator into this class.
@@ -51,13 +53,19 @@ private:
     // Default value "15" is taken from the defaults written to registry file.
     int mFramesPerSecond = 15;
     
-    // Mapping of frame number to animation nodes. Each frame can have zero, one,
+    // Animation nodes, sorted by frame number. Each frame can have zero, one,
 	// or many anim nodes representing animation events that should start on that frame.
-    std::unordered_map<int, std::vector<AnimNode*>> mFrames;
+	// Stored in one array so that playing several frames in a row walks through memory in order.
+    std::vector<AnimNode*> mNodes;
+	
+	// For each frame number, index of its first node in the node array.
+	// Has one extra entry past the last frame, so a frame's nodes always end at the next frame's start.
+	std::vector<int> mFrameStarts;
 	
 	// All vertex anim nodes in the animation.
 	// Kept separately because we sometimes need to iterate only over these.
 	std::vector<VertexAnimNode*> mVertexAnimNodes;
     
     void ParseFromData(char* data, int dataLength);
+	void AddNode(int frameNumber, AnimNode* node);
 };
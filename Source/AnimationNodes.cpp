@@ -133,7 +133,12 @@ void FootstepAnimNode::Play(AnimationState* animState)
 		std::string shoeType = "Male Leather";
 		
 		// Query the texture used on the floor where the actor is walking.
-		std::string floorTextureName = "carpet1";
+		std::string floorTextureName;
+		Texture* floorTexture = GEngine::Instance()->GetScene()->GetFloorTexture(actor->GetPosition());
+		if(floorTexture != nullptr)
+		{
+			floorTextureName = floorTexture->GetNameNoExtension();
+		}
 		
 		// Get the footstep sound.
 		Audio* footstepAudio = Services::Get<FootstepManager>()->GetFootstep(shoeType, floorTextureName);
@@ -155,7 +160,12 @@ void FootscuffAnimNode::Play(AnimationState* animState)
 		std::string shoeType = "Male Leather";
 		
 		// Query the texture used on the floor where the actor is walking.
-		std::string floorTextureName = "carpet1";
+		std::string floorTextureName;
+		Texture* floorTexture = GEngine::Instance()->GetScene()->GetFloorTexture(actor->GetPosition());
+		if(floorTexture != nullptr)
+		{
+			floorTextureName = floorTexture->GetNameNoExtension();
+		}
 		
 		// Get the scuff sound.
 		Audio* footscuffAudio = Services::Get<FootstepManager>()->GetFootscuff(shoeType, floorTextureName);
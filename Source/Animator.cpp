@@ -5,8 +5,11 @@
 //
 #include "Animator.h"
 
+#include <algorithm>
+
 #include "Animation.h"
 #include "AnimationNodes.h"
+#include "GMath.h"
 #include "Mesh.h"
 #include "MeshRenderer.h"
 #include "VertexAnimation.h"
@@ -23,13 +26,31 @@ void Animator::Start(Animation* animation, bool allowMove, bool fromGas, std::fu
 	if(animation == nullptr) { return; }
 	
 	// Create anim state for animation with appropriate "allow move" value.
-	mActiveAnimations.emplace_back(animation, finishCallback);
+	int stateIndex = static_cast<int>(mActiveAnimations.size());
+	mActiveAnimations.emplace_back(animation);
 	mActiveAnimations.back().allowMove = allowMove;
 	mActiveAnimations.back().fromGas = fromGas;
 	
+	// Store the finish callback, reusing a free slot if possible.
+	if(finishCallback)
+	{
+		int callbackIndex = static_cast<int>(mFinishCallbacks.size());
+		if(!mFreeFinishCallbackIndexes.empty())
+		{
+			callbackIndex = mFreeFinishCallbackIndexes.back();
+			mFreeFinishCallbackIndexes.pop_back();
+			mFinishCallbacks[callbackIndex] = std::move(finishCallback);
+		}
+		else
+		{
+			mFinishCallbacks.push_back(std::move(finishCallback));
+		}
+		mActiveAnimations.back().finishCallbackIndex = callbackIndex;
+	}
+	
 	// Immediately execute frame 0 of the animation.
 	// Frames execute at the BEGINNING of the time slice for that frame, so frame 0 executes at t=0.
-	ExecuteFrame(mActiveAnimations.back(), 0);
+	ExecuteFrames(stateIndex, 0, 0);
 }
 
 void Animator::Loop(Animation* animation)
@@ -37,35 +58,45 @@ void Animator::Loop(Animation* animation)
 	if(animation == nullptr) { return; }
 	
 	// Can start anim per usual, but just set loop flag after creation.
+	// Frame 0 may start other animations, so the new state isn't necessarily the last one.
+	int stateIndex = static_cast<int>(mActiveAnimations.size());
 	Start(animation, false, false, nullptr);
-	mActiveAnimations.back().loop = true;
+	mActiveAnimations[stateIndex].loop = true;
 }
 
 void Animator::Stop(Animation* animation)
 {
 	if(animation == nullptr) { return; }
 	
-	// Remove all anim states that are using the passed-in animation.
-	auto newEndIt = std::remove_if(mActiveAnimations.begin(), mActiveAnimations.end(), [animation](const AnimationState& as) -> bool {
-		if(as.animation == animation)
+	// Stop all anim states that are using the passed-in animation.
+	// This may happen in the middle of an update, so states are only marked here. They're removed at the end of the next update.
+	// Stopping a vertex animation can run callbacks that start new animations, which may reallocate "mActiveAnimations".
+	// So iterate by index, and finish with the state before stopping any vertex animations.
+	for(int i = 0; i < mActiveAnimations.size(); ++i)
+	{
+		AnimationState& animState = mActiveAnimations[i];
+		if(animState.animation != animation) { continue; }
+		int currentFrame = animState.currentFrame;
+		animState.animation = nullptr;
+		
+		// Finish callback isn't called for a stopped animation, but its slot can be reused.
+		if(animState.finishCallbackIndex >= 0)
 		{
-			// If stopping an animation, be sure to also stop any running vertex animations.
-			auto& vertexAnims = animation->GetVertexAnimNodes();
-			for(auto& vertexAnim : vertexAnims)
+			mFinishCallbacks[animState.finishCallbackIndex] = nullptr;
+			mFreeFinishCallbackIndexes.push_back(animState.finishCallbackIndex);
+			animState.finishCallbackIndex = -1;
+		}
+		
+		// If stopping an animation, be sure to also stop any running vertex animations.
+		auto& vertexAnims = animation->GetVertexAnimNodes();
+		for(auto& vertexAnim : vertexAnims)
+		{
+			if(vertexAnim->frameNumber <= currentFrame)
 			{
-				if(vertexAnim->frameNumber <= as.currentFrame)
-				{
-					vertexAnim->Stop();
-				}
+				vertexAnim->Stop();
 			}
-			return true;
 		}
-		return false;
-	});
-	
-	// "remove_if" returns iterator to new ending (all elements to be erased are after it.
-	// So...do the erase!
-	mActiveAnimations.erase(newEndIt, mActiveAnimations.end());
+	}
 }
 
 void Animator::Sample(Animation* animation, int frame)
@@ -73,24 +104,23 @@ void Animator::Sample(Animation* animation, int frame)
 	if(animation == nullptr) { return; }
 	
 	// Sample any anim nodes for the desired frame.
-	std::vector<AnimNode*>* frameData = animation->GetFrame(frame);
-	if(frameData != nullptr)
+	const std::vector<AnimNode*>& nodes = animation->GetNodes();
+	int end = animation->GetFrameStart(frame + 1);
+	for(int i = animation->GetFrameStart(frame); i < end; ++i)
 	{
-		for(auto& node : *frameData)
-		{
-			node->Sample(animation, frame);
-		}
+		nodes[i]->Sample(animation, frame);
 	}
 }
 
 void Animator::OnUpdate(float deltaTime)
 {
 	// Iterate over each active animation state and update it.
-	auto it = mActiveAnimations.begin();
-	while(it != mActiveAnimations.end())
+	// Finish callbacks or anim nodes may start new animations, which are appended and updated this frame too.
+	for(int i = 0; i < mActiveAnimations.size(); ++i)
 	{
 		// Increment animation timer.
-		AnimationState& animState = *it;
+		AnimationState& animState = mActiveAnimations[i];
+		if(animState.animation == nullptr) { continue; }
 		animState.timer += deltaTime;
 		
 		/*
@@ -108,59 +138,95 @@ void Animator::OnUpdate(float deltaTime)
 		 TODO: Does that cause problems with non-looping anims? Need to see!
 		 */
 		
-		// Based on how much time has passed, we may need to increment multiple frames of animation in one update loop.
-		// For example, if timer is 0.3, and timePerFrame is 0.1, we need to update 3 times.
+		// Based on how much time has passed, we may need to execute multiple frames of animation in one update loop.
+		// For example, if timer is 0.3, and timePerFrame is 0.1, we need to execute 3 frames.
+		// "timer" then contains how much time we are ahead of the last executed frame.
 		float timePerFrame = animState.animation->GetFrameDuration();
+		int framesToExecute = 0;
 		while(animState.timer >= timePerFrame)
 		{
-			// WE ARE EXECUTING A FRAME!
-			
-			// Decrement timer by amount for one frame.
-			// "timer" now contains how much time we are ahead of the current frame.
 			animState.timer -= timePerFrame;
-			
-			// Increment the frame.
-			// Frame 0 happens immediately on anim start. Each executed frame is then one more.
-			animState.currentFrame++;
-			
-			// If looping, wrap around the current frame when we reach the end!
-			// Note the "-1" because first and last frames are the same for a looping anim!
-			if(animState.loop)
-			{
-				animState.currentFrame %= animState.animation->GetFrameCount() - 1;
-			}
-			
-			// Execute any actions/anim nodes on the current frame.
-			ExecuteFrame(animState, animState.currentFrame);
+			++framesToExecute;
 		}
 		
-		// If the animation has ended, remove it from the active animation states.
-		if(animState.currentFrame >= animState.animation->GetFrameCount() - 1)
+		// Execute frames in runs of consecutive frame numbers, so each run is one range of anim nodes.
+		// A looping anim wraps around to frame 0, which starts a new run.
+		// Note the "-1" because first and last frames are the same for a looping anim!
+		Animation* animation = animState.animation;
+		int loopFrameCount = animation->GetFrameCount() - 1;
+		bool wrap = animState.loop && loopFrameCount > 0;
+		float timer = animState.timer;
+		while(framesToExecute > 0 && mActiveAnimations[i].animation == animation)
 		{
-			// Do the finish callback!
-			if(animState.finishCallback)
+			int firstFrame = mActiveAnimations[i].currentFrame + 1;
+			int lastFrame = firstFrame + framesToExecute - 1;
+			if(wrap)
 			{
-				animState.finishCallback();
+				firstFrame %= loopFrameCount;
+				lastFrame = Math::Min(firstFrame + framesToExecute - 1, loopFrameCount - 1);
 			}
-
-			// Erase the anim state.
-			it = mActiveAnimations.erase(it);
+			framesToExecute -= lastFrame - firstFrame + 1;
+			
+			// Later runs happen after this one, so we're further ahead of this run's last frame.
+			ExecuteFrames(i, firstFrame, lastFrame, timer + framesToExecute * timePerFrame);
 		}
-		else
+		
+		// If the animation has ended, finish it.
+		// Frames may have started other animations, so don't assume "animState" is still valid.
+		if(mActiveAnimations[i].animation == animation && mActiveAnimations[i].currentFrame >= loopFrameCount)
 		{
-			++it;
+			Finish(i);
 		}
 	}
+	
+	// Remove stopped and finished anim states.
+	auto newEndIt = std::remove_if(mActiveAnimations.begin(), mActiveAnimations.end(), [](const AnimationState& as) -> bool {
+		return as.animation == nullptr;
+	});
+	mActiveAnimations.erase(newEndIt, mActiveAnimations.end());
 }
 
-void Animator::ExecuteFrame(AnimationState& animState, int frameNumber)
+void Animator::ExecuteFrames(int stateIndex, int firstFrame, int lastFrame, float lastFrameTimer)
 {
-	std::vector<AnimNode*>* animNodes = animState.animation->GetFrame(frameNumber);
-	if(animNodes != nullptr)
+	// Execute all anim nodes from first frame through last frame. They're stored in frame order, so this is one range.
+	Animation* animation = mActiveAnimations[stateIndex].animation;
+	float timePerFrame = animation->GetFrameDuration();
+	const std::vector<AnimNode*>& nodes = animation->GetNodes();
+	int end = animation->GetFrameStart(lastFrame + 1);
+	for(int i = animation->GetFrameStart(firstFrame); i < end; ++i)
 	{
-		for(auto& node : *animNodes)
-		{
-			node->Play(&animState);
-		}
+		// Nodes may start animations (moving states in memory) or stop this one, so get the state each time.
+		AnimationState& animState = mActiveAnimations[stateIndex];
+		if(animState.animation != animation) { return; }
+		
+		// Nodes see the same frame and timer as if their frame was executed by itself.
+		animState.currentFrame = nodes[i]->frameNumber;
+		animState.timer = lastFrameTimer + (lastFrame - nodes[i]->frameNumber) * timePerFrame;
+		nodes[i]->Play(&animState);
+	}
+	
+	AnimationState& animState = mActiveAnimations[stateIndex];
+	if(animState.animation == animation)
+	{
+		animState.currentFrame = lastFrame;
+		animState.timer = lastFrameTimer;
+	}
+}
+
+void Animator::Finish(int stateIndex)
+{
+	// Mark as finished first, so the callback can't stop this animation again.
+	AnimationState& animState = mActiveAnimations[stateIndex];
+	animState.animation = nullptr;
+	
+	// Do the finish callback! Free its slot first, since the callback may start more animations.
+	int callbackIndex = animState.finishCallbackIndex;
+	if(callbackIndex >= 0)
+	{
+		animState.finishCallbackIndex = -1;
+		std::function<void()> finishCallback = std::move(mFinishCallbacks[callbackIndex]);
+		mFinishCallbacks[callbackIndex] = nullptr;
+		mFreeFinishCallbackIndexes.push_back(callbackIndex);
+		finishCallback();
 	}
 }
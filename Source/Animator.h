@@ -12,7 +12,7 @@
 #include "Component.h"
 
 #include <functional>
-#include <list>
+#include <vector>
 
 class Animation;
 class VertexAnimation;
@@ -22,10 +22,8 @@ struct AnimationState
 {
 	// Needed for "emplace" usage.
 	AnimationState(Animation* animation) : animation(animation) { }
-	AnimationState(Animation* animation, std::function<void()> finishCallback) :
-		animation(animation), finishCallback(finishCallback) { }
 	
-	// The animation that is playing.
+	// The animation that is playing. Null once the animation has stopped or finished.
 	Animation* animation = nullptr;
 	
 	// The current frame in the animation.
@@ -45,9 +43,10 @@ struct AnimationState
 	// This mainly indicates that the animation is lower-priority than other anims.
 	bool fromGas = false;
 	
-	// Callback that is executed when the animation finishes.
+	// Index of callback to execute when the animation finishes, or -1 if none.
+	// Callbacks are stored by the Animator, so states stay small and don't each hold onto a function object.
 	//TODO: What about premature stops?
-	std::function<void()> finishCallback = nullptr;
+	int finishCallbackIndex = -1;
 };
 
 class Animator : public Component
@@ -68,9 +67,15 @@ protected:
 	void OnUpdate(float deltaTime) override;
 	
 private:
-	// I chose to use a linked list here b/c we may need to remove animations that are
-	// in the middle of the list at arbitrary times...not sure if the list is big enough or we do it often enough to get benefits?
-	std::list<AnimationState> mActiveAnimations;
+	// Active animations, stored contiguously. Starting an animation (even from an anim node or callback) appends a state.
+	// Stopped or finished states are only marked (null animation) and get removed at the end of the next update.
+	// Since states can be added while executing frames, refer to them by index rather than pointer or reference.
+	std::vector<AnimationState> mActiveAnimations;
 	
-	void ExecuteFrame(AnimationState& animState, int frameNumber);
+	// Finish callbacks, referred to by index from anim states. Unused slots are reused.
+	std::vector<std::function<void()>> mFinishCallbacks;
+	std::vector<int> mFreeFinishCallbackIndexes;
+	
+	void ExecuteFrames(int stateIndex, int firstFrame, int lastFrame, float lastFrameTimer = 0.0f);
+	void Finish(int stateIndex);
 };
@@ -5,8 +5,12 @@
 //
 #include "BSP.h"
 
+#include <algorithm>
 #include <bitset>
+#include <cfloat>
+#include <climits>
 #include <iostream>
+#include <map>
 
 #include "BinaryReader.h"
 #include "BSPActor.h"
@@ -15,6 +19,7 @@
 #include "StringUtil.h"
 #include "Vector2.h"
 #include "Vector3.h"
+#include "VertexCompression.h"
 
 BSP::BSP(std::string name, char* data, int dataLength) : Asset(name)
 {
@@ -31,103 +36,57 @@ BSP::BSP(std::string name, char* data, int dataLength) : Asset(name)
 
 bool BSP::RaycastNearest(const Ray& ray, RaycastHit& outHitInfo)
 {
-	// Values for tracking closest found hit.
-    outHitInfo.t = FLT_MAX;
-    std::string* closest = nullptr;
-	
-	// Iterate through all polygons in the BSP and see if the ray intersects
-	// with any triangles inside the polygon. Triangles within the BSP are made
-	// up of "triangle fans", so the first vertex in a polygon is shared by all triangles.
-    for(auto& polygon : mPolygons)
-    {
-        BSPSurface& surface = mSurfaces[polygon.surfaceIndex];
-        if(!surface.interactive) { continue; }
-		
-        Vector3 p0 = mVertices[mVertexIndices[polygon.vertexIndexOffset]];
-        for(int i = 1; i < polygon.vertexIndexCount - 1; i++)
-        {
-            Vector3 p1 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i]];
-            Vector3 p2 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i + 1]];
-			RaycastHit hitInfo;
-			if(Collisions::TestRayTriangle(ray, p0, p1, p2, hitInfo))
-            {
-                if(hitInfo.t < outHitInfo.t)
-                {
-					// Save closest distance.
-                    outHitInfo.t = hitInfo.t;
-                    
-                    // Find surface for this polygon, and then name for the surface.
-                    closest = &mObjectNames[surface.objectIndex];
-                }
-            }
-        }
-    }
+	// Find closest triangle hit by the ray, ignoring any non-interactive surfaces.
+	int triangleIndex = -1;
+	bool hit = mBVH.RaycastNearest(ray, [this](int index) -> bool {
+		return mSurfaces[mTriangles[index].surfaceIndex].interactive;
+	}, outHitInfo, triangleIndex);
 	
 	// If no closest object was found, no hits occurred. Early out.
-	if(closest == nullptr) { return false; }
+	if(!hit) { return false; }
 	
 	// Otherwise, fill in out hit info and return.
-	outHitInfo.name = *closest;
+	outHitInfo.name = mObjectNames[mTriangles[triangleIndex].objectIndex];
 	return true;
 }
 
-bool BSP::RaycastSingle(const Ray& ray, std::string name, RaycastHit& outHitInfo)
+bool BSP::RaycastSingle(const Ray& ray, const std::string& name, RaycastHit& outHitInfo)
 {
-	for(auto& polygon : mPolygons)
-	{
-		// We're only interested in intersections with a certain object.
-		// So, if this isn't the object, we can continue!
-        BSPSurface& surface = mSurfaces[polygon.surfaceIndex];
-        if(mObjectNames[surface.objectIndex] != name) { continue; }
-        if(!surface.interactive) { continue; }
-		
-        Vector3 p0 = mVertices[mVertexIndices[polygon.vertexIndexOffset]];
-        for(int i = 1; i < polygon.vertexIndexCount - 1; i++)
-		{
-            Vector3 p1 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i]];
-            Vector3 p2 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i + 1]];
-			if(Collisions::TestRayTriangle(ray, p0, p1, p2, outHitInfo))
-			{
-				// Save name of hit object.
-				outHitInfo.name = name;
-				return true;
-			}
-		}
-	}
+	// Couldn't find the given name, so can't possibly hit it.
+	int objectIndex = GetObjectIndex(name);
+	if(objectIndex == -1) { return false; }
 	
-	// Couldn't find the given name, or ray didn't intersect object with given name.
-	return false;
+	// We're only interested in intersections with a certain object, so any hit on that object will do.
+	int triangleIndex = -1;
+	bool hit = mBVH.RaycastAny(ray, [this, objectIndex](int index) -> bool {
+		const BSPTriangle& triangle = mTriangles[index];
+		return triangle.objectIndex == objectIndex && mSurfaces[triangle.surfaceIndex].interactive;
+	}, outHitInfo, triangleIndex);
+	
+	// Ray didn't intersect object with given name.
+	if(!hit) { return false; }
+	
+	// Save name of hit object.
+	outHitInfo.name = name;
+	return true;
 }
 
-std::vector<RaycastHit> BSP::RaycastAll(const Ray& ray)
+std::vector<BSPRaycastHit> BSP::RaycastAll(const Ray& ray)
 {
-	std::vector<RaycastHit> hits;
+	std::vector<BSPRaycastHit> hits;
+	
+	// Collect all hits against interactive surfaces.
+	// Hits only save surface/object indexes - caller can use GetObjectName if a name is needed.
+	mBVH.RaycastAll(ray, [this](int index) -> bool {
+		return mSurfaces[mTriangles[index].surfaceIndex].interactive;
+	}, [this, &hits](int index, float t) {
+		BSPRaycastHit hitInfo;
+		hitInfo.t = t;
+		hitInfo.surfaceIndex = mTriangles[index].surfaceIndex;
+		hitInfo.objectIndex = mTriangles[index].objectIndex;
+		hits.push_back(hitInfo);
+	});
 	
-	// Iterate through all polygons in the BSP and see if the ray intersects
-	// with any triangles inside the polygon. Triangles within the BSP are made
-	// up of "triangle fans", so the first vertex in a polygon is shared by all triangles.
-	for(auto& polygon : mPolygons)
-	{
-        BSPSurface& surface = mSurfaces[polygon.surfaceIndex];
-        if(!surface.interactive) { continue; }
-		
-        Vector3 p0 = mVertices[mVertexIndices[polygon.vertexIndexOffset]];
-        for(int i = 1; i < polygon.vertexIndexCount - 1; i++)
-		{
-            Vector3 p1 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i]];
-            Vector3 p2 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i + 1]];
-			RaycastHit hitInfo;
-			if(Collisions::TestRayTriangle(ray, p0, p1, p2, hitInfo))
-			{
-				// Save hit object name.
-                hitInfo.name = mObjectNames[surface.objectIndex];
-				
-				// Add to hit info vector.
-				hits.push_back(hitInfo);
-			}
-		}
-	}
-
 	// Return vector of hits.
 	return hits;
 }
@@ -150,196 +109,127 @@ bool BSP::RaycastPolygon(const Ray& ray, const BSPPolygon* polygon, RaycastHit&
 BSPActor* BSP::CreateBSPActor(const std::string& objectName)
 {
 	// Find index for object name or fail.
-	int objectIndex = -1;
-	for(int i = 0; i < mObjectNames.size(); i++)
-	{
-		if(StringUtil::EqualsIgnoreCase(mObjectNames[i], objectName))
-		{
-			objectIndex = i;
-			break;
-		}
-	}
+	int objectIndex = GetObjectIndex(objectName);
 	if(objectIndex == -1) { return nullptr; }
 	
 	// OK, we found it! Create the actor.
 	BSPActor* actor = new BSPActor(this, objectName);
 	
-	// Generate AABB from this BSP object's position data.
-	bool firstPoint = true;
-	AABB aabb;
-	for(int surfaceIndex = 0; surfaceIndex < mSurfaces.size(); surfaceIndex++)
+	// Add all surfaces and polygons belonging to this object.
+	const ObjectInfo& objectInfo = mObjectInfos[objectIndex];
+	for(unsigned short surfaceIndex : objectInfo.surfaceIndexes)
 	{
-        if(mSurfaces[surfaceIndex].objectIndex == objectIndex)
+		actor->AddSurface(&mSurfaces[surfaceIndex]);
+		
+		const PolygonRange& range = mSurfacePolygonRanges[surfaceIndex];
+		for(int i = range.offset; i < range.offset + range.count; i++)
 		{
-			actor->AddSurface(&mSurfaces[surfaceIndex]);
-			
-			for(int polygonIndex = 0; polygonIndex < mPolygons.size(); polygonIndex++)
-			{
-                if(mPolygons[polygonIndex].surfaceIndex == surfaceIndex)
-				{
-					actor->AddPolygon(&mPolygons[polygonIndex]);
-					
-                    int start = mPolygons[polygonIndex].vertexIndexOffset;
-                    int end = start + mPolygons[polygonIndex].vertexIndexCount;
-					for(int k = start; k < end; k++)
-					{
-						if(firstPoint)
-						{
-							aabb = AABB(mVertices[mVertexIndices[k]], mVertices[mVertexIndices[k]]);
-							firstPoint = false;
-						}
-						else
-						{
-							aabb.GrowToContain(mVertices[mVertexIndices[k]]);
-						}
-					}
-				}
-			}
+			actor->AddPolygon(&mPolygons[mSurfacePolygonIndexes[i]]);
 		}
 	}
-	actor->SetAABB(aabb);
+	actor->SetAABB(objectInfo.aabb);
 	
 	// Position actor at center of BSP object position.
-	actor->SetPosition(GetPosition(objectName));
+	actor->SetPosition(objectInfo.center);
 	return actor;
 }
 
-void BSP::SetVisible(std::string objectName, bool visible)
+void BSP::SetVisible(const std::string& objectName, bool visible)
 {
-	// Find index of the object name.
-	int index = -1;
-	for(int i = 0; i < mObjectNames.size(); i++)
-	{
-		if(StringUtil::EqualsIgnoreCase(mObjectNames[i], objectName))
-		{
-			index = i;
-			break;
-		}
-	}
-	
 	// Can't hide an object if the passed name isn't present.
-	if(index == -1) { return; }
+	int objectIndex = GetObjectIndex(objectName);
+	if(objectIndex == -1) { return; }
 	
 	// All surfaces belonging to this object will be hidden.
-	for(auto& surface : mSurfaces)
+	for(unsigned short surfaceIndex : mObjectInfos[objectIndex].surfaceIndexes)
 	{
-        if(surface.objectIndex == index)
-		{
-            surface.visible = visible;
-		}
+		mSurfaces[surfaceIndex].visible = visible;
 	}
+	
+	// Visible set may have changed.
+	mVisibleSetCacheValid = false;
 }
 
-void BSP::SetTexture(std::string objectName, Texture* texture)
+void BSP::SetTexture(const std::string& objectName, Texture* texture)
 {
-	// Find index of the object name.
-	int index = -1;
-	for(int i = 0; i < mObjectNames.size(); i++)
-	{
-		if(StringUtil::EqualsIgnoreCase(mObjectNames[i], objectName))
-		{
-			index = i;
-			break;
-		}
-	}
-	
-	// Can't hide an object if the passed name isn't present.
-	if(index == -1) { return; }
+	// Can't change texture of an object if the passed name isn't present.
+	int objectIndex = GetObjectIndex(objectName);
+	if(objectIndex == -1) { return; }
 	
-	// All surfaces belonging to this object will be hidden.
-	for(auto& surface : mSurfaces)
+	// All surfaces belonging to this object will use the texture.
+	// Scripts may set the same texture repeatedly, so only a real change affects batches.
+	for(unsigned short surfaceIndex : mObjectInfos[objectIndex].surfaceIndexes)
 	{
-        if(surface.objectIndex == index)
+		if(mSurfaces[surfaceIndex].texture != texture)
 		{
-            surface.texture = texture;
+			mSurfaces[surfaceIndex].texture = texture;
+			mBatchesDirty = true;
 		}
 	}
 }
 
-bool BSP::Exists(std::string objectName) const
+bool BSP::Exists(const std::string& objectName) const
 {
-	for(int i = 0; i < mObjectNames.size(); i++)
-	{
-		if(StringUtil::EqualsIgnoreCase(mObjectNames[i], objectName))
-		{
-			return true;
-		}
-	}
-	return false;
+	return GetObjectIndex(objectName) != -1;
 }
 
-bool BSP::IsVisible(std::string objectName) const
+bool BSP::IsVisible(const std::string& objectName) const
 {
-	// Find index of the object name.
-	int index = -1;
-	for(int i = 0; i < mObjectNames.size(); i++)
-	{
-		if(StringUtil::EqualsIgnoreCase(mObjectNames[i], objectName))
-		{
-			index = i;
-			break;
-		}
-	}
-	
 	// If can't find object name, it's certainly not visible...
-	if(index == -1) { return false; }
-	
-	// Find any surface belonging to this object and see if it is visible.
-	for(auto& surface : mSurfaces)
-	{
-        if(surface.objectIndex == index)
-		{
-            return surface.visible;
-		}
-	}
+	int objectIndex = GetObjectIndex(objectName);
+	if(objectIndex == -1) { return false; }
 	
 	// Worst case, no surfaces belong to this object. Must not be visible then!
-	return false;
+	const std::vector<unsigned short>& surfaceIndexes = mObjectInfos[objectIndex].surfaceIndexes;
+	if(surfaceIndexes.empty()) { return false; }
+	
+	// Otherwise, see if the first surface belonging to this object is visible.
+	return mSurfaces[surfaceIndexes[0]].visible;
 }
 
 Vector3 BSP::GetPosition(const std::string& objectName) const
 {
-	// Find index of the object name.
-	int objectIndex = -1;
-	for(int i = 0; i < mObjectNames.size(); i++)
-	{
-		if(StringUtil::EqualsIgnoreCase(mObjectNames[i], objectName))
-		{
-			objectIndex = i;
-			break;
-		}
-	}
-	
 	// Couldn't find object!
 	//TODO: Maybe we should return true/false with an out parameter?
+	int objectIndex = GetObjectIndex(objectName);
 	if(objectIndex == -1) { return Vector3::Zero; }
 	
-	// Find index of a surface.
-	Vector3 pos = Vector3::Zero;
-	int vertexCount = 0;
-	for(int i = 0; i < mSurfaces.size(); i++)
+	// Average position is calculated at load time.
+	return mObjectInfos[objectIndex].center;
+}
+
+int BSP::GetObjectIndex(const std::string& objectName) const
+{
+    auto it = mObjectIndexesByName.find(objectName);
+    if(it != mObjectIndexesByName.end())
+    {
+        return it->second;
+    }
+    return -1;
+}
+
+void BSP::GetObjectTriangles(const std::string& objectName, std::vector<Triangle>& outTriangles, std::vector<int>& outSurfaceIndexes) const
+{
+	int objectIndex = GetObjectIndex(objectName);
+	if(objectIndex == -1) { return; }
+	
+	// Convert each polygon (a triangle fan) of each surface of the object into triangles.
+	for(unsigned short surfaceIndex : mObjectInfos[objectIndex].surfaceIndexes)
 	{
-        if(mSurfaces[i].objectIndex == objectIndex)
+		const PolygonRange& range = mSurfacePolygonRanges[surfaceIndex];
+		for(int i = range.offset; i < range.offset + range.count; i++)
 		{
-			for(int j = 0; j < mPolygons.size(); j++)
+			const BSPPolygon& polygon = mPolygons[mSurfacePolygonIndexes[i]];
+			const Vector3& p0 = mVertices[mVertexIndices[polygon.vertexIndexOffset]];
+			for(int j = 1; j < polygon.vertexIndexCount - 1; j++)
 			{
-                if(mPolygons[j].surfaceIndex == i)
-				{
-                    int start = mPolygons[j].vertexIndexOffset;
-                    int end = start + mPolygons[j].vertexIndexCount;
-					
-					for(int k = start; k < end; k++)
-					{
-						pos += mVertices[mVertexIndices[k]];
-						vertexCount++;
-					}
-				}
+				const Vector3& p1 = mVertices[mVertexIndices[polygon.vertexIndexOffset + j]];
+				const Vector3& p2 = mVertices[mVertexIndices[polygon.vertexIndexOffset + j + 1]];
+				outTriangles.emplace_back(p0, p1, p2);
+				outSurfaceIndexes.push_back(surfaceIndex);
 			}
 		}
 	}
-	
-	// Get average position.
-	return pos / vertexCount;
 }
 
 void BSP::ApplyLightmap(const BSPLightmap& lightmap)
@@ -349,48 +239,139 @@ void BSP::ApplyLightmap(const BSPLightmap& lightmap)
     {
         mSurfaces[i].lightmapTexture = lightmapTextures[i];
     }
+    
+    // Lightmap change may move surfaces to a different batch.
+    mBatchesDirty = true;
 }
 
-// For debugging BSP issues, helpful to track polygons rendered and tree depth.
-int renderedPolygonCount = 0;
-int treeDepth = 0;
-
-void BSP::RenderOpaque(const Vector3& cameraPosition, const Vector3& cameraDirection)
+void BSP::RenderOpaque(const Vector3& cameraPosition, const Frustum& frustum)
 {
+    // Texture/lightmap changes since the last render may move surfaces to different batches.
+    // Batches are only rebuilt here, so any number of changes in a frame costs one rebuild.
+    if(mBatchesDirty)
+    {
+        RefreshBatches();
+    }
+    
     // Activate material for rendering.
-    mMaterial.Activate(Matrix4::Identity);
+    mMaterial.Activate(mPositionDecodeMatrix);
+    
+    // Some debug keys to visualize what polygons are in each set.
+    // Only need to check these once per frame, not once per node.
+    bool hidePolygons1 = Services::GetInput()->IsKeyPressed(SDL_SCANCODE_Y);
+    bool hidePolygons2 = Services::GetInput()->IsKeyPressed(SDL_SCANCODE_U);
+    
+    // Most of the time, the camera doesn't move. If nothing has changed since the last frame, the visible set and draw order are the same.
+    // In that case, we can skip traversal (and rebuilding the index data) entirely.
+    bool useCache = mVisibleSetCacheValid &&
+                    cameraPosition == mCachedCameraPosition &&
+                    frustum == mCachedFrustum &&
+                    hidePolygons1 == mHidePolygons1 &&
+                    hidePolygons2 == mHidePolygons2;
+    if(useCache)
+    {
+        // Keep stats from the traversal that generated the cached set - only batches rendered are counted again.
+        mRenderStats.batchesRendered = 0;
+        ++mRenderStats.cachedFrames;
+    }
+    else
+    {
+        // Reset render stat values.
+        mRenderStats = BSPRenderStats();
+        
+        // Traverse the tree to gather visible polygons, and then group them in batches.
+        mHidePolygons1 = hidePolygons1;
+        mHidePolygons2 = hidePolygons2;
+        mVisiblePolygons.clear();
+        if(mRootNodeIndex < mNodes.size())
+        {
+            RenderTree(mRootNodeIndex, cameraPosition, frustum, Frustum::kAllPlanes);
+        }
+        BuildBatchIndexes(mVisiblePolygons);
+        
+        // Save cache key for next frame.
+        mCachedCameraPosition = cameraPosition;
+        mCachedFrustum = frustum;
+        mVisibleSetCacheValid = true;
+        mFrameIndexesUploaded = false;
+    }
     
-    // Reset render stat values.
-    renderedPolygonCount = 0;
-    treeDepth = 0;
+    // Upload indexes, if not already present in the index buffer.
+    if(!mFrameIndexesUploaded && !mFrameIndexes.empty())
+    {
+        mVertexArray.ChangeIndexData(&mFrameIndexes[0], static_cast<unsigned int>(mFrameIndexes.size()));
+        mFrameIndexesUploaded = true;
+    }
     
+    // Draw each batch with one draw call.
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    RenderTree(mNodes[mRootNodeIndex], cameraPosition, cameraDirection);
+    for(int i = 0; i < mBatchIndexRanges.size(); i++)
+    {
+        if(mBatchIndexRanges[i].count > 0)
+        {
+            DrawBatch(i, mBatchIndexRanges[i].offset, mBatchIndexRanges[i].count);
+        }
+    }
     //glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    
-    //std::cout << "Rendered " << renderedPolygonCount << " polygons." << std::endl;
 }
 
 void BSP::RenderTranslucent()
 {
+    // Translucent polygons must be drawn in order, so we can't group them by batch like opaque polygons.
+    // But consecutive polygons with the same texture/lightmap can still be drawn together.
+    std::vector<int> runBatchIndexes;
+    std::vector<PolygonRange> runIndexRanges;
+    mTranslucentIndexes.clear();
+    
     BSPPolygon* polygon = mAlphaPolygons;
     while(polygon != nullptr)
     {
-        RenderPolygon(*polygon, true);
+        int polygonIndex = static_cast<int>(polygon - &mPolygons[0]);
+        int batchIndex = mSurfaceBatchIndexes[polygon->surfaceIndex];
+        if(runBatchIndexes.empty() || runBatchIndexes.back() != batchIndex)
+        {
+            PolygonRange run;
+            run.offset = static_cast<int>(mTranslucentIndexes.size());
+            runIndexRanges.push_back(run);
+            runBatchIndexes.push_back(batchIndex);
+        }
+        
+        const PolygonRange& triangleRange = mPolygonTriangleRanges[polygonIndex];
+        mTranslucentIndexes.insert(mTranslucentIndexes.end(),
+                                   mPolygonTriangleIndexes.begin() + triangleRange.offset,
+                                   mPolygonTriangleIndexes.begin() + triangleRange.offset + triangleRange.count);
+        runIndexRanges.back().count += triangleRange.count;
         polygon = polygon->next;
     }
     mAlphaPolygons = nullptr;
+    if(mTranslucentIndexes.empty()) { return; }
+    
+    // Upload indexes and draw each run. This replaces the opaque indexes in the index buffer.
+    mVertexArray.ChangeIndexData(&mTranslucentIndexes[0], static_cast<unsigned int>(mTranslucentIndexes.size()));
+    mFrameIndexesUploaded = false;
+    for(int i = 0; i < runBatchIndexes.size(); i++)
+    {
+        DrawBatch(runBatchIndexes[i], runIndexRanges[i].offset, runIndexRanges[i].count);
+    }
 }
 
-void BSP::RenderTree(const BSPNode& node, const Vector3& cameraPosition, const Vector3& cameraDirection)
+void BSP::RenderTree(int nodeIndex, const Vector3& cameraPosition, const Frustum& frustum, unsigned int planeMask)
 {
+    ++mRenderStats.nodesVisited;
+    
+    // Node bounds contain all polygons of this node and its children.
+    // If the bounds are outside the view frustum, nothing in this part of the tree can be seen.
+    // Once bounds are fully inside a frustum plane, child nodes needn't test against that plane (it's removed from the mask).
+    if(planeMask != 0 && !frustum.IntersectsAABB(mNodeBounds[nodeIndex], planeMask))
+    {
+        ++mRenderStats.nodesCulled;
+        return;
+    }
+    
     // Check signed distance of point to plane to determine if point is in front of, behind, or on the plane.
+    const BSPNode& node = mNodes[nodeIndex];
     float signedDistance = mPlanes[node.planeIndex].GetSignedDistance(cameraPosition);
     
-    // Based on camera position/facing direction, we can sometimes avoid rendering entire parts of the BSP tree.
-    //TODO: Maybe base this on the camera's FOV rather than hardcoding?
-    const float kCameraFacingDot = 0.9f;
-    
     // Determine render order for this node.
     // This makes a "front-to-back" renderer, resulting in no overdraw for opaque rendering.
     bool renderCurrent = true;
@@ -408,70 +389,42 @@ void BSP::RenderTree(const BSPNode& node, const Vector3& cameraPosition, const V
         // Point is in front of plane - render front, then back trees.
         firstNodeIndex = node.frontChildIndex;
         secondNodeIndex = node.backChildIndex;
-        
-        // If in front of plane AND facing away from plane, there's no need to render the back at all.
-        float dot = Vector3::Dot(mPlanes[node.planeIndex].normal, cameraDirection);
-        if(dot > kCameraFacingDot)
-        {
-            secondNodeIndex = -1;
-        }
     }
     else
     {
         // Point is behind plane - render back, then front trees.
         firstNodeIndex = node.backChildIndex;
         secondNodeIndex = node.frontChildIndex;
-        
-        // If behind plane AND facing away from plane, there's no need to render the front at all.
-        float dot = Vector3::Dot(mPlanes[node.planeIndex].normal, cameraDirection);
-        if(dot < -kCameraFacingDot)
-        {
-            secondNodeIndex = -1;
-        }
     }
     
     // Render first tree.
     if(firstNodeIndex >= 0 && firstNodeIndex < mNodes.size())
     {
-        ++treeDepth;
-        RenderTree(mNodes[firstNodeIndex], cameraPosition, cameraDirection);
-        --treeDepth;
+        RenderTree(firstNodeIndex, cameraPosition, frustum, planeMask);
     }
     
     // Render current, maybe (probably).
     if(renderCurrent)
     {
         // Determine whether polygon sets 1 & 2 are present.
-        bool hasPolygon1 = node.polygonIndex != 65535 && node.polygonCount > 0;
-        bool hasPolygon2 = node.polygonIndex2 != 65535 && node.polygonCount2 > 0;
-        
-        // Some debug keys to visualize what polygons are in each set.
-        if(Services::GetInput()->IsKeyPressed(SDL_SCANCODE_Y))
-        {
-            hasPolygon1 = false;
-        }
-        if(Services::GetInput()->IsKeyPressed(SDL_SCANCODE_U))
-        {
-            hasPolygon2 = false;
-        }
+        bool hasPolygon1 = !mHidePolygons1 && node.polygonIndex != 65535 && node.polygonCount > 0;
+        bool hasPolygon2 = !mHidePolygons2 && node.polygonIndex2 != 65535 && node.polygonCount2 > 0;
         
-        // Render first set of polygons.
+        // Gather first set of polygons.
         if(hasPolygon1)
         {
             for(int i = node.polygonIndex; i < node.polygonIndex + node.polygonCount; i++)
             {
-                RenderPolygon(mPolygons[i], false);
-                ++renderedPolygonCount;
+                GatherPolygon(i, frustum, planeMask);
             }
         }
         
-        // Render second set of polygons.
+        // Gather second set of polygons.
         if(hasPolygon2)
         {
             for(int i = node.polygonIndex2; i < node.polygonIndex2 + node.polygonCount2; i++)
             {
-                RenderPolygon(mPolygons[i], false);
-                ++renderedPolygonCount;
+                GatherPolygon(i, frustum, planeMask);
             }
         }
     }
@@ -479,61 +432,82 @@ void BSP::RenderTree(const BSPNode& node, const Vector3& cameraPosition, const V
     // Render second tree.
     if(secondNodeIndex >= 0 && secondNodeIndex < mNodes.size())
     {
-        ++treeDepth;
-        RenderTree(mNodes[secondNodeIndex], cameraPosition, cameraDirection);
-        --treeDepth;
+        RenderTree(secondNodeIndex, cameraPosition, frustum, planeMask);
     }
 }
 
-void BSP::RenderPolygon(BSPPolygon& polygon, bool translucent)
+void BSP::GatherPolygon(int polygonIndex, const Frustum& frustum, unsigned int planeMask)
 {
-    // If we have a valid surface reference, use it to get rendering configured.
-    BSPSurface& surface = mSurfaces[polygon.surfaceIndex];
+    ++mRenderStats.polygonsVisited;
     
-    // Not going to render non-visible surfaces.
-    if(!surface.visible) { return; }
-		
-    // Retrieve texture and activate it, if possible.
-    Texture* tex = surface.texture;
-    if(tex != nullptr)
+    // Non-visible surfaces aren't rendered.
+    if(!mSurfaces[mPolygons[polygonIndex].surfaceIndex].visible) { return; }
+    
+    // If the node was only partially in the frustum, the polygon itself may be outside of it.
+    if(planeMask != 0 && !frustum.IntersectsAABB(mPolygonBounds[polygonIndex], planeMask))
     {
-        // If has alpha, don't render it now, but add it to the alpha chain.
-        if(tex->GetRenderType() == Texture::RenderType::Translucent && translucent)
-        {
-            polygon.next = mAlphaPolygons;
-            mAlphaPolygons = &polygon;
-            return;
-        }
-        tex->Activate(0);
+        ++mRenderStats.polygonsCulled;
+        return;
     }
-    else
+    
+    mVisiblePolygons.push_back(polygonIndex);
+    ++mRenderStats.polygonsRendered;
+}
+
+void BSP::BuildBatchIndexes(const std::vector<unsigned short>& polygonIndexes)
+{
+    // Count indexes needed for each batch.
+    mBatchIndexRanges.assign(mBatches.size(), PolygonRange());
+    for(unsigned short polygonIndex : polygonIndexes)
     {
-        Texture::Deactivate();
+        int batchIndex = mSurfaceBatchIndexes[mPolygons[polygonIndex].surfaceIndex];
+        mBatchIndexRanges[batchIndex].count += mPolygonTriangleRanges[polygonIndex].count;
     }
-     
-    // Activate lightmap texture, if any.
-    Texture* lightmapTex = surface.lightmapTexture;
-    if(lightmapTex != nullptr)
+    
+    // Convert counts to offsets, so each batch's indexes are contiguous.
+    int indexCount = 0;
+    for(auto& range : mBatchIndexRanges)
     {
-        lightmapTex->Activate(1);
+        range.offset = indexCount;
+        indexCount += range.count;
+        range.count = 0;
     }
     
-    // Lightmap scale/offsets are used in shaders to calculate proper lightmap UVs.
-    Vector4 lightmapUvScaleOffset(surface.lightmapUvScale.x,
-                          surface.lightmapUvScale.y,
-                          surface.lightmapUvOffset.x,
-                          surface.lightmapUvOffset.y);
-    mMaterial.GetShader()->SetUniformVector4("uLightmapScaleOffset", lightmapUvScaleOffset);
-    
-    /*
-    if((surface.flags & BSPSurface::kUnknownFlag7) != 0)
+    // Copy each polygon's triangles into its batch. Within a batch, polygons stay in front-to-back order.
+    mFrameIndexes.resize(indexCount);
+    for(unsigned short polygonIndex : polygonIndexes)
     {
-        Debug::DrawLine(Vector3::Zero, mVertices[mVertexIndices[polygon.vertexIndexOffset]], Color32::Magenta);
+        PolygonRange& batchRange = mBatchIndexRanges[mSurfaceBatchIndexes[mPolygons[polygonIndex].surfaceIndex]];
+        const PolygonRange& triangleRange = mPolygonTriangleRanges[polygonIndex];
+        std::copy(mPolygonTriangleIndexes.begin() + triangleRange.offset,
+                  mPolygonTriangleIndexes.begin() + triangleRange.offset + triangleRange.count,
+                  mFrameIndexes.begin() + batchRange.offset + batchRange.count);
+        batchRange.count += triangleRange.count;
     }
-    */
+}
 
-    // Draw the polygon.
-    mVertexArray.DrawTriangleFans(polygon.vertexIndexOffset, polygon.vertexIndexCount);
+void BSP::DrawBatch(int batchIndex, int indexOffset, int indexCount)
+{
+    // Activate texture, if possible.
+    const Batch& batch = mBatches[batchIndex];
+    if(batch.texture != nullptr)
+    {
+        batch.texture->Activate(0);
+    }
+    else
+    {
+        Texture::Deactivate();
+    }
+    
+    // Activate lightmap texture, if any.
+    if(batch.lightmapTexture != nullptr)
+    {
+        batch.lightmapTexture->Activate(1);
+    }
+    
+    // Draw the batch's triangles.
+    mVertexArray.DrawTriangles(indexOffset, indexCount);
+    ++mRenderStats.batchesRendered;
 }
 
 void BSP::ParseFromData(char *data, int dataLength)
@@ -715,24 +689,332 @@ void BSP::ParseFromData(char *data, int dataLength)
     }
     */
     
-    // Generate mesh definition.
-    MeshDefinition meshDefinition;
-    meshDefinition.meshUsage = MeshUsage::Static;
+    // Create render data (vertex array, batches).
+    BuildRenderData();
     
-    meshDefinition.vertexDefinition.layout = VertexDefinition::Layout::Packed;
-    meshDefinition.vertexDefinition.attributes.push_back(VertexAttribute::Position);
-    meshDefinition.vertexDefinition.attributes.push_back(VertexAttribute::UV1);
+    // Build lookup tables and acceleration structure for raycasts.
+    BuildLookupTables();
+    BuildBVH();
     
-    meshDefinition.vertexCount = static_cast<int>(mVertices.size());
+    // Build bounds for culling during rendering.
+    BuildBounds();
+}
+
+void BSP::BuildLookupTables()
+{
+    // Map object names to indexes. If a name appears more than once, the first one wins (same as a linear search would).
+    mObjectIndexesByName.clear();
+    for(int i = 0; i < mObjectNames.size(); i++)
+    {
+        mObjectIndexesByName.emplace(mObjectNames[i], i);
+    }
     
-    std::vector<float*> vertexData;
-    vertexData.push_back(reinterpret_cast<float*>(&mVertices[0]));
-    vertexData.push_back(reinterpret_cast<float*>(&mUVs[0]));
+    // Sort polygon indexes by surface, so each surface's polygons are a contiguous range.
+    // Counting sort: count polygons per surface, convert counts to offsets, and then place polygons.
+    mSurfacePolygonRanges.assign(mSurfaces.size(), PolygonRange());
+    for(auto& polygon : mPolygons)
+    {
+        ++mSurfacePolygonRanges[polygon.surfaceIndex].count;
+    }
+    int offset = 0;
+    for(auto& range : mSurfacePolygonRanges)
+    {
+        range.offset = offset;
+        offset += range.count;
+    }
+    mSurfacePolygonIndexes.resize(mPolygons.size());
+    std::vector<int> placedCounts(mSurfaces.size(), 0);
+    for(int i = 0; i < mPolygons.size(); i++)
+    {
+        unsigned short surfaceIndex = mPolygons[i].surfaceIndex;
+        mSurfacePolygonIndexes[mSurfacePolygonRanges[surfaceIndex].offset + placedCounts[surfaceIndex]] = i;
+        ++placedCounts[surfaceIndex];
+    }
+    
+    // Gather surfaces for each object.
+    mObjectInfos.clear();
+    mObjectInfos.resize(mObjectNames.size());
+    for(int i = 0; i < mSurfaces.size(); i++)
+    {
+        mObjectInfos[mSurfaces[i].objectIndex].surfaceIndexes.push_back(i);
+    }
+    
+    // Calculate center and bounds of each object from its vertices.
+    for(auto& objectInfo : mObjectInfos)
+    {
+        Vector3 sum = Vector3::Zero;
+        int vertexCount = 0;
+        for(unsigned short surfaceIndex : objectInfo.surfaceIndexes)
+        {
+            const PolygonRange& range = mSurfacePolygonRanges[surfaceIndex];
+            for(int i = range.offset; i < range.offset + range.count; i++)
+            {
+                const BSPPolygon& polygon = mPolygons[mSurfacePolygonIndexes[i]];
+                int start = polygon.vertexIndexOffset;
+                int end = start + polygon.vertexIndexCount;
+                for(int k = start; k < end; k++)
+                {
+                    const Vector3& vertex = mVertices[mVertexIndices[k]];
+                    if(vertexCount == 0)
+                    {
+                        objectInfo.aabb = AABB(vertex, vertex);
+                    }
+                    else
+                    {
+                        objectInfo.aabb.GrowToContain(vertex);
+                    }
+                    sum += vertex;
+                    vertexCount++;
+                }
+            }
+        }
+        
+        // Center is average position of all vertices.
+        if(vertexCount > 0)
+        {
+            objectInfo.center = sum / vertexCount;
+        }
+    }
+}
+
+void BSP::BuildBVH()
+{
+    // Triangles within the BSP are made up of "triangle fans", so the first vertex in a polygon is shared by all triangles.
+    std::vector<Triangle> triangles;
+    mTriangles.clear();
+    for(auto& polygon : mPolygons)
+    {
+        BSPTriangle triangleInfo;
+        triangleInfo.surfaceIndex = polygon.surfaceIndex;
+        triangleInfo.objectIndex = mSurfaces[polygon.surfaceIndex].objectIndex;
+        
+        const Vector3& p0 = mVertices[mVertexIndices[polygon.vertexIndexOffset]];
+        for(int i = 1; i < polygon.vertexIndexCount - 1; i++)
+        {
+            const Vector3& p1 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i]];
+            const Vector3& p2 = mVertices[mVertexIndices[polygon.vertexIndexOffset + i + 1]];
+            triangles.emplace_back(p0, p1, p2);
+            mTriangles.push_back(triangleInfo);
+        }
+    }
+    mBVH.Build(triangles);
+}
+
+void BSP::BuildRenderData()
+{
+    // Polygons are stored as triangle fans, and vertices may be shared by polygons on different surfaces.
+    // To draw many surfaces in one draw call, each vertex must carry its surface's lightmap UV, rather than setting it per surface.
+    // So, we create one render vertex per unique vertex/surface pair, with the lightmap UV offset/scale pre-applied.
+    std::vector<Vector3> positions;
+    std::vector<Vector2> uvs;
+    std::vector<Vector2> lightmapUvs;
+    std::unordered_map<unsigned int, unsigned short> renderVertexIndexes;
+    
+    // Visit polygons grouped by surface. A surface's render vertices and triangles then end up next to one another,
+    // so drawing a batch reads compact ranges of the vertex buffer, rather than jumping all over it.
+    std::vector<int> polygonOrder(mPolygons.size());
+    for(int i = 0; i < mPolygons.size(); i++)
+    {
+        polygonOrder[i] = i;
+    }
+    std::stable_sort(polygonOrder.begin(), polygonOrder.end(), [this](int a, int b) {
+        return mPolygons[a].surfaceIndex < mPolygons[b].surfaceIndex;
+    });
+    
+    // Convert each polygon's triangle fan to a triangle list that uses render vertices.
+    mPolygonTriangleIndexes.clear();
+    mPolygonTriangleRanges.assign(mPolygons.size(), PolygonRange());
+    std::vector<unsigned short> polygonVertexIndexes;
+    for(int i : polygonOrder)
+    {
+        const BSPPolygon& polygon = mPolygons[i];
+        const BSPSurface& surface = mSurfaces[polygon.surfaceIndex];
+        
+        polygonVertexIndexes.clear();
+        for(int k = polygon.vertexIndexOffset; k < polygon.vertexIndexOffset + polygon.vertexIndexCount; k++)
+        {
+            // Surface and vertex indexes are both 16-bit, so together they make a unique 32-bit key.
+            unsigned short vertexIndex = mVertexIndices[k];
+            unsigned int key = (static_cast<unsigned int>(polygon.surfaceIndex) << 16) | vertexIndex;
+            auto it = renderVertexIndexes.find(key);
+            if(it == renderVertexIndexes.end())
+            {
+                // Render vertex count can't exceed the original index count, which is already limited to 16-bit offsets.
+                // But just in case, don't generate indexes that would wrap around.
+                if(positions.size() > USHRT_MAX)
+                {
+                    std::cout << "BSP has too many render vertices!" << std::endl;
+                    break;
+                }
+                it = renderVertexIndexes.emplace(key, static_cast<unsigned short>(positions.size())).first;
+                
+                // Lightmap UV is calculated by applying the surface's offset/scale to the texture UV.
+                positions.push_back(mVertices[vertexIndex]);
+                uvs.push_back(mUVs[vertexIndex]);
+                lightmapUvs.push_back(Vector2((mUVs[vertexIndex].x + surface.lightmapUvOffset.x) * surface.lightmapUvScale.x,
+                                              (mUVs[vertexIndex].y + surface.lightmapUvOffset.y) * surface.lightmapUvScale.y));
+            }
+            polygonVertexIndexes.push_back(it->second);
+        }
+        
+        // The first vertex in the fan is shared by all triangles.
+        PolygonRange& range = mPolygonTriangleRanges[i];
+        range.offset = static_cast<int>(mPolygonTriangleIndexes.size());
+        for(int k = 1; k < static_cast<int>(polygonVertexIndexes.size()) - 1; k++)
+        {
+            mPolygonTriangleIndexes.push_back(polygonVertexIndexes[0]);
+            mPolygonTriangleIndexes.push_back(polygonVertexIndexes[k]);
+            mPolygonTriangleIndexes.push_back(polygonVertexIndexes[k + 1]);
+        }
+        range.count = static_cast<int>(mPolygonTriangleIndexes.size()) - range.offset;
+    }
+    if(positions.empty()) { return; }
+    
+    // Positions are quantized relative to the BSP's bounds. Rendering scales/offsets by the bounds to get back to world space.
+    AABB bounds(positions[0], positions[0]);
+    for(auto& position : positions)
+    {
+        bounds.GrowToContain(position);
+    }
+    Vector3 boundsMin = bounds.GetMin();
+    Vector3 boundsSize = bounds.GetMax() - boundsMin;
+    for(int i = 0; i < 3; i++)
+    {
+        // Avoid divide by zero if the BSP is flat along an axis.
+        if(boundsSize[i] <= 0.0f) { boundsSize[i] = 1.0f; }
+    }
+    for(auto& position : positions)
+    {
+        position = Vector3((position.x - boundsMin.x) / boundsSize.x,
+                           (position.y - boundsMin.y) / boundsSize.y,
+                           (position.z - boundsMin.z) / boundsSize.z);
+    }
+    mPositionDecodeMatrix = Matrix4::MakeTranslate(boundsMin) * Matrix4::MakeScale(boundsSize);
+    
+    // Generate mesh definition.
+    // Index data changes each frame, so mark as dynamic. Start with all triangles, so the index buffer is big enough for any frame.
+    // Vertex data never changes, so interleave it in compact formats. Texture UVs may tile a lot, so use half floats only if they're small.
+    // Lightmap UVs are usually within the lightmap, so unorm16 works - but stay safe if not.
+    MeshDefinition meshDefinition;
+    meshDefinition.meshUsage = MeshUsage::Dynamic;
+    
+    const float kMaxHalfUV = 2.0f;
+    int vertexCount = static_cast<int>(positions.size());
+    bool halfUVs = VertexCompression::IsInRange(reinterpret_cast<float*>(&uvs[0]), vertexCount * 2, -kMaxHalfUV, kMaxHalfUV);
+    bool unormLightmapUVs = VertexCompression::IsInRange(reinterpret_cast<float*>(&lightmapUvs[0]), vertexCount * 2, 0.0f, 1.0f);
+    
+    VertexDefinition& vertexDefinition = meshDefinition.vertexDefinition;
+    vertexDefinition.layout = VertexDefinition::Layout::Interleaved;
+    vertexDefinition.attributes.push_back(VertexAttribute::PositionQuantized);
+    vertexDefinition.attributes.push_back(halfUVs ? VertexAttribute::UV1Half : VertexAttribute::UV1);
+    vertexDefinition.attributes.push_back(unormLightmapUVs ? VertexAttribute::UV2Unorm16 : VertexAttribute::UV2);
+    
+    meshDefinition.vertexCount = vertexCount;
+    
+    int stride = vertexDefinition.CalculateStride();
+    std::vector<uint8_t> vertexData(vertexCount * stride);
+    const float* attributeData[] = {
+        reinterpret_cast<float*>(&positions[0]),
+        reinterpret_cast<float*>(&uvs[0]),
+        reinterpret_cast<float*>(&lightmapUvs[0])
+    };
+    for(int i = 0; i < vertexDefinition.attributes.size(); i++)
+    {
+        VertexCompression::EncodeAttribute(vertexDefinition.attributes[i], attributeData[i], vertexCount,
+                                           &vertexData[vertexDefinition.CalculateAttributeOffset(i)], stride);
+    }
     meshDefinition.vertexData = &vertexData[0];
     
-    meshDefinition.indexCount = static_cast<int>(mVertexIndices.size());
-    meshDefinition.indexData = static_cast<unsigned short*>(&mVertexIndices[0]);
+    meshDefinition.indexCount = static_cast<int>(mPolygonTriangleIndexes.size());
+    meshDefinition.indexData = &mPolygonTriangleIndexes[0];
     
     // Create vertex array.
     mVertexArray = VertexArray(meshDefinition);
+    
+    // Figure out which batch each surface belongs to.
+    RefreshBatches();
+}
+
+void BSP::RefreshBatches()
+{
+    // Batch indexes are about to change, so cached per-batch index data is no longer valid.
+    mVisibleSetCacheValid = false;
+    mBatchesDirty = false;
+    
+    // Each unique texture/lightmap pair is a batch.
+    std::map<std::pair<Texture*, Texture*>, int> batchIndexes;
+    mBatches.clear();
+    mSurfaceBatchIndexes.resize(mSurfaces.size());
+    for(int i = 0; i < mSurfaces.size(); i++)
+    {
+        std::pair<Texture*, Texture*> key(mSurfaces[i].texture, mSurfaces[i].lightmapTexture);
+        auto it = batchIndexes.find(key);
+        if(it == batchIndexes.end())
+        {
+            it = batchIndexes.emplace(key, static_cast<int>(mBatches.size())).first;
+            
+            Batch batch;
+            batch.texture = key.first;
+            batch.lightmapTexture = key.second;
+            mBatches.push_back(batch);
+        }
+        mSurfaceBatchIndexes[i] = it->second;
+    }
+}
+
+void BSP::BuildBounds()
+{
+    // Calculate bounds of each polygon from its vertices.
+    mPolygonBounds.resize(mPolygons.size());
+    for(int i = 0; i < mPolygons.size(); i++)
+    {
+        const BSPPolygon& polygon = mPolygons[i];
+        AABB& bounds = mPolygonBounds[i];
+        bounds = AABB(Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+        for(int k = polygon.vertexIndexOffset; k < polygon.vertexIndexOffset + polygon.vertexIndexCount; k++)
+        {
+            bounds.GrowToContain(mVertices[mVertexIndices[k]]);
+        }
+    }
+    
+    // Node bounds contain the node's polygons and all child nodes. Nodes with no geometry are left with invalid (empty) bounds.
+    mNodeBounds.assign(mNodes.size(), AABB(Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX)));
+    if(mRootNodeIndex < mNodes.size())
+    {
+        BuildNodeBounds(mRootNodeIndex);
+    }
+}
+
+void BSP::BuildNodeBounds(int nodeIndex)
+{
+    const BSPNode& node = mNodes[nodeIndex];
+    AABB& bounds = mNodeBounds[nodeIndex];
+    
+    // Include polygons from both sets.
+    if(node.polygonIndex != 65535)
+    {
+        for(int i = node.polygonIndex; i < node.polygonIndex + node.polygonCount; i++)
+        {
+            bounds.GrowToContain(mPolygonBounds[i]);
+        }
+    }
+    if(node.polygonIndex2 != 65535)
+    {
+        for(int i = node.polygonIndex2; i < node.polygonIndex2 + node.polygonCount2; i++)
+        {
+            bounds.GrowToContain(mPolygonBounds[i]);
+        }
+    }
+    
+    // Children are built before being added to parent bounds.
+    if(node.frontChildIndex < mNodes.size())
+    {
+        BuildNodeBounds(node.frontChildIndex);
+        bounds.GrowToContain(mNodeBounds[node.frontChildIndex]);
+    }
+    if(node.backChildIndex < mNodes.size())
+    {
+        BuildNodeBounds(node.backChildIndex);
+        bounds.GrowToContain(mNodeBounds[node.backChildIndex]);
+    }
 }
@@ -12,11 +12,15 @@
 #include <unordered_map>
 #include <vector>
 
+#include "BVH.h"
+#include "AABB.h"
 #include "Material.h"
 #include "Mesh.h"
 #include "Plane.h"
 #include "Ray.h"
 #include "Collisions.h"
+#include "Frustum.h"
+#include "StringUtil.h"
 #include "Vector2.h"
 #include "Vector3.h"
 
@@ -102,6 +106,42 @@ struct BSPSurface
 	bool interactive = true;
 };
 
+// BSP geometry is made up of polygons, but raycasts are done against triangles.
+// This identifies the surface and object that a triangle belongs to.
+struct BSPTriangle
+{
+    unsigned short surfaceIndex = 0;
+    unsigned int objectIndex = 0;
+};
+
+// Info about a BSP raycast hit.
+// Compared to RaycastHit, this identifies the hit object by index (rather than by name) - much cheaper when collecting many hits.
+struct BSPRaycastHit
+{
+    float t = FLT_MAX;
+    unsigned short surfaceIndex = 0;
+    unsigned int objectIndex = 0;
+};
+
+// Stats from the most recent BSP render, for debugging/profiling.
+struct BSPRenderStats
+{
+    // Nodes visited during tree traversal, and nodes skipped because their bounds were outside the view frustum.
+    int nodesVisited = 0;
+    int nodesCulled = 0;
+    
+    // Polygons visited in non-culled nodes, and polygons skipped because their bounds were outside the view frustum.
+    int polygonsVisited = 0;
+    int polygonsCulled = 0;
+    
+    // Polygons and batches (draw calls) actually rendered.
+    int polygonsRendered = 0;
+    int batchesRendered = 0;
+    
+    // Number of frames the above visible set has been reused, without traversing the tree.
+    int cachedFrames = 0;
+};
+
 class BSP : public Asset
 {
 public:
@@ -110,22 +150,29 @@ public:
 	BSPActor* CreateBSPActor(const std::string& objectName);
 	
     bool RaycastNearest(const Ray& ray, RaycastHit& outHitInfo);
-	bool RaycastSingle(const Ray& ray, std::string name, RaycastHit& outHitInfo);
-	std::vector<RaycastHit> RaycastAll(const Ray& ray);
+	bool RaycastSingle(const Ray& ray, const std::string& name, RaycastHit& outHitInfo);
+	std::vector<BSPRaycastHit> RaycastAll(const Ray& ray);
 	bool RaycastPolygon(const Ray& ray, const BSPPolygon* polygon, RaycastHit& outHitInfo);
 	
-	void SetVisible(std::string objectName, bool visible);
-	void SetTexture(std::string objectName, Texture* texture);
+	void SetVisible(const std::string& objectName, bool visible);
+	void SetTexture(const std::string& objectName, Texture* texture);
 	
-	bool Exists(std::string objectName) const;
-	bool IsVisible(std::string objectName) const;
+	bool Exists(const std::string& objectName) const;
+	bool IsVisible(const std::string& objectName) const;
     
 	Vector3 GetPosition(const std::string& objectName) const;
+	
+	const std::string& GetObjectName(unsigned int objectIndex) const { return mObjectNames[objectIndex]; }
+	Texture* GetSurfaceTexture(int surfaceIndex) const { return mSurfaces[surfaceIndex].texture; }
+	
+	void GetObjectTriangles(const std::string& objectName, std::vector<Triangle>& outTriangles, std::vector<int>& outSurfaceIndexes) const;
     
     void ApplyLightmap(const BSPLightmap& lightmap);
     
-    void RenderOpaque(const Vector3& cameraPosition, const Vector3& cameraDirection);
+    void RenderOpaque(const Vector3& cameraPosition, const Frustum& frustum);
     void RenderTranslucent();
+    
+    const BSPRenderStats& GetRenderStats() const { return mRenderStats; }
 	
 private:
     // Identifies the root node in the node list.
@@ -153,6 +200,29 @@ private:
     // Each BSP map is logically divided into objects.
     std::vector<std::string> mObjectNames;
     
+    // Polygons reference surfaces, and surfaces reference objects. But we often need to go the other way (object -> surfaces -> polygons).
+    // Rather than scanning all surfaces/polygons each time, these lookup tables are built once after loading.
+    struct ObjectInfo
+    {
+        // Surfaces belonging to this object.
+        std::vector<unsigned short> surfaceIndexes;
+        
+        // Average position of all object vertices, and bounds of all object vertices.
+        Vector3 center;
+        AABB aabb;
+    };
+    std::vector<ObjectInfo> mObjectInfos;
+    std::unordered_map<std::string, int, StringUtil::CaseInsensitiveHash, StringUtil::CaseInsensitiveEquals> mObjectIndexesByName;
+    
+    // Polygon indexes sorted by surface. Each surface has an offset + count into this list.
+    struct PolygonRange
+    {
+        int offset = 0;
+        int count = 0;
+    };
+    std::vector<unsigned short> mSurfacePolygonIndexes;
+    std::vector<PolygonRange> mSurfacePolygonRanges;
+    
     // Vertex attributes for BSP mesh.
     std::vector<Vector3> mVertices;
     std::vector<Vector2> mUVs;
@@ -160,14 +230,78 @@ private:
     // Vertex indices for BSP mesh.
     std::vector<unsigned short> mVertexIndices;
     
-    // Vertex array is loaded up with vertices/uvs/indices to perform rendering.
+    // BVH over all BSP triangles, used to accelerate raycasts.
+    // Triangle indexes in the BVH are indexes into the triangle info list.
+    BVH mBVH;
+    std::vector<BSPTriangle> mTriangles;
+    
+    // Vertex array is loaded up with render vertices (position, uv, lightmap uv) to perform rendering.
+    // Index data changes each frame, depending on what polygons are visible.
     VertexArray mVertexArray;
     
+    // Render vertex positions are quantized relative to the BSP's bounds. This transforms them back to world space.
+    Matrix4 mPositionDecodeMatrix = Matrix4::Identity;
+    
+    // Each polygon's triangle fan is converted to a triangle list at load time.
+    // Each polygon has an offset + count into this list.
+    std::vector<unsigned short> mPolygonTriangleIndexes;
+    std::vector<PolygonRange> mPolygonTriangleRanges;
+    
+    // Surfaces with the same texture and lightmap are drawn together, in a single draw call.
+    struct Batch
+    {
+        Texture* texture = nullptr;
+        Texture* lightmapTexture = nullptr;
+    };
+    std::vector<Batch> mBatches;
+    std::vector<int> mSurfaceBatchIndexes;
+    
+    // Set when a surface's texture or lightmap changes. Batches are rebuilt before the next render.
+    bool mBatchesDirty = false;
+    
+    // Per-frame render data: visible polygons, and the index data generated from them (grouped by batch).
+    // These are kept around between frames to avoid reallocating every frame.
+    std::vector<unsigned short> mVisiblePolygons;
+    std::vector<unsigned short> mFrameIndexes;
+    std::vector<PolygonRange> mBatchIndexRanges;
+    std::vector<unsigned short> mTranslucentIndexes;
+    
+    // The visible set and index data are reused while the camera doesn't move (which is most of the time).
+    // The cache is invalidated if the camera moves, or if surface visibility/textures change.
+    Vector3 mCachedCameraPosition;
+    Frustum mCachedFrustum;
+    bool mVisibleSetCacheValid = false;
+    
+    // Whether the index buffer currently contains the frame indexes.
+    bool mFrameIndexesUploaded = false;
+    
+    // Bounds of each polygon, and bounds of each node (containing the node's polygons and all its children).
+    // Used to cull parts of the tree outside the view frustum.
+    std::vector<AABB> mPolygonBounds;
+    std::vector<AABB> mNodeBounds;
+    
+    // Stats from most recent render.
+    BSPRenderStats mRenderStats;
+    
+    // Debug toggles for hiding node polygon sets. Read once per frame, and part of the visible set cache key.
+    bool mHidePolygons1 = false;
+    bool mHidePolygons2 = false;
+    
     // Material for rendering BSP.
 	Material mMaterial;
     
-    void RenderTree(const BSPNode& node, const Vector3& cameraPosition, const Vector3& cameraDirection);
-    void RenderPolygon(BSPPolygon& polygon, bool translucent);
+    void RenderTree(int nodeIndex, const Vector3& cameraPosition, const Frustum& frustum, unsigned int planeMask);
+    void GatherPolygon(int polygonIndex, const Frustum& frustum, unsigned int planeMask);
+    void BuildBatchIndexes(const std::vector<unsigned short>& polygonIndexes);
+    void DrawBatch(int batchIndex, int indexOffset, int indexCount);
     
     void ParseFromData(char* data, int dataLength);
+    void BuildLookupTables();
+    void BuildBVH();
+    void BuildRenderData();
+    void RefreshBatches();
+    void BuildBounds();
+    void BuildNodeBounds(int nodeIndex);
+    
+    int GetObjectIndex(const std::string& objectName) const;
 };
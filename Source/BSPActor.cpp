@@ -14,10 +14,8 @@ BSPActor::BSPActor(BSP* bsp, const std::string& name) : GKObject(),
 
 void BSPActor::SetVisible(bool visible)
 {
-	for(auto& surface : mSurfaces)
-	{
-		surface->visible = visible;
-	}
+	// Go through the BSP, so it knows its cached visible set is out of date.
+	mBSP->SetVisible(mName, visible);
 }
 
 void BSPActor::SetInteractive(bool interactive)
@@ -0,0 +1,286 @@
+//
+// BVH.cpp
+//
+// Clark Kromenaker
+//
+#include "BVH.h"
+
+namespace
+{
+	// Surface area of a box with given min/max.
+	// SAH uses surface area as a proxy for "probability a random ray hits this box."
+	float GetSurfaceArea(const Vector3& min, const Vector3& max)
+	{
+		Vector3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	// Helper for growing min/max points to contain another point.
+	void GrowMinMax(Vector3& min, Vector3& max, const Vector3& point)
+	{
+		min.x = std::min(min.x, point.x);
+		min.y = std::min(min.y, point.y);
+		min.z = std::min(min.z, point.z);
+		max.x = std::max(max.x, point.x);
+		max.y = std::max(max.y, point.y);
+		max.z = std::max(max.z, point.z);
+	}
+}
+
+void BVH::Build(const std::vector<Triangle>& triangles)
+{
+	Clear();
+	if(triangles.empty()) { return; }
+
+	// Start with triangles in original order.
+	int triangleCount = static_cast<int>(triangles.size());
+	mTriangleIndexes.resize(triangleCount);
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		mTriangleIndexes[i] = i;
+	}
+
+	// Centroids are used to decide which side of a split each triangle goes on.
+	std::vector<Vector3> centroids(triangleCount);
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		centroids[i] = (triangles[i].p0 + triangles[i].p1 + triangles[i].p2) / 3.0f;
+	}
+
+	// Triangles must be available during build to calculate node bounds.
+	mTriangles = triangles;
+
+	// A binary tree with N leaves has at most 2N - 1 nodes.
+	mNodes.reserve(triangleCount * 2);
+
+	// Create root node containing all triangles, and recursively split it.
+	mNodes.emplace_back();
+	mNodes[0].childOrFirstTriangle = 0;
+	mNodes[0].triangleCount = triangleCount;
+	UpdateNodeBounds(0);
+	Subdivide(0, 0, centroids);
+
+	// Reorder triangles so leaf triangles are contiguous. This makes leaf iteration cache-friendly during traversal.
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		mTriangles[i] = triangles[mTriangleIndexes[i]];
+	}
+
+	// Pack reordered triangles for SIMD testing. Any unused lanes in the last packet are left cleared.
+	mPackets.resize((triangleCount + 3) / 4);
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		mPackets[i / 4].Set(i % 4, mTriangles[i].p0, mTriangles[i].p1, mTriangles[i].p2);
+	}
+}
+
+void BVH::Refit(const std::vector<Triangle>& triangles)
+{
+	int triangleCount = static_cast<int>(mTriangles.size());
+	if(triangles.size() != mTriangles.size() || triangleCount == 0) { return; }
+
+	// Copy in new triangle positions, using the same reordering as when the tree was built.
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		mTriangles[i] = triangles[mTriangleIndexes[i]];
+		mPackets[i / 4].Set(i % 4, mTriangles[i].p0, mTriangles[i].p1, mTriangles[i].p2);
+	}
+
+	// Child nodes are always added after their parent, so iterating backwards updates children before parents.
+	for(int nodeIndex = static_cast<int>(mNodes.size()) - 1; nodeIndex >= 0; --nodeIndex)
+	{
+		Node& node = mNodes[nodeIndex];
+		node.min = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+		node.max = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		if(node.IsLeaf())
+		{
+			// Triangles are already reordered here, so no need to go through triangle indexes.
+			int end = node.childOrFirstTriangle + node.triangleCount;
+			for(int i = node.childOrFirstTriangle; i < end; ++i)
+			{
+				GrowMinMax(node.min, node.max, mTriangles[i].p0);
+				GrowMinMax(node.min, node.max, mTriangles[i].p1);
+				GrowMinMax(node.min, node.max, mTriangles[i].p2);
+			}
+		}
+		else
+		{
+			const Node& child1 = mNodes[node.childOrFirstTriangle];
+			const Node& child2 = mNodes[node.childOrFirstTriangle + 1];
+			GrowMinMax(node.min, node.max, child1.min);
+			GrowMinMax(node.min, node.max, child1.max);
+			GrowMinMax(node.min, node.max, child2.min);
+			GrowMinMax(node.min, node.max, child2.max);
+		}
+	}
+}
+
+void BVH::Clear()
+{
+	mNodes.clear();
+	mTriangles.clear();
+	mTriangleIndexes.clear();
+	mPackets.clear();
+}
+
+AABB BVH::GetBounds() const
+{
+	if(mNodes.empty()) { return AABB(); }
+	return AABB(mNodes[0].min, mNodes[0].max);
+}
+
+void BVH::UpdateNodeBounds(int nodeIndex)
+{
+	Node& node = mNodes[nodeIndex];
+	node.min = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	node.max = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	int end = node.childOrFirstTriangle + node.triangleCount;
+	for(int i = node.childOrFirstTriangle; i < end; ++i)
+	{
+		const Triangle& triangle = mTriangles[mTriangleIndexes[i]];
+		GrowMinMax(node.min, node.max, triangle.p0);
+		GrowMinMax(node.min, node.max, triangle.p1);
+		GrowMinMax(node.min, node.max, triangle.p2);
+	}
+}
+
+void BVH::Subdivide(int nodeIndex, int depth, const std::vector<Vector3>& centroids)
+{
+	// Copy these out - adding child nodes below may reallocate the node vector.
+	int first = mNodes[nodeIndex].childOrFirstTriangle;
+	int count = mNodes[nodeIndex].triangleCount;
+
+	// Can't split a single triangle, and we can't go any deeper than the max depth.
+	if(count <= 1 || depth >= kMaxDepth) { return; }
+
+	// Calculate bounds of triangle centroids. Splits are chosen within these bounds.
+	Vector3 centroidMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 centroidMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(int i = first; i < first + count; ++i)
+	{
+		GrowMinMax(centroidMin, centroidMax, centroids[mTriangleIndexes[i]]);
+	}
+
+	// For each axis, place triangles into bins by centroid, and evaluate SAH cost of splitting between each bin.
+	// Cost of a split is (left triangle count * left area) + (right triangle count * right area).
+	struct Bin
+	{
+		Vector3 min = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vector3 max = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		int count = 0;
+	};
+	int bestAxis = -1;
+	int bestSplit = -1;
+	float bestCost = FLT_MAX;
+	for(int axis = 0; axis < 3; ++axis)
+	{
+		// If all centroids are at the same spot on this axis, there's no way to split along it.
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if(extent <= 0.0f) { continue; }
+
+		Bin bins[kBinCount];
+		float binScale = kBinCount / extent;
+		for(int i = first; i < first + count; ++i)
+		{
+			int triangleIndex = mTriangleIndexes[i];
+			int binIndex = std::min(kBinCount - 1, static_cast<int>((centroids[triangleIndex][axis] - centroidMin[axis]) * binScale));
+
+			const Triangle& triangle = mTriangles[triangleIndex];
+			Bin& bin = bins[binIndex];
+			++bin.count;
+			GrowMinMax(bin.min, bin.max, triangle.p0);
+			GrowMinMax(bin.min, bin.max, triangle.p1);
+			GrowMinMax(bin.min, bin.max, triangle.p2);
+		}
+
+		// Sweep from left and right to get area/count on each side of each split plane.
+		float leftArea[kBinCount - 1];
+		float rightArea[kBinCount - 1];
+		int leftCount[kBinCount - 1];
+		int rightCount[kBinCount - 1];
+		Vector3 leftMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vector3 leftMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		Vector3 rightMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vector3 rightMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		int leftSum = 0;
+		int rightSum = 0;
+		for(int i = 0; i < kBinCount - 1; ++i)
+		{
+			leftSum += bins[i].count;
+			leftCount[i] = leftSum;
+			if(bins[i].count > 0)
+			{
+				GrowMinMax(leftMin, leftMax, bins[i].min);
+				GrowMinMax(leftMin, leftMax, bins[i].max);
+			}
+			leftArea[i] = leftSum > 0 ? GetSurfaceArea(leftMin, leftMax) : 0.0f;
+
+			int j = kBinCount - 1 - i;
+			rightSum += bins[j].count;
+			rightCount[j - 1] = rightSum;
+			if(bins[j].count > 0)
+			{
+				GrowMinMax(rightMin, rightMax, bins[j].min);
+				GrowMinMax(rightMin, rightMax, bins[j].max);
+			}
+			rightArea[j - 1] = rightSum > 0 ? GetSurfaceArea(rightMin, rightMax) : 0.0f;
+		}
+
+		// Find cheapest split on this axis.
+		for(int i = 0; i < kBinCount - 1; ++i)
+		{
+			if(leftCount[i] == 0 || rightCount[i] == 0) { continue; }
+			float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if(cost < bestCost)
+			{
+				bestAxis = axis;
+				bestSplit = i;
+				bestCost = cost;
+			}
+		}
+	}
+
+	// If splitting isn't cheaper than just testing all triangles in this node, leave it as a leaf.
+	float leafCost = count * GetSurfaceArea(mNodes[nodeIndex].min, mNodes[nodeIndex].max);
+	if(bestAxis < 0 || bestCost >= leafCost) { return; }
+
+	// Partition triangles in place - triangles in bins at or before split go left, others go right.
+	float binScale = kBinCount / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	int i = first;
+	int j = first + count - 1;
+	while(i <= j)
+	{
+		int binIndex = std::min(kBinCount - 1, static_cast<int>((centroids[mTriangleIndexes[i]][bestAxis] - centroidMin[bestAxis]) * binScale));
+		if(binIndex <= bestSplit)
+		{
+			++i;
+		}
+		else
+		{
+			std::swap(mTriangleIndexes[i], mTriangleIndexes[j]);
+			--j;
+		}
+	}
+	int leftCount = i - first;
+
+	// Create child nodes next to one another.
+	int leftIndex = static_cast<int>(mNodes.size());
+	mNodes.emplace_back();
+	mNodes.emplace_back();
+
+	mNodes[leftIndex].childOrFirstTriangle = first;
+	mNodes[leftIndex].triangleCount = leftCount;
+	mNodes[leftIndex + 1].childOrFirstTriangle = first + leftCount;
+	mNodes[leftIndex + 1].triangleCount = count - leftCount;
+
+	// This node is now an interior node.
+	mNodes[nodeIndex].childOrFirstTriangle = leftIndex;
+	mNodes[nodeIndex].triangleCount = 0;
+
+	// Recursively split children.
+	UpdateNodeBounds(leftIndex);
+	UpdateNodeBounds(leftIndex + 1);
+	Subdivide(leftIndex, depth + 1, centroids);
+	Subdivide(leftIndex + 1, depth + 1, centroids);
+}
@@ -0,0 +1,291 @@
+//
+// BVH.h
+//
+// Clark Kromenaker
+//
+// A "bounding volume hierarchy" over a set of triangles.
+//
+// Raycasting against every triangle in a large mesh (like a BSP) gets expensive.
+// A BVH groups triangles into a tree of AABBs, so a raycast only needs to test
+// triangles whose bounding boxes the ray actually passes through.
+//
+// The tree is built using the "surface area heuristic" (SAH), which tends to produce
+// trees that are fast to query. Building is relatively slow, so it's meant to be done at load time.
+//
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "AABB.h"
+#include "Collisions.h"
+#include "Ray.h"
+#include "Triangle.h"
+
+class BVH
+{
+public:
+	void Build(const std::vector<Triangle>& triangles);
+	void Clear();
+
+	// Updates triangle positions and node bounds without changing the tree's structure.
+	// Triangles must be in the same order (and the same count) as were passed to "Build."
+	// Much faster than rebuilding, but the tree gets less efficient if triangles move a lot relative to one another.
+	void Refit(const std::vector<Triangle>& triangles);
+
+	// Finds the nearest triangle hit by the ray. The filter is any callable taking a triangle index and
+	// returning true if the triangle should be considered; this allows callers to ignore some triangles.
+	template<typename Filter> bool RaycastNearest(const Ray& ray, Filter filter, RaycastHit& outHitInfo, int& outTriangleIndex) const;
+
+	// Finds ANY triangle hit by the ray (not necessarily the nearest one). Faster than nearest, since we can stop at the first hit.
+	template<typename Filter> bool RaycastAny(const Ray& ray, Filter filter, RaycastHit& outHitInfo, int& outTriangleIndex) const;
+
+	// Finds ALL triangles hit by the ray. The callback is called with triangle index and "t" for each hit, in no particular order.
+	template<typename Filter, typename Callback> void RaycastAll(const Ray& ray, Filter filter, Callback callback) const;
+
+	// Finds all triangles whose bounds overlap the box. The callback is called with each triangle's index, in no particular order.
+	// Useful for collision queries (e.g. sphere vs. triangles), where only triangles near the collider need exact tests.
+	template<typename Callback> void QueryOverlaps(const AABB& aabb, Callback callback) const;
+
+	// Triangle indexes are the triangle's index in the vector originally passed to "Build."
+	int GetTriangleCount() const { return static_cast<int>(mTriangles.size()); }
+	int GetNodeCount() const { return static_cast<int>(mNodes.size()); }
+
+	AABB GetBounds() const;
+
+private:
+	// A node in the tree. To keep things compact, a node is either an interior node or a leaf node.
+	// Interior nodes have two children, stored next to one another in the node list (so only need one index).
+	// Leaf nodes contain an offset + count into the triangle list.
+	struct Node
+	{
+		Vector3 min;
+		Vector3 max;
+
+		// If triangle count is zero, this is the index of the first child (second child is index + 1).
+		// Otherwise, this is the index of the first triangle in the node.
+		int childOrFirstTriangle = 0;
+		int triangleCount = 0;
+
+		bool IsLeaf() const { return triangleCount > 0; }
+	};
+
+	// Max tree depth. Traversal uses a fixed-size stack, so the tree must not exceed this.
+	static const int kMaxDepth = 48;
+
+	// Number of bins used when evaluating SAH split candidates along each axis.
+	static const int kBinCount = 12;
+
+	// Nodes in the tree - index 0 is the root node.
+	std::vector<Node> mNodes;
+
+	// Triangles, reordered so that each leaf's triangles are contiguous in memory.
+	std::vector<Triangle> mTriangles;
+
+	// Maps from reordered triangle index to triangle index originally passed in.
+	std::vector<int> mTriangleIndexes;
+
+	// Reordered triangles, packed into groups of four for SIMD ray tests.
+	// Triangle "i" is in packet "i / 4" at lane "i % 4." Leaves don't necessarily start at a packet boundary,
+	// so lanes outside a leaf's range are masked out when testing.
+	std::vector<TrianglePacket4> mPackets;
+
+	void UpdateNodeBounds(int nodeIndex);
+	void Subdivide(int nodeIndex, int depth, const std::vector<Vector3>& centroids);
+
+	// Core traversal function. For each triangle hit closer than the current max "t", the callback is called with triangle index and "t."
+	// The callback returns the new max "t" to use for the rest of the traversal (return a negative value to stop traversing).
+	template<typename Filter, typename HitCallback> void Traverse(const Ray& ray, Filter filter, HitCallback callback) const;
+};
+
+template<typename Filter>
+bool BVH::RaycastNearest(const Ray& ray, Filter filter, RaycastHit& outHitInfo, int& outTriangleIndex) const
+{
+	outTriangleIndex = -1;
+	float nearestT = FLT_MAX;
+	Traverse(ray, filter, [&nearestT, &outTriangleIndex](int triangleIndex, float t) -> float {
+		// Narrow traversal to only consider hits closer than this one.
+		nearestT = t;
+		outTriangleIndex = triangleIndex;
+		return t;
+	});
+
+	if(outTriangleIndex < 0) { return false; }
+	outHitInfo.t = nearestT;
+	return true;
+}
+
+template<typename Filter>
+bool BVH::RaycastAny(const Ray& ray, Filter filter, RaycastHit& outHitInfo, int& outTriangleIndex) const
+{
+	outTriangleIndex = -1;
+	float hitT = FLT_MAX;
+	Traverse(ray, filter, [&hitT, &outTriangleIndex](int triangleIndex, float t) -> float {
+		// Any hit will do, so stop right away.
+		hitT = t;
+		outTriangleIndex = triangleIndex;
+		return -1.0f;
+	});
+
+	if(outTriangleIndex < 0) { return false; }
+	outHitInfo.t = hitT;
+	return true;
+}
+
+template<typename Filter, typename Callback>
+void BVH::RaycastAll(const Ray& ray, Filter filter, Callback callback) const
+{
+	Traverse(ray, filter, [&callback](int triangleIndex, float t) -> float {
+		// Report every hit, and don't narrow the traversal.
+		callback(triangleIndex, t);
+		return FLT_MAX;
+	});
+}
+
+template<typename Callback>
+void BVH::QueryOverlaps(const AABB& aabb, Callback callback) const
+{
+	if(mNodes.empty()) { return; }
+
+	Vector3 min = aabb.GetMin();
+	Vector3 max = aabb.GetMax();
+	auto overlaps = [&min, &max](const Vector3& otherMin, const Vector3& otherMax) -> bool {
+		return otherMin.x <= max.x && otherMax.x >= min.x &&
+			   otherMin.y <= max.y && otherMax.y >= min.y &&
+			   otherMin.z <= max.z && otherMax.z >= min.z;
+	};
+
+	// Both children of a node are pushed at most once per level, so the stack can't exceed tree depth + 1.
+	int stack[kMaxDepth + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while(stackSize > 0)
+	{
+		const Node& node = mNodes[stack[--stackSize]];
+		if(!overlaps(node.min, node.max)) { continue; }
+
+		if(node.IsLeaf())
+		{
+			// Leaves can be fairly large, so check each triangle's bounds too.
+			int end = node.childOrFirstTriangle + node.triangleCount;
+			for(int i = node.childOrFirstTriangle; i < end; ++i)
+			{
+				const Triangle& triangle = mTriangles[i];
+				Vector3 triangleMin(std::min({ triangle.p0.x, triangle.p1.x, triangle.p2.x }),
+									std::min({ triangle.p0.y, triangle.p1.y, triangle.p2.y }),
+									std::min({ triangle.p0.z, triangle.p1.z, triangle.p2.z }));
+				Vector3 triangleMax(std::max({ triangle.p0.x, triangle.p1.x, triangle.p2.x }),
+									std::max({ triangle.p0.y, triangle.p1.y, triangle.p2.y }),
+									std::max({ triangle.p0.z, triangle.p1.z, triangle.p2.z }));
+				if(overlaps(triangleMin, triangleMax))
+				{
+					callback(mTriangleIndexes[i]);
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.childOrFirstTriangle;
+			stack[stackSize++] = node.childOrFirstTriangle + 1;
+		}
+	}
+}
+
+template<typename Filter, typename HitCallback>
+void BVH::Traverse(const Ray& ray, Filter filter, HitCallback callback) const
+{
+	if(mNodes.empty()) { return; }
+
+	// Precalculate inverse ray direction for ray/AABB slab tests.
+	// Division by zero results in infinity, which the slab test handles correctly.
+	Vector3 invDir(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+
+	// Returns distance along ray to entry point of node, or FLT_MAX if the ray misses (or hits farther than max t).
+	auto testNode = [&ray, &invDir](const Node& node, float maxT) -> float {
+		float tx1 = (node.min.x - ray.origin.x) * invDir.x;
+		float tx2 = (node.max.x - ray.origin.x) * invDir.x;
+		float tMin = std::min(tx1, tx2);
+		float tMax = std::max(tx1, tx2);
+
+		float ty1 = (node.min.y - ray.origin.y) * invDir.y;
+		float ty2 = (node.max.y - ray.origin.y) * invDir.y;
+		tMin = std::max(tMin, std::min(ty1, ty2));
+		tMax = std::min(tMax, std::max(ty1, ty2));
+
+		float tz1 = (node.min.z - ray.origin.z) * invDir.z;
+		float tz2 = (node.max.z - ray.origin.z) * invDir.z;
+		tMin = std::max(tMin, std::min(tz1, tz2));
+		tMax = std::min(tMax, std::max(tz1, tz2));
+
+		if(tMax >= tMin && tMax >= 0.0f && tMin <= maxT)
+		{
+			return tMin;
+		}
+		return FLT_MAX;
+	};
+
+	float maxT = FLT_MAX;
+	if(testNode(mNodes[0], maxT) == FLT_MAX) { return; }
+
+	// Iterative traversal using a stack of nodes still to be visited.
+	// Entry distance is saved with each node, so nodes can be skipped if a closer hit is found before they are visited.
+	int stack[kMaxDepth + 1];
+	float stackDist[kMaxDepth + 1];
+	int stackSize = 0;
+	stack[stackSize] = 0;
+	stackDist[stackSize++] = 0.0f;
+
+	while(stackSize > 0)
+	{
+		--stackSize;
+		if(stackDist[stackSize] > maxT) { continue; }
+		
+		const Node& node = mNodes[stack[stackSize]];
+		if(node.IsLeaf())
+		{
+			int first = node.childOrFirstTriangle;
+			int end = first + node.triangleCount;
+			for(int packetIndex = first / 4; packetIndex * 4 < end; ++packetIndex)
+			{
+				// Test four triangles at once, and ignore lanes for triangles that aren't part of this leaf.
+				float t[4];
+				int hitMask = Collisions::TestRayTrianglePacket4(ray, mPackets[packetIndex], t);
+				for(int lane = 0; hitMask != 0 && lane < 4; ++lane)
+				{
+					int i = packetIndex * 4 + lane;
+					if((hitMask & (1 << lane)) == 0 || i < first || i >= end || t[lane] > maxT) { continue; }
+
+					int triangleIndex = mTriangleIndexes[i];
+					if(!filter(triangleIndex)) { continue; }
+
+					maxT = callback(triangleIndex, t[lane]);
+					if(maxT < 0.0f) { return; }
+				}
+			}
+		}
+		else
+		{
+			// Visit nearer child first. For nearest hit queries, this narrows max "t" quickly and culls more nodes.
+			int child1 = node.childOrFirstTriangle;
+			int child2 = node.childOrFirstTriangle + 1;
+			float dist1 = testNode(mNodes[child1], maxT);
+			float dist2 = testNode(mNodes[child2], maxT);
+			if(dist1 > dist2)
+			{
+				std::swap(dist1, dist2);
+				std::swap(child1, child2);
+			}
+
+			// Push farther child first, so nearer child is popped first.
+			if(dist2 != FLT_MAX)
+			{
+				stack[stackSize] = child2;
+				stackDist[stackSize++] = dist2;
+			}
+			if(dist1 != FLT_MAX)
+			{
+				stack[stackSize] = child1;
+				stackDist[stackSize++] = dist1;
+			}
+		}
+	}
+}
@@ -5,6 +5,13 @@
 //
 #include "Collisions.h"
 
+// Packet tests use SSE when compiling for x86 with SSE2 (always true for x86-64).
+// Anywhere else (e.g. ARM Macs), each lane is tested with the regular scalar test instead.
+#if defined(__SSE2__) || defined(_M_X64)
+	#define COLLISIONS_SSE
+	#include <xmmintrin.h>
+#endif
+
 #include "AABB.h"
 #include "Plane.h"
 #include "Ray.h"
@@ -61,6 +68,73 @@
 	return intersects;
 }
 
+/*static*/ int Collisions::TestSphereTrianglePacket4(const Sphere& s, const TrianglePacket4& packet)
+{
+#if defined(COLLISIONS_SSE)
+	__m128 cx = _mm_set1_ps(s.center.x);
+	__m128 cy = _mm_set1_ps(s.center.y);
+	__m128 cz = _mm_set1_ps(s.center.z);
+	__m128 r = _mm_set1_ps(s.radius);
+	
+	__m128 p0x = _mm_loadu_ps(packet.p0x);
+	__m128 p0y = _mm_loadu_ps(packet.p0y);
+	__m128 p0z = _mm_loadu_ps(packet.p0z);
+	__m128 e1x = _mm_loadu_ps(packet.e1x);
+	__m128 e1y = _mm_loadu_ps(packet.e1y);
+	__m128 e1z = _mm_loadu_ps(packet.e1z);
+	__m128 e2x = _mm_loadu_ps(packet.e2x);
+	__m128 e2y = _mm_loadu_ps(packet.e2y);
+	__m128 e2z = _mm_loadu_ps(packet.e2z);
+	
+	// Sphere can only intersect if its center is within the triangle's bounds, expanded by the radius.
+	// Comparisons are strict, same as TestSphereTriangle (a sphere just touching a triangle doesn't intersect).
+	__m128 p1x = _mm_add_ps(p0x, e1x);
+	__m128 p1y = _mm_add_ps(p0y, e1y);
+	__m128 p1z = _mm_add_ps(p0z, e1z);
+	__m128 p2x = _mm_add_ps(p0x, e2x);
+	__m128 p2y = _mm_add_ps(p0y, e2y);
+	__m128 p2z = _mm_add_ps(p0z, e2z);
+	__m128 minX = _mm_sub_ps(_mm_min_ps(p0x, _mm_min_ps(p1x, p2x)), r);
+	__m128 minY = _mm_sub_ps(_mm_min_ps(p0y, _mm_min_ps(p1y, p2y)), r);
+	__m128 minZ = _mm_sub_ps(_mm_min_ps(p0z, _mm_min_ps(p1z, p2z)), r);
+	__m128 maxX = _mm_add_ps(_mm_max_ps(p0x, _mm_max_ps(p1x, p2x)), r);
+	__m128 maxY = _mm_add_ps(_mm_max_ps(p0y, _mm_max_ps(p1y, p2y)), r);
+	__m128 maxZ = _mm_add_ps(_mm_max_ps(p0z, _mm_max_ps(p1z, p2z)), r);
+	__m128 mask = _mm_and_ps(_mm_cmplt_ps(minX, cx), _mm_cmpgt_ps(maxX, cx));
+	mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmplt_ps(minY, cy), _mm_cmpgt_ps(maxY, cy)));
+	mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmplt_ps(minZ, cz), _mm_cmpgt_ps(maxZ, cz)));
+	
+	// Sphere can only intersect if its center is within radius of the triangle's plane.
+	// Using an unnormalized normal n, that's (n dot (c - p0))^2 < r^2 * (n dot n).
+	__m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+	__m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+	__m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+	__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_sub_ps(cx, p0x)), _mm_mul_ps(ny, _mm_sub_ps(cy, p0y))), _mm_mul_ps(nz, _mm_sub_ps(cz, p0z)));
+	__m128 normalLengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(_mm_mul_ps(dist, dist), _mm_mul_ps(_mm_mul_ps(r, r), normalLengthSq)));
+	
+	// Zero-size triangles (unused lanes) never intersect.
+	mask = _mm_and_ps(mask, _mm_cmpgt_ps(normalLengthSq, _mm_setzero_ps()));
+	return _mm_movemask_ps(mask);
+#else
+	int mask = 0;
+	for(int i = 0; i < 4; ++i)
+	{
+		Vector3 p0(packet.p0x[i], packet.p0y[i], packet.p0z[i]);
+		Vector3 e1(packet.e1x[i], packet.e1y[i], packet.e1z[i]);
+		Vector3 e2(packet.e2x[i], packet.e2y[i], packet.e2z[i]);
+		if(Vector3::Cross(e1, e2).GetLengthSq() <= 0.0f) { continue; }
+		
+		Vector3 intersection;
+		if(TestSphereTriangle(s, Triangle(p0, p0 + e1, p0 + e2), intersection))
+		{
+			mask |= (1 << i);
+		}
+	}
+	return mask;
+#endif
+}
+
 /*static*/ bool Collisions::TestAABBAABB(const AABB& aabb1, const AABB& aabb2)
 {
 	// There are 4 cases where the AABBs are not intersecting.
@@ -156,3 +230,94 @@
 	outHitInfo.t = t;
 	return true;
 }
+
+/*static*/ int Collisions::TestRayTrianglePacket4(const Ray& r, const TrianglePacket4& packet, float outT[4])
+{
+#if defined(COLLISIONS_SSE)
+	// Same math as TestRayTriangle (operations in the same order, so results match exactly), but for four triangles at once.
+	// Instead of early outs, each condition is accumulated into a mask of lanes that are still hit.
+	__m128 dx = _mm_set1_ps(r.direction.x);
+	__m128 dy = _mm_set1_ps(r.direction.y);
+	__m128 dz = _mm_set1_ps(r.direction.z);
+	
+	__m128 e1x = _mm_loadu_ps(packet.e1x);
+	__m128 e1y = _mm_loadu_ps(packet.e1y);
+	__m128 e1z = _mm_loadu_ps(packet.e1z);
+	__m128 e2x = _mm_loadu_ps(packet.e2x);
+	__m128 e2y = _mm_loadu_ps(packet.e2y);
+	__m128 e2z = _mm_loadu_ps(packet.e2z);
+	
+	// p = Cross(direction, e2), a = Dot(e1, p)
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+	__m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	
+	// If zero, ray is parallel to triangle plane.
+	__m128 absA = _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+	__m128 mask = _mm_cmpge_ps(absA, _mm_set1_ps(Math::kEpsilon));
+	__m128 f = _mm_div_ps(_mm_set1_ps(1.0f), a);
+	
+	// s = origin - p0, u = f * Dot(s, p)
+	__m128 sx = _mm_sub_ps(_mm_set1_ps(r.origin.x), _mm_loadu_ps(packet.p0x));
+	__m128 sy = _mm_sub_ps(_mm_set1_ps(r.origin.y), _mm_loadu_ps(packet.p0y));
+	__m128 sz = _mm_sub_ps(_mm_set1_ps(r.origin.z), _mm_loadu_ps(packet.p0z));
+	__m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)));
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+	
+	// q = Cross(s, e1), v = f * Dot(direction, q)
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+	__m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+	mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+	
+	// t = f * Dot(e2, q)
+	__m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+	
+	_mm_storeu_ps(outT, t);
+	return _mm_movemask_ps(mask);
+#else
+	int mask = 0;
+	for(int i = 0; i < 4; ++i)
+	{
+		Vector3 p0(packet.p0x[i], packet.p0y[i], packet.p0z[i]);
+		Vector3 p1 = p0 + Vector3(packet.e1x[i], packet.e1y[i], packet.e1z[i]);
+		Vector3 p2 = p0 + Vector3(packet.e2x[i], packet.e2y[i], packet.e2z[i]);
+		RaycastHit hitInfo;
+		if(TestRayTriangle(r, p0, p1, p2, hitInfo))
+		{
+			outT[i] = hitInfo.t;
+			mask |= (1 << i);
+		}
+	}
+	return mask;
+#endif
+}
+
+void TrianglePacket4::Set(int lane, const Vector3& p0, const Vector3& p1, const Vector3& p2)
+{
+	p0x[lane] = p0.x;
+	p0y[lane] = p0.y;
+	p0z[lane] = p0.z;
+	
+	Vector3 e1 = p1 - p0;
+	e1x[lane] = e1.x;
+	e1y[lane] = e1.y;
+	e1z[lane] = e1.z;
+	
+	Vector3 e2 = p2 - p0;
+	e2x[lane] = e2.x;
+	e2y[lane] = e2.y;
+	e2z[lane] = e2.z;
+}
+
+void TrianglePacket4::Clear(int lane)
+{
+	p0x[lane] = p0y[lane] = p0z[lane] = 0.0f;
+	e1x[lane] = e1y[lane] = e1z[lane] = 0.0f;
+	e2x[lane] = e2y[lane] = e2z[lane] = 0.0f;
+}
@@ -31,6 +31,28 @@ struct RaycastHit
 	Actor* actor = nullptr;
 };
 
+// Four triangles stored in "structure of arrays" form (all p0.x values together, and so on).
+// This allows testing against four triangles at once using SIMD instructions.
+// Unused lanes should be left cleared - a zero-size triangle is never hit.
+struct TrianglePacket4
+{
+	// First vertex of each triangle.
+	float p0x[4] = { 0.0f };
+	float p0y[4] = { 0.0f };
+	float p0z[4] = { 0.0f };
+	
+	// Edges from first vertex to second vertex (e1) and first vertex to third vertex (e2).
+	float e1x[4] = { 0.0f };
+	float e1y[4] = { 0.0f };
+	float e1z[4] = { 0.0f };
+	float e2x[4] = { 0.0f };
+	float e2y[4] = { 0.0f };
+	float e2z[4] = { 0.0f };
+	
+	void Set(int lane, const Vector3& p0, const Vector3& p1, const Vector3& p2);
+	void Clear(int lane);
+};
+
 class Collisions
 {
 public:
@@ -40,6 +62,10 @@ public:
 	static bool TestSpherePlane(const Sphere& s, const Plane& p);
 	static bool TestSphereTriangle(const Sphere& s, const Triangle& t, Vector3& intersection);
 	
+	// Quickly rejects triangles that can't intersect the sphere. Returns a bit mask of lanes that MAY intersect.
+	// This is conservative (only tests against triangle plane and bounds), so follow up with TestSphereTriangle for lanes that pass.
+	static int TestSphereTrianglePacket4(const Sphere& s, const TrianglePacket4& packet);
+	
 	// AABB
 	static bool TestAABBAABB(const AABB& aabb1, const AABB& aabb2);
 	//AABBPlane
@@ -54,6 +80,10 @@ public:
 	static bool TestRayTriangle(const Ray& r, const Triangle& t, RaycastHit& hitInfo);
 	static bool TestRayTriangle(const Ray& r, const Vector3& p0, const Vector3& p1, const Vector3& p2, RaycastHit& outHitInfo);
 	
+	// Tests a ray against four triangles at once. Returns a bit mask of lanes that were hit, with "t" values for hit lanes.
+	// Results match TestRayTriangle for each lane.
+	static int TestRayTrianglePacket4(const Ray& r, const TrianglePacket4& packet, float outT[4]);
+	
 	// Line Segment
 	static bool TestLineSegmentSphere(const LineSegment& ls, const Sphere& s);
 	static bool TestLineSegmentAABB(const LineSegment& ls, const AABB& aabb);
@@ -0,0 +1,95 @@
+//
+// DebugOverlay.cpp
+//
+// Clark Kromenaker
+//
+#include "DebugOverlay.h"
+
+#include "BSP.h"
+#include "GLState.h"
+#include "MeshOptimizer.h"
+#include "Services.h"
+#include "StringUtil.h"
+#include "UICanvas.h"
+#include "UILabel.h"
+#include "VertexAnimation.h"
+#include "VertexAnimator.h"
+
+DebugOverlay::DebugOverlay() : Actor(TransformType::RectTransform)
+{
+	// Needs to be a canvas so it can render stuff.
+	UICanvas* canvas = AddComponent<UICanvas>();
+	
+	// Take up full screen.
+	RectTransform* rectTransform = GetComponent<RectTransform>();
+	rectTransform->SetSizeDelta(0.0f, 0.0f);
+	rectTransform->SetAnchorMin(Vector2::Zero);
+	rectTransform->SetAnchorMax(Vector2::One);
+	
+	// Create stats text actor in bottom-left corner of screen.
+	Actor* statsTextActor = new Actor(TransformType::RectTransform);
+	mStatsLabel = statsTextActor->AddComponent<UILabel>();
+	mStatsLabel->SetFont(Services::GetAssets()->LoadFont("F_CONSOLE_DISPLAY"));
+	mStatsLabel->SetVerticalAlignment(VerticalAlignment::Bottom);
+	mStatsLabel->SetEnabled(mShowStats);
+	canvas->AddWidget(mStatsLabel);
+	
+	RectTransform* statsTextRT = mStatsLabel->GetRectTransform();
+	statsTextRT->SetParent(rectTransform);
+	statsTextRT->SetPivot(0.0f, 0.0f);
+	statsTextRT->SetAnchorMin(Vector2::Zero);
+	statsTextRT->SetAnchorMax(Vector2::Zero);
+	statsTextRT->SetSizeDelta(400.0f, 245.0f);
+	statsTextRT->SetAnchoredPosition(5.0f, 5.0f);
+}
+
+void DebugOverlay::OnUpdate(float deltaTime)
+{
+	// Toggle stats display.
+	if(Services::GetInput()->IsKeyDown(SDL_SCANCODE_F4))
+	{
+		mShowStats = !mShowStats;
+		mStatsLabel->SetEnabled(mShowStats);
+	}
+	if(!mShowStats) { return; }
+	
+	// Stats are from the previous frame's render.
+	std::string statsText;
+	BSP* bsp = Services::GetRenderer()->GetBSP();
+	if(bsp != nullptr)
+	{
+		const BSPRenderStats& stats = bsp->GetRenderStats();
+		statsText += StringUtil::Format("BSP Nodes: %d visited, %d culled\n", stats.nodesVisited, stats.nodesCulled);
+		statsText += StringUtil::Format("BSP Polygons: %d visited, %d culled, %d rendered\n", stats.polygonsVisited, stats.polygonsCulled, stats.polygonsRendered);
+		statsText += StringUtil::Format("BSP Batches: %d\n", stats.batchesRendered);
+		statsText += StringUtil::Format("BSP Cached Frames: %d\n", stats.cachedFrames);
+	}
+	
+	// Mesh draw calls, how many were saved by drawing identical submeshes with one instanced draw, and state changes between draws.
+	const RenderQueueStats& queueStats = Services::GetRenderer()->GetRenderQueueStats();
+	statsText += StringUtil::Format("Mesh Renderers: %d drawn, %d culled\n", queueStats.renderersDrawn, queueStats.renderersCulled);
+	statsText += StringUtil::Format("Mesh Draws: %d submeshes, %d draw calls (%d instanced)\n", queueStats.itemsRendered, queueStats.drawCalls, queueStats.instancedDrawCalls);
+	statsText += StringUtil::Format("Mesh State Changes: %d shader, %d texture\n", queueStats.shaderChanges, queueStats.textureChanges);
+	
+	// GL state calls made, and redundant ones skipped.
+	const GLStateStats& glStats = GLState::GetFrameStats();
+	statsText += StringUtil::Format("GL State Calls: %d issued, %d elided\n", glStats.issued, glStats.elided);
+	
+	// Vertex cache efficiency of loaded models, before and after optimization.
+	const MeshOptimizer::Stats& meshStats = MeshOptimizer::GetStats();
+	statsText += StringUtil::Format("Mesh ACMR: %.2f -> %.2f (%d meshes)\n", meshStats.GetACMRBefore(), meshStats.GetACMRAfter(), meshStats.meshCount);
+	
+	// Reuse of sampled vertex animation poses.
+	VertexPoseCacheStats poseStats = VertexAnimation::GetPoseCacheStats();
+	statsText += StringUtil::Format("Pose Cache: %.0f%% hits, %d uploads skipped\n", poseStats.GetHitRate() * 100.0f, poseStats.uploadsSkipped);
+	
+	// Vertex animation samples skipped for actors that are off screen or small on screen.
+	const VertexAnimationLODStats& lodStats = VertexAnimator::GetLODStats();
+	statsText += StringUtil::Format("Anim LOD: %d sampled, %d culled, %d reduced", lodStats.sampled, lodStats.culled, lodStats.reducedRate);
+	
+	// Only update label if text changed, since that requires regenerating the text mesh.
+	if(statsText != mStatsLabel->GetText())
+	{
+		mStatsLabel->SetText(statsText);
+	}
+}
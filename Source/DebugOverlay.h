@@ -0,0 +1,28 @@
+//
+// DebugOverlay.h
+//
+// Clark Kromenaker
+//
+// UI that displays rendering stats in the corner of the screen.
+// Toggled on/off with F4.
+//
+#pragma once
+#include "Actor.h"
+
+class UILabel;
+
+class DebugOverlay : public Actor
+{
+public:
+	DebugOverlay();
+	
+protected:
+	void OnUpdate(float deltaTime) override;
+	
+private:
+	// Label containing stats text.
+	UILabel* mStatsLabel = nullptr;
+	
+	// Overlay starts hidden.
+	bool mShowStats = false;
+};
@@ -11,6 +11,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "StringUtil.h"
 #include "Type.h"
 
 class Audio;
@@ -35,7 +36,8 @@ private:
 	// But let's do something simple for now.
 	
 	// Need to be able to determine a floor type from a texture name.
-	std::unordered_map<std::string, std::string> mTextureNameToFloorType;
+	// Texture names are case-insensitive (loaded textures have uppercase names, but FLOORMAP uses lowercase).
+	std::unordered_map<std::string, std::string, StringUtil::CaseInsensitiveHash, StringUtil::CaseInsensitiveEquals> mTextureNameToFloorType;
 	
 	// Need to be able to get get audio lists by shoe type.
 	std::unordered_map<std::string, ShoeSounds> mShoeTypeToShoeSounds;
@@ -0,0 +1,90 @@
+//
+// Frustum.cpp
+//
+// Clark Kromenaker
+//
+#include "Frustum.h"
+
+#include "Vector4.h"
+
+Frustum::Frustum(const Matrix4& worldToProjMatrix)
+{
+	// A point is transformed to clip space as (x, y, z, w) = M * p.
+	// The point is in the frustum if -w <= x <= w, -w <= y <= w, and -w <= z <= w (OpenGL clip space).
+	// Each of those six inequalities is a plane, formed by adding or subtracting a row of M from the last row.
+	Vector4 row1, row2, row3, row4;
+	Matrix4 matrix = worldToProjMatrix;
+	matrix.GetRows(row1, row2, row3, row4);
+	
+	Vector4 planes[6] = {
+		row4 + row1,	// Left
+		row4 - row1,	// Right
+		row4 + row2,	// Bottom
+		row4 - row2,	// Top
+		row4 + row3,	// Near
+		row4 - row3		// Far
+	};
+	for(int i = 0; i < 6; ++i)
+	{
+		// Normalize so that signed distances are actual distances.
+		Vector3 normal(planes[i].x, planes[i].y, planes[i].z);
+		float length = normal.GetLength();
+		mPlanes[i] = Plane(normal / length, planes[i].w / length);
+	}
+}
+
+bool Frustum::ContainsPoint(const Vector3& point) const
+{
+	for(int i = 0; i < 6; ++i)
+	{
+		if(mPlanes[i].GetSignedDistance(point) < 0.0f) { return false; }
+	}
+	return true;
+}
+
+bool Frustum::IntersectsAABB(const AABB& aabb) const
+{
+	unsigned int planeMask = kAllPlanes;
+	return IntersectsAABB(aabb, planeMask);
+}
+
+bool Frustum::IntersectsAABB(const AABB& aabb, unsigned int& planeMask) const
+{
+	Vector3 min = aabb.GetMin();
+	Vector3 max = aabb.GetMax();
+	for(int i = 0; i < 6; ++i)
+	{
+		unsigned int planeBit = 1 << i;
+		if((planeMask & planeBit) == 0) { continue; }
+		
+		// The box corner furthest along the plane normal is the most likely to be in front of the plane.
+		// If even that corner is behind the plane, the whole box is outside.
+		const Plane& plane = mPlanes[i];
+		Vector3 furthest(plane.normal.x >= 0.0f ? max.x : min.x,
+						 plane.normal.y >= 0.0f ? max.y : min.y,
+						 plane.normal.z >= 0.0f ? max.z : min.z);
+		if(plane.GetSignedDistance(furthest) < 0.0f) { return false; }
+		
+		// Similarly, if the nearest corner is in front of the plane, the whole box is in front of it.
+		Vector3 nearest(plane.normal.x >= 0.0f ? min.x : max.x,
+						plane.normal.y >= 0.0f ? min.y : max.y,
+						plane.normal.z >= 0.0f ? min.z : max.z);
+		if(plane.GetSignedDistance(nearest) >= 0.0f)
+		{
+			planeMask &= ~planeBit;
+		}
+	}
+	return true;
+}
+
+bool Frustum::operator==(const Frustum& other) const
+{
+	for(int i = 0; i < 6; ++i)
+	{
+		if(mPlanes[i].normal != other.mPlanes[i].normal || mPlanes[i].distance != other.mPlanes[i].distance)
+		{
+			return false;
+		}
+	}
+	return true;
+}
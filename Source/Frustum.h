@@ -0,0 +1,46 @@
+//
+// Frustum.h
+//
+// Clark Kromenaker
+//
+// A view frustum - the volume of space that is visible to a camera.
+// It's represented as six planes (left, right, bottom, top, near, far), with normals facing inward.
+// A point is inside the frustum if it is in front of all six planes.
+//
+// Planes are extracted directly from a world-to-projection matrix.
+// See "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix" (Gribb & Hartmann).
+//
+#pragma once
+#include "AABB.h"
+#include "Matrix4.h"
+#include "Plane.h"
+#include "Vector3.h"
+
+class Frustum
+{
+public:
+	// Bit mask with one bit set for each plane.
+	static const unsigned int kAllPlanes = 0x3F;
+	
+	Frustum() = default;
+	Frustum(const Matrix4& worldToProjMatrix);
+	
+	bool ContainsPoint(const Vector3& point) const;
+	
+	// Returns false if the AABB is definitely outside the frustum.
+	bool IntersectsAABB(const AABB& aabb) const;
+	
+	// Same as above, but only tests planes whose bit is set in the mask.
+	// Bits are cleared for planes that the AABB is completely in front of. Anything inside the AABB
+	// is also in front of those planes, so the updated mask can be passed along when testing contents of the AABB.
+	bool IntersectsAABB(const AABB& aabb, unsigned int& planeMask) const;
+	
+	const Plane& GetPlane(int index) const { return mPlanes[index]; }
+	
+	bool operator==(const Frustum& other) const;
+	bool operator!=(const Frustum& other) const { return !(*this == other); }
+	
+private:
+	// Left, right, bottom, top, near, far.
+	Plane mPlanes[6];
+};
@@ -13,6 +13,7 @@
 #include "CharacterManager.h"
 #include "ConsoleUI.h"
 #include "Debug.h"
+#include "DebugOverlay.h"
 #include "DialogueManager.h"
 #include "FootstepManager.h"
 #include "GameProgress.h"
@@ -22,6 +23,7 @@
 #include "Scene.h"
 #include "Services.h"
 #include "TextInput.h"
+#include "VertexAnimator.h"
 
 GEngine* GEngine::sInstance = nullptr;
 
@@ -31,8 +33,12 @@ GEngine::GEngine()
     sInstance = this;
 }
 
-bool GEngine::Initialize()
+bool GEngine::Initialize(bool headless)
 {    
+	// Start job threads first, so any subsystem can use them.
+	mJobSystem.Initialize();
+	Services::Set<JobSystem>(&mJobSystem);
+	
 	// Initialize reports.
 	Services::SetReports(&mReportManager);
 	
@@ -53,7 +59,7 @@ bool GEngine::Initialize()
     Services::SetInput(&mInputManager);
     
     // Initialize renderer.
-    if(!mRenderer.Initialize())
+    if(!mRenderer.Initialize(headless))
     {
         return false;
     }
@@ -145,6 +151,10 @@ bool GEngine::Initialize()
 	ConsoleUI* consoleUI = new ConsoleUI(false);
 	consoleUI->SetIsDestroyOnLoad(false);
 	
+	// Create debug overlay - also persists for the entire game.
+	DebugOverlay* debugOverlay = new DebugOverlay();
+	debugOverlay->SetIsDestroyOnLoad(false);
+	
 	//TEMP: Load scene as though starting a new game.
 	//TODO: Should really show logos, show title screen, allow restore or new game choice.
 	Services::Get<GameProgress>()->SetTimeblock(Timeblock("110A"));
@@ -187,6 +197,9 @@ void GEngine::Shutdown()
 	}
 	mActors.clear();
 	
+	// Finish any outstanding jobs before shutting down systems they might use.
+	mJobSystem.Shutdown();
+	
     mRenderer.Shutdown();
     mAudioManager.Shutdown();
     
@@ -372,6 +385,9 @@ void GEngine::Update()
         mActors[i]->Update(deltaTime);
     }
 	
+	// Sample vertex animations for all actors at once, so the work can be spread across threads.
+	VertexAnimator::UpdateAll();
+	
 	// Delete any destroyed actors.
 	DeleteDestroyedActors();
     
@@ -14,6 +14,7 @@
 #include "AudioManager.h"
 #include "Console.h"
 #include "InputManager.h"
+#include "JobSystem.h"
 #include "Renderer.h"
 #include "SheepManager.h"
 #include "ReportManager.h"
@@ -30,7 +31,8 @@ public:
     
     GEngine();
     
-    bool Initialize();
+    // If headless, runs without a window or GPU; rendering is only recorded.
+    bool Initialize(bool headless = false);
     void Shutdown();
     void Run();
     
@@ -54,6 +56,7 @@ private:
 	bool mRunning = false;
     
     // Subsystems.
+    JobSystem mJobSystem;
     Renderer mRenderer;
     AudioManager mAudioManager;
     AssetManager mAssetManager;
@@ -26,6 +26,7 @@ GKActor::GKActor() : GKObject(),
 	
 	// Create animation player on the same object as the mesh renderer.
 	mVertexAnimator = mMeshActor->AddComponent<VertexAnimator>();
+	mVertexAnimator->SetPoseAppliedCallback(std::bind(&GKActor::OnVertexAnimationPoseApplied, this));
 	
 	// GasPlayer will go on the actor itself.
 	mGasPlayer = AddComponent<GasPlayer>();
@@ -41,6 +42,7 @@ GKActor::GKActor(const std::string& identifier) : GKObject(),
 	
 	// Create animation player on the same object as the mesh renderer.
     mVertexAnimator = mMeshActor->AddComponent<VertexAnimator>();
+	mVertexAnimator->SetPoseAppliedCallback(std::bind(&GKActor::OnVertexAnimationPoseApplied, this));
 	
 	// GasPlayer will go on the actor itself.
     mGasPlayer = AddComponent<GasPlayer>();
@@ -116,7 +118,9 @@ void GKActor::StartAnimation(VertexAnimation* anim, int framesPerSecond, bool al
 	}
 	
 	// Start the animation.
+	// If the animation moves the actor, it must be sampled every frame, even off screen, so the actor's position stays correct.
 	mVertexAnimator->Start(anim, framesPerSecond, std::bind(&GKActor::OnVertexAnimationStopped, this), time);
+	mVertexAnimator->SetLODEnabled(!mVertexAnimAllowMove);
 }
 
 void GKActor::StartAbsoluteAnimation(VertexAnimation* anim, int framesPerSecond, Vector3 pos, Heading heading, float time, bool fromGas)
@@ -137,8 +141,9 @@ void GKActor::StartAbsoluteAnimation(VertexAnimation* anim, int framesPerSecond,
 		mGasPlayer->Pause();
 	}
 	
-	// Start the animation.
+	// Start the animation. Absolute anims move the actor, so they can't skip samples.
 	mVertexAnimator->Start(anim, framesPerSecond, std::bind(&GKActor::OnVertexAnimationStopped, this), time);
+	mVertexAnimator->SetLODEnabled(false);
 }
 
 void GKActor::StopAnimation(VertexAnimation* anim)
@@ -302,12 +307,8 @@ void GKActor::OnUpdate(float deltaTime)
 	// Stay on the ground.
 	SnapToFloor();
 	
-	// Actor follows mesh during animation.
-	if(mVertexAnimator->IsPlaying() && mVertexAnimAllowMove)//|| (mWalker != nullptr && mWalker->IsWalking()))
-	{
-		SetActorToMeshPosition();
-		SetActorToMeshRotation();
-	}
+	// Following the mesh during animation happens when each pose is applied (see OnVertexAnimationPoseApplied).
+	// Poses are applied after all actors update, so syncing here would always see the previous frame's pose.
 	
     /*
 	if(mMeshRenderer != nullptr)
@@ -317,6 +318,16 @@ void GKActor::OnUpdate(float deltaTime)
     */
 }
 
+void GKActor::OnVertexAnimationPoseApplied()
+{
+	// Actor follows mesh during animation.
+	if(mVertexAnimator->IsPlaying() && mVertexAnimAllowMove)//|| (mWalker != nullptr && mWalker->IsWalking()))
+	{
+		SetActorToMeshPosition();
+		SetActorToMeshRotation();
+	}
+}
+
 void GKActor::OnVertexAnimationStopped()
 {
 	// On anim stop, if vertex anim is not allowed to move actor position,
@@ -346,7 +357,7 @@ void GKActor::SetMeshToActorPosition()
 	if(mCharConfig != nullptr)
 	{
 		// Get hip vertex pos based on values provided by character config. This is in the mesh's local space.
-		Vector3 hipPos = mMeshRenderer->GetMesh(mCharConfig->hipAxesMeshIndex)->GetSubmesh(mCharConfig->hipAxesGroupIndex)->GetVertexPosition(mCharConfig->hipAxesPointIndex);
+		Vector3 hipPos = mMeshRenderer->GetVertexPosition(mCharConfig->hipAxesMeshIndex, mCharConfig->hipAxesGroupIndex, mCharConfig->hipAxesPointIndex);
 		
 		// Convert hip vertex pos to world space.
 		// To do this, we multiply the mesh->local with local->world to get a mesh->world matrix for transforming.
@@ -410,7 +421,7 @@ void GKActor::SetActorToMeshPosition()
 	if(mCharConfig != nullptr)
 	{
 		// Get hip vertex pos based on values provided by character config. This is in the mesh's local space.
-		Vector3 hipPos = mMeshRenderer->GetMesh(mCharConfig->hipAxesMeshIndex)->GetSubmesh(mCharConfig->hipAxesGroupIndex)->GetVertexPosition(mCharConfig->hipAxesPointIndex);
+		Vector3 hipPos = mMeshRenderer->GetVertexPosition(mCharConfig->hipAxesMeshIndex, mCharConfig->hipAxesGroupIndex, mCharConfig->hipAxesPointIndex);
 		
 		// Convert hip vertex pos to world space.
 		// To do this, we multiply the mesh->local with local->world to get a mesh->world matrix for transforming.
@@ -154,6 +154,7 @@ private:
     GAS* mTalkFidget = nullptr;
     GAS* mListenFidget = nullptr;
 	
+	void OnVertexAnimationPoseApplied();
 	void OnVertexAnimationStopped();
 	
 	void SetMeshToActorPosition();
@@ -0,0 +1,250 @@
+//
+// GLState.cpp
+//
+// Clark Kromenaker
+//
+#include "GLState.h"
+
+RenderBackend* GLState::sBackend = nullptr;
+GLStateStats GLState::sStats;
+GLStateStats GLState::sLastFrameStats;
+
+namespace
+{
+	// No GL object ever has this name, so it means "we don't know what's bound."
+	const GLuint kUnknown = 0xFFFFFFFF;
+
+	// Texture targets and units that are tracked. Binds to anything else are always issued.
+	const GLenum kTextureTargets[] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER };
+	const int kTextureTargetCount = sizeof(kTextureTargets) / sizeof(kTextureTargets[0]);
+	const int kTextureUnitCount = 16;
+
+	// Buffer targets that are tracked.
+	const GLenum kBufferTargets[] = { GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_TEXTURE_BUFFER };
+	const int kBufferTargetCount = sizeof(kBufferTargets) / sizeof(kBufferTargets[0]);
+
+	// Capabilities that are tracked.
+	const GLenum kCapabilities[] = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE };
+	const int kCapabilityCount = sizeof(kCapabilities) / sizeof(kCapabilities[0]);
+
+	// Current state, as far as we know.
+	GLuint program = kUnknown;
+	int activeTextureUnit = -1;
+	GLuint textures[kTextureUnitCount][kTextureTargetCount];
+	GLuint vertexArray = kUnknown;
+	GLuint buffers[kBufferTargetCount];
+	int capabilities[kCapabilityCount]; // -1 unknown, 0 disabled, 1 enabled
+	int depthMask = -1;
+	GLenum depthFunc = kUnknown;
+	GLenum blendSourceFactor = kUnknown;
+	GLenum blendDestFactor = kUnknown;
+
+	template<int N> int IndexOf(const GLenum (&values)[N], GLenum value)
+	{
+		for(int i = 0; i < N; ++i)
+		{
+			if(values[i] == value) { return i; }
+		}
+		return -1;
+	}
+}
+
+void GLState::SetBackend(RenderBackend* backend)
+{
+	// A different backend has different state.
+	sBackend = backend;
+	Invalidate();
+}
+
+void GLState::UseProgram(GLuint newProgram)
+{
+	if(program == newProgram) { ++sStats.elided; return; }
+	program = newProgram;
+	sBackend->UseProgram(newProgram);
+	++sStats.issued;
+}
+
+void GLState::ActiveTexture(int textureUnit)
+{
+	if(activeTextureUnit == textureUnit) { ++sStats.elided; return; }
+	activeTextureUnit = textureUnit;
+	sBackend->ActiveTexture(textureUnit);
+	++sStats.issued;
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	// Can only track binds if we know which unit is active.
+	int targetIndex = IndexOf(kTextureTargets, target);
+	if(targetIndex >= 0 && activeTextureUnit >= 0 && activeTextureUnit < kTextureUnitCount)
+	{
+		GLuint& bound = textures[activeTextureUnit][targetIndex];
+		if(bound == texture) { ++sStats.elided; return; }
+		bound = texture;
+	}
+	sBackend->BindTexture(target, texture);
+	++sStats.issued;
+}
+
+void GLState::BindVertexArray(GLuint newVertexArray)
+{
+	if(vertexArray == newVertexArray) { ++sStats.elided; return; }
+	vertexArray = newVertexArray;
+	buffers[IndexOf(kBufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+	sBackend->BindVertexArray(newVertexArray);
+	++sStats.issued;
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+	int targetIndex = IndexOf(kBufferTargets, target);
+	if(targetIndex >= 0)
+	{
+		if(buffers[targetIndex] == buffer) { ++sStats.elided; return; }
+		buffers[targetIndex] = buffer;
+	}
+	sBackend->BindBuffer(target, buffer);
+	++sStats.issued;
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	// Binding to an indexed binding point also binds to the generic binding point.
+	// Indexed bindings are rare (set up once), so they aren't tracked themselves.
+	int targetIndex = IndexOf(kBufferTargets, target);
+	if(targetIndex >= 0)
+	{
+		buffers[targetIndex] = buffer;
+	}
+	sBackend->BindBufferBase(target, index, buffer);
+	++sStats.issued;
+}
+
+void GLState::Enable(GLenum capability)
+{
+	int index = IndexOf(kCapabilities, capability);
+	if(index >= 0)
+	{
+		if(capabilities[index] == 1) { ++sStats.elided; return; }
+		capabilities[index] = 1;
+	}
+	sBackend->Enable(capability);
+	++sStats.issued;
+}
+
+void GLState::Disable(GLenum capability)
+{
+	int index = IndexOf(kCapabilities, capability);
+	if(index >= 0)
+	{
+		if(capabilities[index] == 0) { ++sStats.elided; return; }
+		capabilities[index] = 0;
+	}
+	sBackend->Disable(capability);
+	++sStats.issued;
+}
+
+void GLState::DepthMask(GLboolean enabled)
+{
+	int newDepthMask = enabled ? 1 : 0;
+	if(depthMask == newDepthMask) { ++sStats.elided; return; }
+	depthMask = newDepthMask;
+	sBackend->DepthMask(enabled);
+	++sStats.issued;
+}
+
+void GLState::DepthFunc(GLenum func)
+{
+	if(depthFunc == func) { ++sStats.elided; return; }
+	depthFunc = func;
+	sBackend->DepthFunc(func);
+	++sStats.issued;
+}
+
+void GLState::BlendFunc(GLenum sourceFactor, GLenum destFactor)
+{
+	if(blendSourceFactor == sourceFactor && blendDestFactor == destFactor) { ++sStats.elided; return; }
+	blendSourceFactor = sourceFactor;
+	blendDestFactor = destFactor;
+	sBackend->BlendFunc(sourceFactor, destFactor);
+	++sStats.issued;
+}
+
+void GLState::DeleteProgram(GLuint deletedProgram)
+{
+	// Objects destroyed after the renderer shuts down (e.g. statics) have nothing left to delete from.
+	if(deletedProgram == GL_NONE || sBackend == nullptr) { return; }
+	sBackend->DeleteProgram(deletedProgram);
+
+	// A program that's in use isn't actually deleted until it's no longer in use. But the name can't be used after this.
+	if(program == deletedProgram)
+	{
+		program = kUnknown;
+	}
+}
+
+void GLState::DeleteTexture(GLuint texture)
+{
+	if(texture == GL_NONE || sBackend == nullptr) { return; }
+	sBackend->DeleteTexture(texture);
+	for(auto& unitTextures : textures)
+	{
+		for(auto& bound : unitTextures)
+		{
+			if(bound == texture) { bound = GL_NONE; }
+		}
+	}
+}
+
+void GLState::DeleteVertexArray(GLuint deletedVertexArray)
+{
+	if(deletedVertexArray == GL_NONE || sBackend == nullptr) { return; }
+	sBackend->DeleteVertexArray(deletedVertexArray);
+	if(vertexArray == deletedVertexArray)
+	{
+		vertexArray = GL_NONE;
+		buffers[IndexOf(kBufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+	}
+}
+
+void GLState::DeleteBuffer(GLuint buffer)
+{
+	if(buffer == GL_NONE || sBackend == nullptr) { return; }
+	sBackend->DeleteBuffer(buffer);
+	for(auto& bound : buffers)
+	{
+		if(bound == buffer) { bound = GL_NONE; }
+	}
+}
+
+void GLState::Invalidate()
+{
+	program = kUnknown;
+	activeTextureUnit = -1;
+	for(auto& unitTextures : textures)
+	{
+		for(auto& bound : unitTextures)
+		{
+			bound = kUnknown;
+		}
+	}
+	vertexArray = kUnknown;
+	for(auto& bound : buffers)
+	{
+		bound = kUnknown;
+	}
+	for(auto& enabled : capabilities)
+	{
+		enabled = -1;
+	}
+	depthMask = -1;
+	depthFunc = kUnknown;
+	blendSourceFactor = kUnknown;
+	blendDestFactor = kUnknown;
+}
+
+void GLState::EndFrame()
+{
+	sLastFrameStats = sStats;
+	sStats = GLStateStats();
+}
@@ -0,0 +1,77 @@
+//
+// GLState.h
+//
+// Clark Kromenaker
+//
+// A thin layer over OpenGL state changes that skips redundant calls.
+//
+// OpenGL doesn't check whether a bind or toggle actually changes anything, and the driver overhead of redundant calls adds up.
+// So all engine code should bind programs, textures, VAOs, buffers, and toggle blend/depth state through here.
+// Each function mirrors the GL call it replaces, but only passes it on to the render backend if the cached state differs.
+// Everything else (uploads, draws, shader setup) goes straight to the backend, via GetBackend().
+//
+// If anything changes GL state without going through here, call Invalidate() so the cache doesn't lie.
+//
+#pragma once
+#include <GL/glew.h>
+
+#include "RenderBackend.h"
+
+// Counts of GL state calls over a frame.
+struct GLStateStats
+{
+	// Calls that were passed on to GL.
+	int issued = 0;
+
+	// Calls that were skipped because GL was already in that state.
+	int elided = 0;
+};
+
+class GLState
+{
+public:
+	// The backend that all rendering goes through. Setting it forgets all cached state.
+	// Null after the renderer shuts down; only deletes are allowed then (and do nothing).
+	static void SetBackend(RenderBackend* backend);
+	static RenderBackend* GetBackend() { return sBackend; }
+
+	static void UseProgram(GLuint program);
+
+	// Texture unit is an index (0, 1, 2...), not a GL enum (GL_TEXTURE0...).
+	static void ActiveTexture(int textureUnit);
+
+	// Binds a texture to the active texture unit.
+	static void BindTexture(GLenum target, GLuint texture);
+
+	static void BindVertexArray(GLuint vertexArray);
+
+	// The element array buffer binding is part of VAO state; it's assumed unknown whenever the VAO changes.
+	static void BindBuffer(GLenum target, GLuint buffer);
+	static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+	// Fixed-function state.
+	static void Enable(GLenum capability);
+	static void Disable(GLenum capability);
+	static void DepthMask(GLboolean enabled);
+	static void DepthFunc(GLenum func);
+	static void BlendFunc(GLenum sourceFactor, GLenum destFactor);
+
+	// Deleting a bound object resets its bindings to zero, and the name may be reused later.
+	// These delete through GL, then forget any cached bindings of the deleted object.
+	static void DeleteProgram(GLuint program);
+	static void DeleteTexture(GLuint texture);
+	static void DeleteVertexArray(GLuint vertexArray);
+	static void DeleteBuffer(GLuint buffer);
+
+	// Forgets all cached state, so the next call of each kind is issued no matter what.
+	static void Invalidate();
+
+	// Stats for the most recently finished frame. Call EndFrame once per frame to update them.
+	static void EndFrame();
+	static const GLStateStats& GetFrameStats() { return sLastFrameStats; }
+
+private:
+	static RenderBackend* sBackend;
+	static GLStateStats sStats;
+	static GLStateStats sLastFrameStats;
+};
@@ -11,6 +11,8 @@
 #include "Debug.h"
 #include "GEngine.h"
 #include "GKObject.h"
+#include "Mesh.h"
+#include "Model.h"
 #include "Scene.h"
 #include "Sphere.h"
 #include "StringUtil.h"
@@ -23,6 +25,34 @@ GameCamera::GameCamera()
     AddComponent<AudioListener>();
 }
 
+void GameCamera::SetBounds(Model* boundsModel)
+{
+	mBoundsTriangles.clear();
+	mBoundsBVH.Clear();
+	if(boundsModel == nullptr) { return; }
+	
+	// Bounds model is positioned at (0,0,0) in world space (so no need to multiply local to world...it's identity).
+	// BUT each mesh in the model has its own local coordinate system! Convert triangles to world space once here,
+	// so collision checks don't need to convert the camera position to each mesh's space every frame.
+	for(auto& mesh : boundsModel->GetMeshes())
+	{
+		const Matrix4& meshToLocal = mesh->GetMeshToLocalMatrix();
+		for(auto& submesh : mesh->GetSubmeshes())
+		{
+			int triangleCount = submesh->GetTriangleCount();
+			for(int i = 0; i < triangleCount; ++i)
+			{
+				Vector3 p0, p1, p2;
+				if(submesh->GetTriangle(i, p0, p1, p2))
+				{
+					mBoundsTriangles.emplace_back(meshToLocal.TransformPoint(p0), meshToLocal.TransformPoint(p1), meshToLocal.TransformPoint(p2));
+				}
+			}
+		}
+	}
+	mBoundsBVH.Build(mBoundsTriangles);
+}
+
 void GameCamera::SetAngle(const Vector2& angle)
 {
 	SetAngle(angle.x, angle.y);
@@ -323,65 +353,47 @@ void GameCamera::ResolveCollisions(Vector3& position)
 {
 	// No bounds model = no collision.
 	// Bounds may also be purposely disabled for debugging purposes.
-	if(mBoundsModel == nullptr || !mBoundsEnabled) { return; }
+	if(mBoundsTriangles.empty() || !mBoundsEnabled) { return; }
 	
-	// We'll represent the camera with a sphere and the bounds are a model (triangles).
-	// Iterate and do a collision check against the triangles of the bounds model.
-	auto meshes = mBoundsModel->GetMeshes();
-	for(auto& mesh : meshes)
+	// We'll represent the camera with a sphere and the bounds are triangles.
+	Sphere s(position, kCameraColliderRadius);
+	
+	// Only triangles near the sphere need to be checked. Resolving one intersection pushes the sphere by up to its radius,
+	// so look a radius farther out than the sphere itself, to catch triangles it may be pushed into.
+	const float kQueryExtents = kCameraColliderRadius * 2.0f;
+	AABB queryBox(position, kQueryExtents, kQueryExtents, kQueryExtents);
+	mNearbyBoundsTriangles.clear();
+	mBoundsBVH.QueryOverlaps(queryBox, [this](int triangleIndex) {
+		mNearbyBoundsTriangles.push_back(triangleIndex);
+	});
+	
+	// Test nearby triangles four at a time. The packet test cheaply rejects most of them; any that pass get the full test.
+	int nearbyCount = static_cast<int>(mNearbyBoundsTriangles.size());
+	for(int i = 0; i < nearbyCount; i += 4)
 	{
-		// Bounds model is positioned at (0,0,0) in world space (so no need to multiply local to world...it's identity).
-		// BUT each mesh in the model has its own local coordinate system!
-		// We need to convert camera position to local space of the mesh before doing collision check.
-		Matrix4 meshToLocal = mesh->GetMeshToLocalMatrix();
-        Matrix4 localToMesh = Matrix4::InverseTransform(meshToLocal);
-		Vector3 meshPosition = localToMesh.TransformPoint(position);
-		
-		// Create sphere at position.
-		const float kCameraColliderRadius = 20.0f;
-		Sphere s(meshPosition, kCameraColliderRadius);
+		int laneCount = Math::Min(4, nearbyCount - i);
+		TrianglePacket4 packet;
+		for(int lane = 0; lane < laneCount; lane++)
+		{
+			const Triangle& triangle = mBoundsTriangles[mNearbyBoundsTriangles[i + lane]];
+			packet.Set(lane, triangle.p0, triangle.p1, triangle.p2);
+		}
+		int mayIntersectMask = Collisions::TestSphereTrianglePacket4(s, packet);
 		
-		// Iterate submeshes/submesh triangles.
-		auto submeshes = mesh->GetSubmeshes();
-		for(auto& submesh : submeshes)
+		// Once the sphere is pushed, the packet test results are out of date, so the rest of the packet gets the full test.
+		bool pushed = false;
+		for(int lane = 0; lane < laneCount; lane++)
 		{
-			Vector3 p0, p1, p2;
-			int triangleCount = submesh->GetTriangleCount();
-			for(int i = 0; i < triangleCount; i++)
+			if(!pushed && (mayIntersectMask & (1 << lane)) == 0) { continue; }
+			
+			// If an intersection exists, resolve it by "pushing" position out.
+			Vector3 intersection;
+			if(Collisions::TestSphereTriangle(s, mBoundsTriangles[mNearbyBoundsTriangles[i + lane]], intersection))
 			{
-				if(submesh->GetTriangle(i, p0, p1, p2))
-				{
-					/*
-					if(meshNumber >= 19 && meshNumber <= 22)
-					{
-						Triangle triangle(p0, p1, p2);
-						Vector3 pointOnTriangle = triangle.GetClosestPoint(s.center);
-						Debug::DrawLine(Vector3::Zero, meshToLocal.TransformPoint(pointOnTriangle), Color32::Green);
-					}
-					*/
-					
-					// If an intersection exists, resolve it by "pushing" mesh position out.
-					Vector3 intersection;
-					if(Collisions::TestSphereTriangle(s, Triangle(p0, p1, p2), intersection))
-					{
-						meshPosition += intersection;
-						s = Sphere(meshPosition, kCameraColliderRadius);
-					}
-				}
-				
-				/*
-				Vector3 normal;
-				if(submesh->GetNormal(i, normal))
-				{
-					Vector3 triCenter = meshToLocal.TransformPoint((p0 + p1 + p2) / 3);
-					Debug::DrawLine(triCenter, triCenter + (normal * 10.0f), Color32::Blue);
-				}
-				*/
+				position += intersection;
+				s = Sphere(position, kCameraColliderRadius);
+				pushed = true;
 			}
 		}
-		
-		// We modified the local position while iterating submeshes.
-		// We now need to go back to "world" space.
-		position = meshToLocal.TransformPoint(meshPosition);
 	}
 }
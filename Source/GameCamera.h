@@ -6,7 +6,11 @@
 // Camera used to actually play the game. Obeys all game world laws.
 //
 #pragma once
+#include <vector>
+
 #include "Actor.h"
+#include "BVH.h"
+#include "Triangle.h"
 
 class GKObject;
 class Model;
@@ -16,7 +20,7 @@ class GameCamera : public Actor
 public:
     GameCamera();
 	
-	void SetBounds(Model* boundsModel) { mBoundsModel = boundsModel; }
+	void SetBounds(Model* boundsModel);
 	void SetBoundsEnabled(bool enabled) { mBoundsEnabled = enabled; }
 	
 	void SetAngle(const Vector2& angle);
@@ -50,8 +54,16 @@ private:
 	const float kDefaultHeight = 60.0f;
 	float mHeight = kDefaultHeight;
 	
-	// A model whose triangles are used as collision for the camera.
-	Model* mBoundsModel = nullptr;
+	// Radius of the sphere used as the camera's collider.
+	const float kCameraColliderRadius = 20.0f;
+	
+	// Triangles of a model used as collision for the camera, in world space.
+	// Grouped into a BVH when the bounds are set, so collision only needs to check triangles near the camera.
+	std::vector<Triangle> mBoundsTriangles;
+	BVH mBoundsBVH;
+	
+	// Indexes of bounds triangles near the camera, gathered each time collisions are resolved. Kept to avoid reallocating.
+	std::vector<int> mNearbyBoundsTriangles;
 		
 	// If true, camera bounds are turned on. If false, they are disabled.
     bool mBoundsEnabled = false;
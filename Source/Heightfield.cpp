@@ -0,0 +1,171 @@
+//
+// Heightfield.cpp
+//
+// Clark Kromenaker
+//
+#include "Heightfield.h"
+
+#include <cfloat>
+
+void Heightfield::Build(const std::vector<Triangle>& triangles, const std::vector<int>& surfaceIndexes)
+{
+	mTriangles.clear();
+	mCellOffsets.clear();
+	mCellTriangles.clear();
+	mCellCountX = 0;
+	mCellCountZ = 0;
+
+	// Convert triangles to a form that's quick to query. Also calculate bounds on the X/Z plane.
+	float minX = FLT_MAX;
+	float minZ = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxZ = -FLT_MAX;
+	for(int i = 0; i < triangles.size(); ++i)
+	{
+		const Triangle& triangle = triangles[i];
+
+		// Vertical triangles (walls) have no area when viewed from above - they can't be stood on.
+		Vector3 normal = Vector3::Cross(triangle.p1 - triangle.p0, triangle.p2 - triangle.p0);
+		if(Math::IsZero(normal.y)) { continue; }
+
+		FloorTriangle floorTriangle;
+		floorTriangle.x0 = triangle.p0.x;
+		floorTriangle.z0 = triangle.p0.z;
+		floorTriangle.x1 = triangle.p1.x;
+		floorTriangle.z1 = triangle.p1.z;
+		floorTriangle.x2 = triangle.p2.x;
+		floorTriangle.z2 = triangle.p2.z;
+
+		// Solve the plane equation for y.
+		floorTriangle.heightX = -normal.x / normal.y;
+		floorTriangle.heightZ = -normal.z / normal.y;
+		floorTriangle.heightOffset = triangle.p0.y + (normal.x * triangle.p0.x + normal.z * triangle.p0.z) / normal.y;
+		floorTriangle.surfaceIndex = i < surfaceIndexes.size() ? surfaceIndexes[i] : -1;
+		mTriangles.push_back(floorTriangle);
+
+		minX = Math::Min(minX, Math::Min(triangle.p0.x, Math::Min(triangle.p1.x, triangle.p2.x)));
+		minZ = Math::Min(minZ, Math::Min(triangle.p0.z, Math::Min(triangle.p1.z, triangle.p2.z)));
+		maxX = Math::Max(maxX, Math::Max(triangle.p0.x, Math::Max(triangle.p1.x, triangle.p2.x)));
+		maxZ = Math::Max(maxZ, Math::Max(triangle.p0.z, Math::Max(triangle.p1.z, triangle.p2.z)));
+	}
+	if(mTriangles.empty()) { return; }
+
+	// Pick a cell size that gives roughly one triangle per cell, but don't exceed max cell count on either axis.
+	float sizeX = Math::Max(maxX - minX, 1.0f);
+	float sizeZ = Math::Max(maxZ - minZ, 1.0f);
+	mCellSize = Math::Sqrt((sizeX * sizeZ) / mTriangles.size());
+	mCellSize = Math::Max(mCellSize, Math::Max(sizeX, sizeZ) / kMaxCellsPerAxis);
+	mCellCountX = Math::Clamp(Math::CeilToInt(sizeX / mCellSize), 1, kMaxCellsPerAxis);
+	mCellCountZ = Math::Clamp(Math::CeilToInt(sizeZ / mCellSize), 1, kMaxCellsPerAxis);
+	mMinX = minX;
+	mMinZ = minZ;
+
+	// Helper to get cell range overlapped by a triangle's bounds.
+	auto getCellRange = [this](const FloorTriangle& triangle, int& cellMinX, int& cellMinZ, int& cellMaxX, int& cellMaxZ) {
+		float triMinX = Math::Min(triangle.x0, Math::Min(triangle.x1, triangle.x2));
+		float triMinZ = Math::Min(triangle.z0, Math::Min(triangle.z1, triangle.z2));
+		float triMaxX = Math::Max(triangle.x0, Math::Max(triangle.x1, triangle.x2));
+		float triMaxZ = Math::Max(triangle.z0, Math::Max(triangle.z1, triangle.z2));
+		cellMinX = Math::Clamp(Math::FloorToInt((triMinX - mMinX) / mCellSize), 0, mCellCountX - 1);
+		cellMinZ = Math::Clamp(Math::FloorToInt((triMinZ - mMinZ) / mCellSize), 0, mCellCountZ - 1);
+		cellMaxX = Math::Clamp(Math::FloorToInt((triMaxX - mMinX) / mCellSize), 0, mCellCountX - 1);
+		cellMaxZ = Math::Clamp(Math::FloorToInt((triMaxZ - mMinZ) / mCellSize), 0, mCellCountZ - 1);
+	};
+
+	// First pass: count triangles overlapping each cell.
+	int cellCount = mCellCountX * mCellCountZ;
+	std::vector<int> cellCounts(cellCount, 0);
+	for(auto& triangle : mTriangles)
+	{
+		int cellMinX, cellMinZ, cellMaxX, cellMaxZ;
+		getCellRange(triangle, cellMinX, cellMinZ, cellMaxX, cellMaxZ);
+		for(int z = cellMinZ; z <= cellMaxZ; ++z)
+		{
+			for(int x = cellMinX; x <= cellMaxX; ++x)
+			{
+				++cellCounts[z * mCellCountX + x];
+			}
+		}
+	}
+
+	// Convert counts to offsets.
+	mCellOffsets.resize(cellCount + 1);
+	mCellOffsets[0] = 0;
+	for(int i = 0; i < cellCount; ++i)
+	{
+		mCellOffsets[i + 1] = mCellOffsets[i] + cellCounts[i];
+		cellCounts[i] = 0;
+	}
+
+	// Second pass: place triangle indexes in each cell.
+	mCellTriangles.resize(mCellOffsets[cellCount]);
+	for(int i = 0; i < mTriangles.size(); ++i)
+	{
+		int cellMinX, cellMinZ, cellMaxX, cellMaxZ;
+		getCellRange(mTriangles[i], cellMinX, cellMinZ, cellMaxX, cellMaxZ);
+		for(int z = cellMinZ; z <= cellMaxZ; ++z)
+		{
+			for(int x = cellMinX; x <= cellMaxX; ++x)
+			{
+				int cellIndex = z * mCellCountX + x;
+				mCellTriangles[mCellOffsets[cellIndex] + cellCounts[cellIndex]] = i;
+				++cellCounts[cellIndex];
+			}
+		}
+	}
+}
+
+bool Heightfield::GetHeight(const Vector3& position, float& outHeight) const
+{
+	int surfaceIndex = -1;
+	return GetHeight(position, outHeight, surfaceIndex);
+}
+
+bool Heightfield::GetHeight(const Vector3& position, float& outHeight, int& outSurfaceIndex) const
+{
+	// Can't be any floor if position is outside the grid.
+	int cellIndex = GetCellIndex(position.x, position.z);
+	if(cellIndex < 0) { return false; }
+
+	// Check each triangle overlapping this cell. If position is within the triangle, calculate height.
+	bool found = false;
+	float x = position.x;
+	float z = position.z;
+	for(int i = mCellOffsets[cellIndex]; i < mCellOffsets[cellIndex + 1]; ++i)
+	{
+		const FloorTriangle& triangle = mTriangles[mCellTriangles[i]];
+
+		// Point is inside triangle if it is on the same side of all three edges.
+		// A small tolerance avoids cracks between triangles that share an edge.
+		float e0 = (triangle.x1 - triangle.x0) * (z - triangle.z0) - (triangle.z1 - triangle.z0) * (x - triangle.x0);
+		float e1 = (triangle.x2 - triangle.x1) * (z - triangle.z1) - (triangle.z2 - triangle.z1) * (x - triangle.x1);
+		float e2 = (triangle.x0 - triangle.x2) * (z - triangle.z2) - (triangle.z0 - triangle.z2) * (x - triangle.x2);
+		float tolerance = Math::Abs(e0 + e1 + e2) * 1.0e-5f;
+		bool inside = (e0 >= -tolerance && e1 >= -tolerance && e2 >= -tolerance) ||
+					  (e0 <= tolerance && e1 <= tolerance && e2 <= tolerance);
+		if(!inside) { continue; }
+
+		// When floor triangles overlap, the highest one wins (same as a ray cast straight down would find).
+		float height = triangle.heightX * x + triangle.heightZ * z + triangle.heightOffset;
+		if(!found || height > outHeight)
+		{
+			outHeight = height;
+			outSurfaceIndex = triangle.surfaceIndex;
+			found = true;
+		}
+	}
+	return found;
+}
+
+int Heightfield::GetCellIndex(float x, float z) const
+{
+	if(mCellCountX == 0 || mCellCountZ == 0) { return -1; }
+
+	// Allow positions right on the max edge of the grid.
+	int cellX = Math::FloorToInt((x - mMinX) / mCellSize);
+	int cellZ = Math::FloorToInt((z - mMinZ) / mCellSize);
+	if(cellX == mCellCountX) { cellX = mCellCountX - 1; }
+	if(cellZ == mCellCountZ) { cellZ = mCellCountZ - 1; }
+	if(cellX < 0 || cellZ < 0 || cellX >= mCellCountX || cellZ >= mCellCountZ) { return -1; }
+	return cellZ * mCellCountX + cellX;
+}
@@ -0,0 +1,70 @@
+//
+// Heightfield.h
+//
+// Clark Kromenaker
+//
+// A 2D grid (on the X/Z plane) over a set of floor triangles.
+//
+// Actors need to know the height of the floor beneath them every frame.
+// Casting a ray down against all floor triangles is expensive, so instead
+// the floor triangles are sorted into grid cells at load time. A query then
+// only needs to test the handful of triangles overlapping a single cell.
+//
+// Each triangle also has a surface index, so we can determine what
+// surface (and therefore what texture) is under a certain point.
+//
+#pragma once
+#include <vector>
+
+#include "Triangle.h"
+#include "Vector3.h"
+
+class Heightfield
+{
+public:
+	void Build(const std::vector<Triangle>& triangles, const std::vector<int>& surfaceIndexes);
+
+	// Gets height of the floor at a position (only x/z are used). If multiple triangles overlap, the highest is used.
+	// Returns false if no floor exists at that position.
+	bool GetHeight(const Vector3& position, float& outHeight) const;
+
+	// Same as above, but also outputs the surface index of the triangle beneath the position.
+	bool GetHeight(const Vector3& position, float& outHeight, int& outSurfaceIndex) const;
+
+private:
+	// A triangle, pre-processed for fast height queries.
+	struct FloorTriangle
+	{
+		// Corner positions on the X/Z plane.
+		float x0, z0;
+		float x1, z1;
+		float x2, z2;
+
+		// Height at any point on the triangle is (heightX * x) + (heightZ * z) + heightOffset.
+		float heightX = 0.0f;
+		float heightZ = 0.0f;
+		float heightOffset = 0.0f;
+
+		// Surface this triangle belongs to.
+		int surfaceIndex = -1;
+	};
+
+	// Max number of cells on each axis, to keep memory use reasonable for very large floors.
+	static const int kMaxCellsPerAxis = 256;
+
+	// Triangles that make up the floor.
+	std::vector<FloorTriangle> mTriangles;
+
+	// Grid min corner (on X/Z plane), cell size, and cell counts.
+	float mMinX = 0.0f;
+	float mMinZ = 0.0f;
+	float mCellSize = 1.0f;
+	int mCellCountX = 0;
+	int mCellCountZ = 0;
+
+	// Each cell has an offset into the cell triangle list. Cell "i" triangles are from mCellOffsets[i] to mCellOffsets[i + 1].
+	std::vector<int> mCellOffsets;
+	std::vector<int> mCellTriangles;
+
+	int GetCellIndex(float x, float z) const;
+};
@@ -0,0 +1,327 @@
+//
+// JobSystem.cpp
+//
+// Clark Kromenaker
+//
+#include "JobSystem.h"
+
+#include <cassert>
+
+TYPE_DEF_BASE(JobSystem);
+
+namespace
+{
+	// The job system and worker index of the current thread.
+	thread_local JobSystem* currentJobSystem = nullptr;
+	thread_local int currentWorkerIndex = 0;
+}
+
+void JobSystem::Initialize(int workerCount)
+{
+	// Leave one hardware thread for the main thread.
+	if(workerCount < 0)
+	{
+		workerCount = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+		if(workerCount < 0) { workerCount = 0; }
+	}
+
+	// The calling thread is worker zero.
+	currentJobSystem = this;
+	currentWorkerIndex = 0;
+
+	// Create all workers before starting threads, so threads can safely steal from any worker.
+	mStopping = false;
+	for(int i = 0; i <= workerCount; ++i)
+	{
+		mWorkers.push_back(std::make_unique<Worker>());
+	}
+	for(int i = 1; i <= workerCount; ++i)
+	{
+		mWorkers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	if(mWorkers.empty()) { return; }
+
+	// Wake up workers and let them exit.
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mStopping = true;
+	}
+	mSleepCondition.notify_all();
+	for(auto& worker : mWorkers)
+	{
+		if(worker->thread.joinable())
+		{
+			worker->thread.join();
+		}
+	}
+
+	// Anything still queued runs on this thread.
+	while(Job* job = GetJob(0))
+	{
+		Execute(job);
+	}
+	mWorkers.clear();
+
+	if(currentJobSystem == this)
+	{
+		currentJobSystem = nullptr;
+	}
+}
+
+JobSystem::Job* JobSystem::CreateJob(std::function<void()> function, Job* parent)
+{
+	Job* job = AllocateJob(GetCurrentWorkerIndex());
+	job->function = std::move(function);
+	job->parent = parent;
+	job->unfinishedCount = 1;
+	job->pendingCount = 1;
+	job->referenceCount = 2;
+	job->dependentsReleased = false;
+
+	// Parent can't finish until this job finishes.
+	if(parent != nullptr)
+	{
+		++parent->unfinishedCount;
+	}
+	return job;
+}
+
+void JobSystem::AddDependency(Job* job, Job* dependsOn)
+{
+	// If the other job already finished, there's nothing to wait for.
+	std::lock_guard<std::mutex> lock(dependsOn->dependentsMutex);
+	if(!dependsOn->dependentsReleased)
+	{
+		++job->pendingCount;
+		dependsOn->dependents.push_back(job);
+	}
+}
+
+void JobSystem::Run(Job* job)
+{
+	// Queue if this was the last thing the job was waiting for.
+	if(--job->pendingCount == 0)
+	{
+		Submit(job);
+	}
+}
+
+void JobSystem::Wait(Job* job)
+{
+	// Rather than sit idle, run other jobs until this one is finished.
+	int workerIndex = GetCurrentWorkerIndex();
+	while(!IsFinished(job))
+	{
+		Job* otherJob = GetJob(workerIndex);
+		if(otherJob != nullptr)
+		{
+			Execute(otherJob);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	Release(job);
+}
+
+void JobSystem::Release(Job* job)
+{
+	if(--job->referenceCount == 0)
+	{
+		FreeJob(job);
+	}
+}
+
+bool JobSystem::IsFinished(const Job* job) const
+{
+	return job->unfinishedCount == 0;
+}
+
+void JobSystem::ParallelFor(int count, int batchSize, const std::function<void(int start, int end)>& function)
+{
+	if(count <= 0) { return; }
+	if(batchSize < 1) { batchSize = 1; }
+
+	// One child job per batch, all under an empty parent job.
+	Job* parent = CreateJob(nullptr);
+	for(int start = 0; start < count; start += batchSize)
+	{
+		int end = start + batchSize < count ? start + batchSize : count;
+		Job* job = CreateJob([&function, start, end]() { function(start, end); }, parent);
+		Run(job);
+		Release(job);
+	}
+	Run(parent);
+	Wait(parent);
+}
+
+void JobSystem::WorkerLoop(int workerIndex)
+{
+	currentJobSystem = this;
+	currentWorkerIndex = workerIndex;
+	while(true)
+	{
+		Job* job = GetJob(workerIndex);
+		if(job != nullptr)
+		{
+			Execute(job);
+			continue;
+		}
+
+		// Nothing to do - sleep until a job is queued or we're stopping.
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mSleepCondition.wait(lock, [this]() { return mQueuedJobCount > 0 || mStopping; });
+		if(mStopping && mQueuedJobCount == 0) { break; }
+	}
+}
+
+JobSystem::Job* JobSystem::AllocateJob(int workerIndex)
+{
+	Worker& worker = *mWorkers[workerIndex];
+
+	// Reclaim jobs freed by other workers, or allocate more if there are none.
+	if(worker.freeJobs == nullptr)
+	{
+		worker.freeJobs = worker.remoteFreeJobs.exchange(nullptr);
+	}
+	if(worker.freeJobs == nullptr)
+	{
+		Job* chunk = new Job[kJobChunkSize];
+		worker.jobChunks.emplace_back(chunk);
+		for(int i = 0; i < kJobChunkSize; ++i)
+		{
+			chunk[i].ownerIndex = workerIndex;
+			chunk[i].nextFree = i + 1 < kJobChunkSize ? &chunk[i + 1] : nullptr;
+		}
+		worker.freeJobs = chunk;
+	}
+
+	Job* job = worker.freeJobs;
+	worker.freeJobs = job->nextFree;
+	job->nextFree = nullptr;
+	return job;
+}
+
+void JobSystem::FreeJob(Job* job)
+{
+	// Clear out anything the job is holding onto.
+	job->function = nullptr;
+	job->parent = nullptr;
+	job->dependents.clear();
+
+	// The owner can put the job right back in its free list. Anyone else must use the remote free list.
+	Worker& owner = *mWorkers[job->ownerIndex];
+	if(job->ownerIndex == GetCurrentWorkerIndex())
+	{
+		job->nextFree = owner.freeJobs;
+		owner.freeJobs = job;
+	}
+	else
+	{
+		job->nextFree = owner.remoteFreeJobs.load();
+		while(!owner.remoteFreeJobs.compare_exchange_weak(job->nextFree, job)) { }
+	}
+}
+
+void JobSystem::Submit(Job* job)
+{
+	// With no worker threads, just run the job now.
+	if(mWorkers.size() <= 1)
+	{
+		Execute(job);
+		return;
+	}
+
+	Worker& worker = *mWorkers[GetCurrentWorkerIndex()];
+	{
+		std::lock_guard<std::mutex> lock(worker.queueMutex);
+		worker.queue.push_back(job);
+	}
+
+	// Locking the sleep mutex ensures a worker that's about to sleep sees the new job.
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		++mQueuedJobCount;
+	}
+	mSleepCondition.notify_one();
+}
+
+JobSystem::Job* JobSystem::GetJob(int workerIndex)
+{
+	if(mQueuedJobCount == 0) { return nullptr; }
+
+	// Newest job from our own queue is most likely to have its data in cache.
+	Worker& worker = *mWorkers[workerIndex];
+	{
+		std::lock_guard<std::mutex> lock(worker.queueMutex);
+		if(!worker.queue.empty())
+		{
+			Job* job = worker.queue.back();
+			worker.queue.pop_back();
+			--mQueuedJobCount;
+			return job;
+		}
+	}
+
+	// Otherwise, steal oldest job from another worker. Older jobs tend to be bigger (e.g. parents that spawn more jobs).
+	int workerCount = static_cast<int>(mWorkers.size());
+	for(int i = 1; i < workerCount; ++i)
+	{
+		Worker& victim = *mWorkers[(workerIndex + i) % workerCount];
+		std::lock_guard<std::mutex> lock(victim.queueMutex);
+		if(!victim.queue.empty())
+		{
+			Job* job = victim.queue.front();
+			victim.queue.pop_front();
+			--mQueuedJobCount;
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	if(job->function != nullptr)
+	{
+		job->function();
+	}
+	Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+	// Not finished until all children are finished too.
+	if(--job->unfinishedCount != 0) { return; }
+
+	// Let dependents know. No more dependents can be added after this.
+	std::vector<Job*> dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->dependentsMutex);
+		job->dependentsReleased = true;
+		dependents.swap(job->dependents);
+	}
+	for(Job* dependent : dependents)
+	{
+		Run(dependent);
+	}
+
+	// Parent may be finished now too.
+	if(job->parent != nullptr)
+	{
+		Finish(job->parent);
+	}
+	Release(job);
+}
+
+int JobSystem::GetCurrentWorkerIndex() const
+{
+	// Only the main thread and worker threads can use the job system.
+	assert(currentJobSystem == this);
+	return currentWorkerIndex;
+}
@@ -0,0 +1,137 @@
+//
+// JobSystem.h
+//
+// Clark Kromenaker
+//
+// Runs small units of work ("jobs") on a pool of worker threads.
+//
+// Each worker (including the main thread) has its own job queue. Jobs are pushed to and popped from the back of the
+// current thread's queue. When a thread runs out of work, it steals from the front of another thread's queue.
+//
+// Jobs can have a parent: a parent isn't finished until all its children are finished, so waiting on a parent
+// waits on everything spawned from it (fork/join). Jobs can also depend on other jobs: a job doesn't start until
+// every job it depends on has finished.
+//
+// Usage:
+//	Job* job = jobSystem->CreateJob([]() { ... });
+//	jobSystem->Run(job);
+//	jobSystem->Wait(job); // Or Release(job) if you don't need to wait.
+//
+// Only the thread that called Initialize (the main thread) and jobs themselves should use the job system.
+//
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Type.h"
+
+class JobSystem
+{
+	TYPE_DECL_BASE();
+public:
+	struct Job;
+
+	// Starts worker threads. If worker count is negative, uses one worker per spare hardware thread.
+	// With zero workers, jobs run on the main thread.
+	void Initialize(int workerCount = -1);
+
+	// Finishes any remaining jobs and stops worker threads.
+	void Shutdown();
+
+	// Creates a job that runs a function. If a parent is specified, the parent won't finish until this job finishes.
+	// Children must be created before their parent finishes - either before the parent runs, or by the parent itself.
+	Job* CreateJob(std::function<void()> function, Job* parent = nullptr);
+
+	// Makes a job wait until another job finishes before it starts. Must be called before the job is run.
+	void AddDependency(Job* job, Job* dependsOn);
+
+	// Queues a job to run once its dependencies are finished.
+	void Run(Job* job);
+
+	// Waits until a job (and its children) are finished, helping with other jobs in the meantime.
+	// Afterwards, the job can no longer be used.
+	void Wait(Job* job);
+
+	// Lets go of a job without waiting for it. Afterwards, the job can no longer be used.
+	void Release(Job* job);
+
+	// Returns true if a job and all of its children are finished.
+	bool IsFinished(const Job* job) const;
+
+	// Calls a function for batches of indexes in [0, count), spread across workers. Returns when all batches are done.
+	void ParallelFor(int count, int batchSize, const std::function<void(int start, int end)>& function);
+
+	// Number of threads that can run jobs, including the main thread.
+	int GetThreadCount() const { return static_cast<int>(mWorkers.size()); }
+
+private:
+	// Each worker allocates jobs in chunks of this many.
+	static const int kJobChunkSize = 64;
+
+	// A job thread, with its own queue and job allocator. The main thread is worker zero, but doesn't have a thread.
+	struct Worker
+	{
+		std::thread thread;
+
+		// Queue of jobs ready to run. The owner uses the back; other workers steal from the front.
+		std::mutex queueMutex;
+		std::deque<Job*> queue;
+
+		// Jobs allocated by this worker that are free for reuse.
+		// Only the owner uses the free list. Other workers return jobs to the "remote" free list.
+		Job* freeJobs = nullptr;
+		std::atomic<Job*> remoteFreeJobs { nullptr };
+		std::vector<std::unique_ptr<Job[]>> jobChunks;
+	};
+	std::vector<std::unique_ptr<Worker>> mWorkers;
+
+	// Number of jobs waiting in all queues. Workers sleep when there's nothing to do.
+	std::atomic<int> mQueuedJobCount { 0 };
+	std::mutex mSleepMutex;
+	std::condition_variable mSleepCondition;
+
+	// Set during shutdown to tell workers to exit.
+	std::atomic<bool> mStopping { false };
+
+	void WorkerLoop(int workerIndex);
+
+	Job* AllocateJob(int workerIndex);
+	void FreeJob(Job* job);
+
+	void Submit(Job* job);
+	Job* GetJob(int workerIndex);
+	void Execute(Job* job);
+	void Finish(Job* job);
+
+	int GetCurrentWorkerIndex() const;
+};
+
+struct JobSystem::Job
+{
+	std::function<void()> function;
+	Job* parent = nullptr;
+
+	// One for the job itself, plus one per unfinished child. Job is finished at zero.
+	std::atomic<int> unfinishedCount { 0 };
+
+	// One until the job is run, plus one per unfinished dependency. Job is queued at zero.
+	std::atomic<int> pendingCount { 0 };
+
+	// One for whoever created the job, plus one until the job is finished. Job is freed at zero.
+	std::atomic<int> referenceCount { 0 };
+
+	// Jobs that depend on this one.
+	std::mutex dependentsMutex;
+	std::vector<Job*> dependents;
+	bool dependentsReleased = false;
+
+	// Worker that allocated this job, and next free job when in a free list.
+	int ownerIndex = 0;
+	Job* nextFree = nullptr;
+};
@@ -8,14 +8,26 @@
 #define SDL_MAIN_HANDLED // For Windows: we provide our own main, so use that!
 #include "GEngine.h"
 
+#include <cstring>
+
 int main(int argc, const char* argv[])
 {
     // Create the engine.
 	GEngine engine;
 	
+	// "-headless" runs without a window or GPU (e.g. to measure rendering cost on build machines).
+	bool headless = false;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "-headless") == 0)
+		{
+			headless = true;
+		}
+	}
+	
     // If init succeeds, we can "run" the engine.
     // If init fails, the program ends immediately.
-	bool initSucceeded = engine.Initialize();
+	bool initSucceeded = engine.Initialize(headless);
     if(initSucceeded)
     {
         engine.Run();
@@ -5,6 +5,7 @@
 //
 #include "Material.h"
 
+#include "GLState.h"
 #include "Matrix4.h"
 #include "Shader.h"
 #include "Texture.h"
@@ -17,14 +18,19 @@ Matrix4 Material::sCurrentProjMatrix;
 
 float Material::sAlphaTestValue = 0.0f;
 
+GLuint Material::sCameraUniformBuffer = GL_NONE;
+bool Material::sCameraUniformsDirty = true;
+
 void Material::SetViewMatrix(const Matrix4& viewMatrix)
 {
 	sCurrentViewMatrix = viewMatrix;
+	sCameraUniformsDirty = true;
 }
 
 void Material::SetProjMatrix(const Matrix4& projMatrix)
 {
 	sCurrentProjMatrix = projMatrix;
+	sCameraUniformsDirty = true;
 }
 
 void Material::UseAlphaTest(bool use)
@@ -48,51 +54,109 @@ void Material::Activate(const Matrix4& objectToWorldMatrix)
     // See https://stackoverflow.com/questions/42357380/why-must-i-use-a-shader-program-before-i-can-set-its-uniforms
     mShader->Activate();
     
-	// Set built-in transform matrices.
-    mShader->SetUniformMatrix4("gObjectToWorldMatrix", objectToWorldMatrix);
-    mShader->SetUniformMatrix4("gViewMatrix", sCurrentViewMatrix);
-    mShader->SetUniformMatrix4("gProjMatrix", sCurrentProjMatrix);
-	mShader->SetUniformMatrix4("gWorldToProjMatrix", sCurrentProjMatrix * sCurrentViewMatrix);
+	// Camera matrices only change a few times per frame, so they're uploaded once for all shaders.
+	UpdateCameraUniformBuffer();
+	
+	// Uniform locations are looked up once per shader, not every activation.
+	if(mUniformLocationsShader != mShader)
+	{
+		RefreshUniformLocations();
+	}
+	
+	// Set built-in transform matrix and alpha test value.
+	mShader->SetUniformMatrix4(mShader->GetUniformLocation(BuiltInUniform::ObjectToWorldMatrix), objectToWorldMatrix);
+	mShader->SetUniformFloat(mShader->GetUniformLocation(BuiltInUniform::AlphaTest), sAlphaTestValue);
 	
-	// Set built-in alpha test value.
-	mShader->SetUniformFloat("gAlphaTest", sAlphaTestValue);
+	// Vertex animation is off unless the renderer turns it on after activating the material.
+	// Not instanced unless activated for an instanced draw.
+	mShader->SetUniformInt(mShader->GetUniformLocation(BuiltInUniform::VertexAnimationEnabled), 0);
+	mShader->SetUniformInt(mShader->GetUniformLocation(BuiltInUniform::Instanced), 0);
 	
     // Set user-defined color values.
-    for(auto& entry : mColors)
+    for(auto& color : mColors)
     {
-        mShader->SetUniformColor(entry.first.c_str(), entry.second);
+        mShader->SetUniformColor(color.location, color.color);
     }
     
     // Set user-defined textures.
     int textureUnit = 0;
-    for(auto& entry : mTextures)
+    for(auto& texture : mTextures)
     {
-        mShader->SetUniformInt(entry.first.c_str(), textureUnit);
-        entry.second->Activate(textureUnit);
+        mShader->SetUniformInt(texture.location, textureUnit);
+        texture.texture->Activate(textureUnit);
         ++textureUnit;
     }
     
 	//TODO: May need to "deactivate" texture units if no texture is defined in material, but a texture sampler exists in the shader.
 }
 
+void Material::ActivateInstanced()
+{
+	Activate(Matrix4::Identity);
+	mShader->SetUniformInt(mShader->GetUniformLocation(BuiltInUniform::Instanced), 1);
+}
+
+bool Material::operator==(const Material& other) const
+{
+	if(mShader != other.mShader) { return false; }
+	if(mColors.size() != other.mColors.size() || mTextures.size() != other.mTextures.size()) { return false; }
+	for(int i = 0; i < mColors.size(); ++i)
+	{
+		if(mColors[i].name != other.mColors[i].name || mColors[i].color != other.mColors[i].color) { return false; }
+	}
+	for(int i = 0; i < mTextures.size(); ++i)
+	{
+		if(mTextures[i].name != other.mTextures[i].name || mTextures[i].texture != other.mTextures[i].texture) { return false; }
+	}
+	return true;
+}
+
 void Material::SetColor(const std::string& name, const Color32& color)
 {
-    mColors[name] = color;
+	for(auto& entry : mColors)
+	{
+		if(entry.name == name)
+		{
+			entry.color = color;
+			return;
+		}
+	}
+	
+	// New uniform - its location is looked up on next activation.
+	mColors.emplace_back();
+	mColors.back().name = name;
+	mColors.back().color = color;
+	mUniformLocationsShader = nullptr;
 }
 
 void Material::SetTexture(const std::string& name, Texture* texture)
 {
-    mTextures[name] = texture;
+	for(auto& entry : mTextures)
+	{
+		if(entry.name == name)
+		{
+			entry.texture = texture;
+			return;
+		}
+	}
+	
+	// New uniform - its location is looked up on next activation.
+	mTextures.emplace_back();
+	mTextures.back().name = name;
+	mTextures.back().texture = texture;
+	mUniformLocationsShader = nullptr;
 }
 
 Texture* Material::GetTexture(const std::string& name) const
 {
-    auto it = mTextures.find(name);
-    if(it != mTextures.end())
-    {
-        return it->second;
-    }
-    return nullptr;
+	for(auto& entry : mTextures)
+	{
+		if(entry.name == name)
+		{
+			return entry.texture;
+		}
+	}
+	return nullptr;
 }
 
 bool Material::IsTranslucent()
@@ -100,3 +164,37 @@ bool Material::IsTranslucent()
 	//TODO: Maybe use render queue value for this?
 	return false;
 }
+
+void Material::UpdateCameraUniformBuffer()
+{
+	if(!sCameraUniformsDirty) { return; }
+	sCameraUniformsDirty = false;
+	RenderBackend* backend = GLState::GetBackend();
+	
+	// Create the buffer the first time, and bind it to the binding point that shaders' camera uniform blocks use.
+	if(sCameraUniformBuffer == GL_NONE)
+	{
+		sCameraUniformBuffer = backend->CreateBuffer();
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, sCameraUniformBuffer);
+		backend->BufferData(GL_UNIFORM_BUFFER, 3 * sizeof(Matrix4), nullptr, GL_DYNAMIC_DRAW);
+		GLState::BindBufferBase(GL_UNIFORM_BUFFER, Shader::kCameraUniformBlockBinding, sCameraUniformBuffer);
+	}
+	
+	// Matrices are in the same order as the uniform block. With std140 layout, each matrix is 64 bytes with no padding.
+	Matrix4 matrices[3] = { sCurrentViewMatrix, sCurrentProjMatrix, sCurrentProjMatrix * sCurrentViewMatrix };
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, sCameraUniformBuffer);
+	backend->BufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(matrices), matrices);
+}
+
+void Material::RefreshUniformLocations()
+{
+	mUniformLocationsShader = mShader;
+	for(auto& color : mColors)
+	{
+		color.location = mShader->GetUniformLocation(color.name.c_str());
+	}
+	for(auto& texture : mTextures)
+	{
+		texture.location = mShader->GetUniformLocation(texture.name.c_str());
+	}
+}
@@ -7,9 +7,11 @@
 // It indicates the shader to use and any input parameters for the shader (texture, color, etc).
 //
 #pragma once
-#include <unordered_map>
+#include <string>
 #include <vector>
 
+#include <GL/glew.h>
+
 #include "Color32.h"
 #include "Matrix4.h"
 
@@ -20,6 +22,12 @@ class Material
 {
 public:
     static Shader* sDefaultShader;
+	
+	// Texture unit reserved for vertex animation keyframes, so it never collides with material textures.
+	static const int kVertexAnimationTextureUnit = 7;
+	
+	// View and projection matrices are shared by all materials.
+	// They're uploaded to a uniform buffer when the next material is activated, rather than on every activation.
 	static void SetViewMatrix(const Matrix4& viewMatrix);
 	static void SetProjMatrix(const Matrix4& projMatrix);
 	static void UseAlphaTest(bool use);
@@ -29,6 +37,13 @@ public:
     
 	void Activate(const Matrix4& objectToWorldMatrix);
 	
+	// Activates for an instanced draw, where each instance's object to world matrix comes from an instance buffer.
+	void ActivateInstanced();
+	
+	// Materials are equal if they use the same shader, colors, and textures. Submeshes with equal materials can be drawn together.
+	bool operator==(const Material& other) const;
+	bool operator!=(const Material& other) const { return !(*this == other); }
+	
     void SetShader(Shader* shader) { mShader = shader; }
     Shader* GetShader() const { return mShader; }
     
@@ -51,11 +66,34 @@ private:
 	static Matrix4 sCurrentProjMatrix;
 	static float sAlphaTestValue;
 	
+	// Uniform buffer holding camera matrices, and whether the matrices changed since they were last uploaded.
+	static GLuint sCameraUniformBuffer;
+	static bool sCameraUniformsDirty;
+	
     // Shader to use.
     Shader* mShader = nullptr;
     
-    std::unordered_map<std::string, Color32> mColors;
-    std::unordered_map<std::string, Texture*> mTextures;
+    // User-defined uniform values, along with their locations in the shader.
+    struct ColorUniform
+    {
+        std::string name;
+        GLint location = -1;
+        Color32 color;
+    };
+    struct TextureUniform
+    {
+        std::string name;
+        GLint location = -1;
+        Texture* texture = nullptr;
+    };
+    std::vector<ColorUniform> mColors;
+    std::vector<TextureUniform> mTextures;
+    
+    // Shader that uniform locations were looked up for. If the shader changes, or uniforms are added, they're looked up again.
+    Shader* mUniformLocationsShader = nullptr;
+    
+    static void UpdateCameraUniformBuffer();
+    void RefreshUniformLocations();
     
     //TODO: Opaque vs. transparent? Render queue value?
 };
@@ -0,0 +1,273 @@
+//
+// MeshOptimizer.cpp
+//
+// Clark Kromenaker
+//
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+#include "GMath.h"
+
+namespace
+{
+	// Size of simulated FIFO cache used to measure ACMR. Roughly matches common hardware.
+	const int kFifoCacheSize = 16;
+
+	// Size of simulated LRU cache used when scoring vertices, and tuning values for scoring.
+	// These are the values suggested by Forsyth.
+	const int kScoreCacheSize = 32;
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+
+	// Vertices used by many triangles get a boost, but only up to this many.
+	const int kMaxValenceScore = 32;
+
+	// Totals for all meshes optimized so far.
+	MeshOptimizer::Stats stats;
+
+	int CountCacheMisses(const unsigned short* indexes, int indexCount, int vertexCount)
+	{
+		// A vertex is in the cache if fewer than "cache size" misses happened since it was last loaded.
+		std::vector<int> timestamps(vertexCount, 0);
+		int timestamp = kFifoCacheSize + 1;
+		int misses = 0;
+		for(int i = 0; i < indexCount; ++i)
+		{
+			int index = indexes[i];
+			if(index >= vertexCount)
+			{
+				++misses;
+			}
+			else if(timestamp - timestamps[index] > kFifoCacheSize)
+			{
+				timestamps[index] = timestamp;
+				++timestamp;
+				++misses;
+			}
+		}
+		return misses;
+	}
+
+	// Score tables, so we don't need to calculate pow each time a vertex score changes.
+	struct ScoreTables
+	{
+		float cachePositionScores[kScoreCacheSize];
+		float valenceScores[kMaxValenceScore + 1];
+
+		ScoreTables()
+		{
+			for(int i = 0; i < kScoreCacheSize; ++i)
+			{
+				// Vertices used by the last triangle get a fixed score, so we don't favor any particular one.
+				if(i < 3)
+				{
+					cachePositionScores[i] = kLastTriangleScore;
+				}
+				else
+				{
+					float scaler = 1.0f / (kScoreCacheSize - 3);
+					cachePositionScores[i] = Math::Pow(1.0f - (i - 3) * scaler, kCacheDecayPower);
+				}
+			}
+
+			// Boost vertices with few remaining triangles, so we finish them off and avoid leaving lone triangles behind.
+			valenceScores[0] = 0.0f;
+			for(int i = 1; i <= kMaxValenceScore; ++i)
+			{
+				valenceScores[i] = kValenceBoostScale * Math::Pow(static_cast<float>(i), -kValenceBoostPower);
+			}
+		}
+	};
+
+	float GetVertexScore(const ScoreTables& tables, int cachePosition, int remainingTriangles)
+	{
+		// Vertex isn't used by any more triangles.
+		if(remainingTriangles == 0) { return -1.0f; }
+
+		float score = cachePosition >= 0 ? tables.cachePositionScores[cachePosition] : 0.0f;
+		return score + tables.valenceScores[Math::Min(remainingTriangles, kMaxValenceScore)];
+	}
+}
+
+float MeshOptimizer::CalculateACMR(const unsigned short* indexes, int indexCount, int vertexCount)
+{
+	int triangleCount = indexCount / 3;
+	if(triangleCount == 0) { return 0.0f; }
+	return static_cast<float>(CountCacheMisses(indexes, triangleCount * 3, vertexCount)) / triangleCount;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned short* indexes, int indexCount, int vertexCount)
+{
+	int triangleCount = indexCount / 3;
+	if(triangleCount == 0 || vertexCount <= 0) { return; }
+	indexCount = triangleCount * 3;
+
+	// Count triangles using each vertex. Don't try to optimize a mesh with out of range indexes.
+	std::vector<int> remainingTriangles(vertexCount, 0);
+	for(int i = 0; i < indexCount; ++i)
+	{
+		if(indexes[i] >= vertexCount) { return; }
+		++remainingTriangles[indexes[i]];
+	}
+	int missesBefore = CountCacheMisses(indexes, indexCount, vertexCount);
+
+	// Build list of triangles using each vertex. Vertex "v" triangles are from offsets[v] to offsets[v] + remainingTriangles[v].
+	// As triangles are emitted, they're removed from the end of this range.
+	std::vector<int> offsets(vertexCount + 1, 0);
+	for(int i = 0; i < vertexCount; ++i)
+	{
+		offsets[i + 1] = offsets[i] + remainingTriangles[i];
+	}
+	std::vector<int> vertexTriangles(indexCount);
+	std::vector<int> fillCounts(vertexCount, 0);
+	for(int i = 0; i < indexCount; ++i)
+	{
+		int vertexIndex = indexes[i];
+		vertexTriangles[offsets[vertexIndex] + fillCounts[vertexIndex]] = i / 3;
+		++fillCounts[vertexIndex];
+	}
+
+	// Calculate initial vertex and triangle scores. Nothing is in the cache yet.
+	static const ScoreTables scoreTables;
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for(int i = 0; i < vertexCount; ++i)
+	{
+		vertexScores[i] = GetVertexScore(scoreTables, -1, remainingTriangles[i]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		triangleScores[i] = vertexScores[indexes[i * 3]] + vertexScores[indexes[i * 3 + 1]] + vertexScores[indexes[i * 3 + 2]];
+	}
+
+	// Each step, emit the highest scoring triangle that uses a cached vertex.
+	std::vector<unsigned short> output;
+	output.reserve(indexCount);
+	std::vector<bool> emitted(triangleCount, false);
+	int cache[kScoreCacheSize + 3];
+	int newCache[kScoreCacheSize + 3];
+	int cacheCount = 0;
+	int bestTriangle = -1;
+	int nextUnemittedTriangle = 0;
+	for(int emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// If no cached vertices are used by remaining triangles, just start again at the next triangle in the original order.
+		if(bestTriangle < 0)
+		{
+			while(emitted[nextUnemittedTriangle]) { ++nextUnemittedTriangle; }
+			bestTriangle = nextUnemittedTriangle;
+		}
+
+		// Emit the triangle, and remove it from each vertex's triangle list.
+		emitted[bestTriangle] = true;
+		int newCacheCount = 0;
+		for(int i = 0; i < 3; ++i)
+		{
+			int vertexIndex = indexes[bestTriangle * 3 + i];
+			output.push_back(static_cast<unsigned short>(vertexIndex));
+
+			int start = offsets[vertexIndex];
+			int end = start + remainingTriangles[vertexIndex];
+			for(int j = start; j < end; ++j)
+			{
+				if(vertexTriangles[j] == bestTriangle)
+				{
+					std::swap(vertexTriangles[j], vertexTriangles[end - 1]);
+					break;
+				}
+			}
+			--remainingTriangles[vertexIndex];
+
+			// Emitted triangle's vertices go to the front of the cache. Degenerate triangles might use the same vertex twice.
+			bool inCache = false;
+			for(int j = 0; j < newCacheCount; ++j)
+			{
+				inCache |= newCache[j] == vertexIndex;
+			}
+			if(!inCache)
+			{
+				newCache[newCacheCount++] = vertexIndex;
+			}
+		}
+
+		// Everything else in the cache moves back.
+		int triangleVertexCount = newCacheCount;
+		for(int i = 0; i < cacheCount; ++i)
+		{
+			bool inTriangle = false;
+			for(int j = 0; j < triangleVertexCount; ++j)
+			{
+				inTriangle |= newCache[j] == cache[i];
+			}
+			if(!inTriangle)
+			{
+				newCache[newCacheCount++] = cache[i];
+			}
+		}
+
+		// Update scores of vertices whose cache position changed. Anything past the end of the cache was evicted.
+		for(int i = 0; i < newCacheCount; ++i)
+		{
+			int vertexIndex = newCache[i];
+			cachePositions[vertexIndex] = i < kScoreCacheSize ? i : -1;
+
+			float score = GetVertexScore(scoreTables, cachePositions[vertexIndex], remainingTriangles[vertexIndex]);
+			float scoreDelta = score - vertexScores[vertexIndex];
+			vertexScores[vertexIndex] = score;
+
+			int start = offsets[vertexIndex];
+			int end = start + remainingTriangles[vertexIndex];
+			for(int j = start; j < end; ++j)
+			{
+				triangleScores[vertexTriangles[j]] += scoreDelta;
+			}
+		}
+
+		// Find best triangle using a cached vertex for next time.
+		cacheCount = Math::Min(newCacheCount, kScoreCacheSize);
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for(int i = 0; i < cacheCount; ++i)
+		{
+			int vertexIndex = newCache[i];
+			cache[i] = vertexIndex;
+
+			int start = offsets[vertexIndex];
+			int end = start + remainingTriangles[vertexIndex];
+			for(int j = start; j < end; ++j)
+			{
+				int triangleIndex = vertexTriangles[j];
+				if(triangleScores[triangleIndex] > bestScore)
+				{
+					bestTriangle = triangleIndex;
+					bestScore = triangleScores[triangleIndex];
+				}
+			}
+		}
+	}
+
+	// Only use new order if it's actually better. Forsyth's algorithm is a heuristic, and some meshes are already well ordered.
+	int missesAfter = CountCacheMisses(&output[0], indexCount, vertexCount);
+	if(missesAfter < missesBefore)
+	{
+		std::copy(output.begin(), output.end(), indexes);
+	}
+	else
+	{
+		missesAfter = missesBefore;
+	}
+
+	++stats.meshCount;
+	stats.triangleCount += triangleCount;
+	stats.missesBefore += missesBefore;
+	stats.missesAfter += missesAfter;
+}
+
+const MeshOptimizer::Stats& MeshOptimizer::GetStats()
+{
+	return stats;
+}
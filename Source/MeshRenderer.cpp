@@ -6,11 +6,15 @@
 #include "MeshRenderer.h"
 
 #include "Actor.h"
+#include "Collisions.h"
 #include "Debug.h"
 #include "Mesh.h"
 #include "Model.h"
+#include "RenderQueue.h"
 #include "Services.h"
+#include "Shader.h"
 #include "Texture.h"
+#include "VertexAnimation.h"
 
 TYPE_DEF_CHILD(Component, MeshRenderer);
 
@@ -24,7 +28,7 @@ MeshRenderer::~MeshRenderer()
     Services::GetRenderer()->RemoveMeshRenderer(this);
 }
 
-void MeshRenderer::RenderOpaque()
+void MeshRenderer::AddToRenderQueue(RenderQueue& renderQueue, const Vector3& cameraPosition)
 {
 	// Don't render if actor is inactive or component is disabled.
 	if(!IsActiveAndEnabled()) { return; }
@@ -33,25 +37,31 @@ void MeshRenderer::RenderOpaque()
 	
 	int materialIndex = 0;
 	int maxMaterialIndex = static_cast<int>(mMaterials.size()) - 1;
-
+	
 	for(int i = 0; i < mMeshes.size(); i++)
 	{
 		Matrix4 meshWorldTransformMatrix = actorWorldTransform * mMeshes[i]->GetMeshToLocalMatrix();
 		
+		// All submeshes are sorted by distance to the mesh's center.
+		Vector3 meshWorldCenter = meshWorldTransformMatrix.TransformPoint(mMeshes[i]->GetAABB().GetCenter());
+		float depth = (meshWorldCenter - cameraPosition).GetLength();
+		
 		auto submeshes = mMeshes[i]->GetSubmeshes();
 		for(int j = 0; j < submeshes.size(); j++)
 		{
 			Material& material = mMaterials[materialIndex];
+			RenderQueue::Pass pass = material.IsTranslucent() ? RenderQueue::Pass::Translucent : RenderQueue::Pass::Opaque;
 			
-			// Ignore translucent rendering.
-			if(!material.IsTranslucent())
-			{
-				// Activate material.
-				material.Activate(meshWorldTransformMatrix);
-				
-				// Render the submesh!
-				submeshes[j]->Render();
-			}
+			RenderQueue::Item& item = renderQueue.Add(RenderQueue::MakeKey(pass, material.GetShader(), material.GetDiffuseTexture(), submeshes[j], depth));
+			item.submesh = submeshes[j];
+			item.material = &material;
+			item.objectToWorldMatrix = meshWorldTransformMatrix;
+			item.meshRenderer = this;
+			item.meshIndex = i;
+			item.submeshIndex = j;
+			
+			// GPU vertex animation sets uniforms for each submesh, so it can't be batched with other renderers.
+			item.instanceable = mGPUVertexAnimation == nullptr;
 			
 			// Draw debug axes if desired.
 			if(Debug::RenderSubmeshLocalAxes())
@@ -65,38 +75,6 @@ void MeshRenderer::RenderOpaque()
 	}
 }
 
-void MeshRenderer::RenderTranslucent()
-{
-	Matrix4 actorWorldTransform = GetOwner()->GetTransform()->GetLocalToWorldMatrix();
-	
-	int materialIndex = 0;
-	int maxMaterialIndex = static_cast<int>(mMaterials.size()) - 1;
-	
-	for(int i = 0; i < mMeshes.size(); i++)
-	{
-		Matrix4 meshWorldTransform = actorWorldTransform * mMeshes[i]->GetMeshToLocalMatrix();
-		
-		auto submeshes = mMeshes[i]->GetSubmeshes();
-		for(int j = 0; j < submeshes.size(); j++)
-		{
-			Material& material = mMaterials[materialIndex];
-			
-			// Ignore opaque rendering.
-			if(material.IsTranslucent())
-			{
-				// Activate material.
-				material.Activate(meshWorldTransform);
-				
-				// Render the submesh!
-				submeshes[j]->Render();
-			}
-			
-			// Increase material index, but not above the max.
-			materialIndex = Math::Min(materialIndex + 1, maxMaterialIndex);
-		}
-	}
-}
-
 void MeshRenderer::SetModel(Model* model)
 {
     if(model == nullptr) { return; }
@@ -105,6 +83,9 @@ void MeshRenderer::SetModel(Model* model)
     // Clear any existing.
     mMeshes.clear();
     mMaterials.clear();
+    mPoseAABBs.clear();
+    mHasPoseAABB.clear();
+    mWorldAABBDirty = true;
     
     // Add each mesh.
     for(auto& mesh : model->GetMeshes())
@@ -117,6 +98,9 @@ void MeshRenderer::SetMesh(Mesh* mesh)
 {
     mMeshes.clear();
     mMaterials.clear();
+    mPoseAABBs.clear();
+    mHasPoseAABB.clear();
+    mWorldAABBDirty = true;
     AddMesh(mesh);
 }
 
@@ -124,6 +108,9 @@ void MeshRenderer::AddMesh(Mesh* mesh)
 {
 	// Add mesh to array.
 	mMeshes.push_back(mesh);
+	mPoseAABBs.emplace_back();
+	mHasPoseAABB.push_back(false);
+	mWorldAABBDirty = true;
 	
 	// Create a material for each submesh.
 	const std::vector<Submesh*>& submeshes = mesh->GetSubmeshes();
@@ -187,13 +174,38 @@ Mesh* MeshRenderer::GetMesh(int index) const
 	return nullptr;
 }
 
+Vector3 MeshRenderer::GetVertexPosition(int meshIndex, int submeshIndex, int vertexIndex)
+{
+	Mesh* mesh = GetMesh(meshIndex);
+	if(mesh == nullptr) { return Vector3::Zero; }
+	Submesh* submesh = mesh->GetSubmesh(submeshIndex);
+	if(submesh == nullptr) { return Vector3::Zero; }
+	
+	// Submesh positions are stale during GPU vertex animation, so ask the animation instead.
+	if(mGPUVertexAnimation != nullptr && mGPUVertexAnimation->HasVertexKeyframes(meshIndex, submeshIndex))
+	{
+		return mGPUVertexAnimation->SampleVertexPosition(mGPUVertexAnimationTime, mGPUVertexAnimationFramesPerSecond, meshIndex, submeshIndex, vertexIndex);
+	}
+	return submesh->GetVertexPosition(vertexIndex);
+}
+
+void MeshRenderer::SetGPUVertexAnimation(VertexAnimation* animation, float time, int framesPerSecond)
+{
+	mGPUVertexAnimation = animation;
+	mGPUVertexAnimationTime = time;
+	mGPUVertexAnimationFramesPerSecond = framesPerSecond;
+}
+
 bool MeshRenderer::Raycast(const Ray& ray, RaycastHit& hitInfo)
 {
 	Matrix4 localToWorldMatrix = GetOwner()->GetTransform()->GetLocalToWorldMatrix();
 	
-	// Raycast against triangles in the mesh.
-	for(auto& mesh : mMeshes)
+	// Raycast against triangles in each mesh, keeping the nearest hit.
+	bool hit = false;
+	for(int meshIndex = 0; meshIndex < mMeshes.size(); meshIndex++)
 	{
+		Mesh* mesh = mMeshes[meshIndex];
+		
 		// Calculate world->local space transform by creating object->local and inverting.
 		Matrix4 meshToWorldMatrix = localToWorldMatrix * mesh->GetMeshToLocalMatrix();
         Matrix4 worldToMeshMatrix = Matrix4::InverseTransform(meshToWorldMatrix);
@@ -204,16 +216,99 @@ bool MeshRenderer::Raycast(const Ray& ray, RaycastHit& hitInfo)
 		rayLocalDir.Normalize();
 		Ray localRay(rayLocalPos, rayLocalDir);
 		
+		// During GPU vertex animation, submesh positions are stale. Sample them on the CPU, but only if the ray could hit this mesh.
+		// Positions aren't uploaded - the GPU doesn't use them while animating.
+		if(mGPUVertexAnimation != nullptr)
+		{
+			RaycastHit aabbHitInfo;
+			if(!Collisions::TestRayAABB(localRay, mesh->GetAABB(), aabbHitInfo)) { continue; }
+			
+			const std::vector<Submesh*>& submeshes = mesh->GetSubmeshes();
+			for(int i = 0; i < submeshes.size(); i++)
+			{
+				float* positions = submeshes[i]->GetPositions();
+				if(positions != nullptr)
+				{
+					mGPUVertexAnimation->SampleVertexPose(mGPUVertexAnimationTime, mGPUVertexAnimationFramesPerSecond, meshIndex, i,
+														  positions, submeshes[i]->GetVertexCount());
+					
+					// Positions no longer match what was last uploaded.
+					submeshes[i]->MarkPositionsChanged();
+				}
+			}
+		}
+		
 		// See if the local ray intersects the local space triangles of the mesh.
-		if(mesh->Raycast(localRay, hitInfo))
+		RaycastHit meshHitInfo;
+		if(mesh->Raycast(localRay, meshHitInfo))
 		{
-			//TODO: Convert hit info back to world space.
-			return true;
+			// Convert hit back to world space. Mesh space may be scaled, so "t" along the local ray isn't the same as along the world ray.
+			Vector3 worldHitPoint = meshToWorldMatrix.TransformPoint(localRay.GetPoint(meshHitInfo.t));
+			float t = (worldHitPoint - ray.origin).GetLength() / ray.direction.GetLength();
+			if(t < hitInfo.t)
+			{
+				hitInfo.t = t;
+				hitInfo.actor = GetOwner();
+				hit = true;
+			}
 		}
 	}
+	return hit;
+}
+
+const AABB& MeshRenderer::GetAABB()
+{
+	// Bounds are still good if nothing moved.
+	Transform* transform = GetOwner()->GetTransform();
+	if(!mWorldAABBDirty && transform->GetChangeCount() == mWorldAABBTransformChangeCount)
+	{
+		return mWorldAABB;
+	}
+	mWorldAABBDirty = false;
+	mWorldAABBTransformChangeCount = transform->GetChangeCount();
+	Matrix4 localToWorldMatrix = transform->GetLocalToWorldMatrix();
 	
-	// Ray did not intersect with any part of the mesh renderer.
-	return false;
+	// Transform corners of each mesh's AABB to world space, and grow to contain them all.
+	AABB aabb;
+	bool empty = true;
+	for(int meshIndex = 0; meshIndex < mMeshes.size(); meshIndex++)
+	{
+		Mesh* mesh = mMeshes[meshIndex];
+		Matrix4 meshToWorldMatrix = localToWorldMatrix * mesh->GetMeshToLocalMatrix();
+		
+		// A posed mesh's vertices may have moved outside its own AABB.
+		AABB meshAABB = mesh->GetAABB();
+		if(mHasPoseAABB[meshIndex])
+		{
+			meshAABB.GrowToContain(mPoseAABBs[meshIndex]);
+		}
+		Vector3 min = meshAABB.GetMin();
+		Vector3 max = meshAABB.GetMax();
+		for(int i = 0; i < 8; i++)
+		{
+			Vector3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+			corner = meshToWorldMatrix.TransformPoint(corner);
+			if(empty)
+			{
+				aabb = AABB(corner, corner);
+				empty = false;
+			}
+			else
+			{
+				aabb.GrowToContain(corner);
+			}
+		}
+	}
+	mWorldAABB = aabb;
+	return mWorldAABB;
+}
+
+void MeshRenderer::SetPoseAABB(int meshIndex, const AABB& aabb)
+{
+	if(meshIndex < 0 || meshIndex >= mMeshes.size()) { return; }
+	mPoseAABBs[meshIndex] = aabb;
+	mHasPoseAABB[meshIndex] = true;
+	mWorldAABBDirty = true;
 }
 
 void MeshRenderer::DebugDrawAABBs()
@@ -230,3 +325,22 @@ void MeshRenderer::DebugDrawAABBs()
         Debug::DrawAABB(mesh->GetAABB(), Color32::Magenta, 60.0f, &meshToWorldMatrix);
 	}
 }
+
+void MeshRenderer::ActivateGPUVertexAnimation(Material& material, int meshIndex, int submeshIndex)
+{
+	if(mGPUVertexAnimation == nullptr) { return; }
+	
+	int offset0 = 0;
+	int offset1 = 0;
+	float blend = 0.0f;
+	if(mGPUVertexAnimation->SampleGPUKeyframes(mGPUVertexAnimationTime, mGPUVertexAnimationFramesPerSecond, meshIndex, submeshIndex, offset0, offset1, blend))
+	{
+		mGPUVertexAnimation->ActivateGPUKeyframes(Material::kVertexAnimationTextureUnit);
+		
+		Shader* shader = material.GetShader();
+		shader->SetUniformInt(shader->GetUniformLocation(BuiltInUniform::VertexAnimationEnabled), 1);
+		shader->SetUniformInt(shader->GetUniformLocation(BuiltInUniform::VertexAnimationOffset0), offset0);
+		shader->SetUniformInt(shader->GetUniformLocation(BuiltInUniform::VertexAnimationOffset1), offset1);
+		shader->SetUniformFloat(shader->GetUniformLocation(BuiltInUniform::VertexAnimationBlend), blend);
+	}
+}
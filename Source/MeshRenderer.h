@@ -10,13 +10,16 @@
 
 #include <vector>
 
+#include "AABB.h"
 #include "Material.h"
 
 class Mesh;
 class Model;
 class Ray;
 struct RaycastHit;
+class RenderQueue;
 class Texture;
+class VertexAnimation;
 
 class MeshRenderer : public Component
 {
@@ -25,8 +28,8 @@ public:
     MeshRenderer(Actor* actor);
     ~MeshRenderer();
 	
-	void RenderOpaque();
-	void RenderTranslucent();
+	// Adds an item to the render queue for each submesh. Items are sorted by the renderer before drawing.
+	void AddToRenderQueue(RenderQueue& renderQueue, const Vector3& cameraPosition);
     
     void SetModel(Model* model);
     
@@ -42,8 +45,32 @@ public:
 	const std::vector<Mesh*>& GetMeshes() const { return mMeshes; }
 	Mesh* GetMesh(int index) const;
 	
+	// Gets a vertex's current position, in mesh space. Takes GPU vertex animation into account.
+	Vector3 GetVertexPosition(int meshIndex, int submeshIndex, int vertexIndex);
+	
+	// Makes vertex positions come from a vertex animation's keyframes, interpolated on the GPU.
+	// The animation must have GPU keyframes. Pass null to go back to using submesh positions.
+	void SetGPUVertexAnimation(VertexAnimation* animation, float time, int framesPerSecond);
+	VertexAnimation* GetGPUVertexAnimation() const { return mGPUVertexAnimation; }
+	float GetGPUVertexAnimationTime() const { return mGPUVertexAnimationTime; }
+	int GetGPUVertexAnimationFramesPerSecond() const { return mGPUVertexAnimationFramesPerSecond; }
+	
+	// Sets GPU vertex animation uniforms for a submesh, if this renderer has a GPU vertex animation. Call after activating the material.
+	void ActivateGPUVertexAnimation(Material& material, int meshIndex, int submeshIndex);
+	
 	bool Raycast(const Ray& ray, RaycastHit& hitInfo);
 	
+	// Gets bounds of all meshes, in world space. Uses the meshes' AABBs, grown to contain any vertex animation pose.
+	// Cached, and only recalculated when the transform, meshes, or vertex animation pose changes.
+	const AABB& GetAABB();
+	
+	// Sets bounds (in mesh space) of a mesh's current vertex animation pose. Kept until the meshes change.
+	// Vertex animations can move vertices well outside the mesh's own AABB (e.g. walking away from the actor's origin).
+	void SetPoseAABB(int meshIndex, const AABB& aabb);
+	
+	// Lets the renderer know mesh-to-local matrices changed (e.g. a new vertex animation pose), so bounds must be recalculated.
+	void SetBoundsDirty() { mWorldAABBDirty = true; }
+	
 	void DebugDrawAABBs();
     
 private:
@@ -59,4 +86,19 @@ private:
     // Each mesh *must have* a material!
 	// If a mesh has multiple submeshes, each submesh *must have* a material!
     std::vector<Material> mMaterials;
+	
+	// A vertex animation being evaluated on the GPU, if any, and the time to sample it at.
+	// Submesh positions are NOT updated while this is set.
+	VertexAnimation* mGPUVertexAnimation = nullptr;
+	float mGPUVertexAnimationTime = 0.0f;
+	int mGPUVertexAnimationFramesPerSecond = 15;
+	
+	// Bounds of each mesh's vertex animation pose, in mesh space, if it has one.
+	std::vector<AABB> mPoseAABBs;
+	std::vector<bool> mHasPoseAABB;
+	
+	// World space bounds of all meshes, and the transform change count they were calculated at.
+	AABB mWorldAABB;
+	uint32_t mWorldAABBTransformChangeCount = 0;
+	bool mWorldAABBDirty = true;
 };
@@ -10,11 +10,13 @@
 
 #include "BinaryReader.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
 #include "Quaternion.h"
 #include "Submesh.h"
 #include "Vector2.h"
 #include "Vector3.h"
 #include "Vector4.h"
+#include "VertexCompression.h"
 #include "Debug.h"
 
 //#define DEBUG_OUTPUT
@@ -357,26 +359,27 @@ void Model::ParseFromData(char *data, int dataLength)
 				reader.ReadUShort(); // WHAT IS IT!?
             }
             
+            // Reorder faces for better vertex cache use. Vertex order must stay the same, since vertex animations refer to vertices by index.
+            MeshOptimizer::OptimizeVertexCache(vertexIndexes, faceCount * 3, vertexCount);
+            
             // Generate mesh from data.
+            // Layout is packed, so vertex animations can update positions alone. Positions stay full precision for the same reason.
+            // Normals and UVs use compact formats - half float UVs are fine unless the texture tiles a lot.
             MeshDefinition meshDefinition;
             meshDefinition.meshUsage = MeshUsage::Dynamic;
             
+            const float kMaxHalfUV = 2.0f;
+            bool halfUVs = VertexCompression::IsInRange(vertexUVs, vertexCount * 2, -kMaxHalfUV, kMaxHalfUV);
             meshDefinition.vertexDefinition.layout = VertexDefinition::Layout::Packed;
             meshDefinition.vertexDefinition.attributes.push_back(VertexAttribute::Position);
-            meshDefinition.vertexDefinition.attributes.push_back(VertexAttribute::Normal);
-            meshDefinition.vertexDefinition.attributes.push_back(VertexAttribute::UV1);
-            
+            meshDefinition.vertexDefinition.attributes.push_back(VertexAttribute::NormalOctahedral);
+            meshDefinition.vertexDefinition.attributes.push_back(halfUVs ? VertexAttribute::UV1Half : VertexAttribute::UV1);
             meshDefinition.vertexCount = vertexCount;
-            std::vector<float*> vertexData;
-            vertexData.push_back(vertexPositions);
-            vertexData.push_back(vertexNormals);
-            vertexData.push_back(vertexUVs);
-            meshDefinition.vertexData = &vertexData[0];
         
             meshDefinition.indexCount = faceCount * 3;
             meshDefinition.indexData = vertexIndexes;
             
-            // Create submesh.
+            // Create submesh. Vertex data is converted to the compact formats and uploaded when set on the submesh.
             Submesh* submesh = mesh->AddSubmesh(meshDefinition);
             submesh->SetPositions(vertexPositions);
             submesh->SetNormals(vertexNormals);
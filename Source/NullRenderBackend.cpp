@@ -0,0 +1,443 @@
+//
+// NullRenderBackend.cpp
+//
+// Clark Kromenaker
+//
+#include "NullRenderBackend.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Size of a texture upload, for the pixel formats and types the engine uses.
+	int64_t GetPixelDataSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+	{
+		int componentCount = 4;
+		switch(format)
+		{
+		case GL_RED:
+			componentCount = 1;
+			break;
+		case GL_RG:
+			componentCount = 2;
+			break;
+		case GL_RGB:
+			componentCount = 3;
+			break;
+		}
+		int componentSize = (type == GL_FLOAT || type == GL_UNSIGNED_INT || type == GL_INT) ? 4 : 1;
+		return static_cast<int64_t>(width) * height * componentCount * componentSize;
+	}
+
+	// GL type enum for a GLSL type name, for the types engine shaders declare uniforms with.
+	GLenum GetUniformType(const std::string& typeName)
+	{
+		static const std::unordered_map<std::string, GLenum> kTypes = {
+			{ "float", GL_FLOAT }, { "int", GL_INT }, { "uint", GL_UNSIGNED_INT }, { "bool", GL_BOOL },
+			{ "vec2", GL_FLOAT_VEC2 }, { "vec3", GL_FLOAT_VEC3 }, { "vec4", GL_FLOAT_VEC4 },
+			{ "mat2", GL_FLOAT_MAT2 }, { "mat3", GL_FLOAT_MAT3 }, { "mat4", GL_FLOAT_MAT4 },
+			{ "sampler2D", GL_SAMPLER_2D }, { "samplerBuffer", GL_SAMPLER_BUFFER }, { "samplerCube", GL_SAMPLER_CUBE }
+		};
+		auto it = kTypes.find(typeName);
+		return it != kTypes.end() ? it->second : GL_NONE;
+	}
+
+	// Splits GLSL source into identifiers/numbers and single punctuation characters, skipping comments and preprocessor lines.
+	std::vector<std::string> TokenizeShaderSource(const std::string& source)
+	{
+		std::vector<std::string> tokens;
+		size_t i = 0;
+		while(i < source.size())
+		{
+			char c = source[i];
+			if(std::isspace(static_cast<unsigned char>(c)))
+			{
+				++i;
+			}
+			else if(c == '#' || source.compare(i, 2, "//") == 0)
+			{
+				i = source.find('\n', i);
+			}
+			else if(source.compare(i, 2, "/*") == 0)
+			{
+				i = source.find("*/", i);
+				if(i != std::string::npos) { i += 2; }
+			}
+			else if(std::isalnum(static_cast<unsigned char>(c)) || c == '_')
+			{
+				size_t start = i;
+				while(i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_' || source[i] == '.'))
+				{
+					++i;
+				}
+				tokens.push_back(source.substr(start, i - start));
+			}
+			else
+			{
+				tokens.push_back(std::string(1, c));
+				++i;
+			}
+		}
+		return tokens;
+	}
+
+	// Index just past the ";" that ends the statement containing "index".
+	size_t SkipStatement(const std::vector<std::string>& tokens, size_t index)
+	{
+		while(index < tokens.size() && tokens[index] != ";") { ++index; }
+		return index + 1;
+	}
+}
+
+void NullRenderBackendStats::Add(const NullRenderBackendStats& other)
+{
+	drawCalls += other.drawCalls;
+	instancedDrawCalls += other.instancedDrawCalls;
+	verticesDrawn += other.verticesDrawn;
+	stateChanges += other.stateChanges;
+	uniformChanges += other.uniformChanges;
+	bufferBytesUploaded += other.bufferBytesUploaded;
+	textureBytesUploaded += other.textureBytesUploaded;
+}
+
+void NullRenderBackend::Shutdown()
+{
+	// Uploads during loading happen before the first frame is presented, so count them too.
+	mTotalStats.Add(mStats);
+	mStats = NullRenderBackendStats();
+
+	// Report what was recorded, since nobody could see it.
+	int frameCount = mFrameCount > 0 ? mFrameCount : 1;
+	std::cout << "Null renderer: " << mFrameCount << " frames, "
+			  << mTotalStats.drawCalls / frameCount << " draw calls/frame ("
+			  << mTotalStats.instancedDrawCalls / frameCount << " instanced), "
+			  << mTotalStats.stateChanges / frameCount << " state changes/frame, "
+			  << mTotalStats.uniformChanges / frameCount << " uniform changes/frame, "
+			  << (mTotalStats.bufferBytesUploaded + mTotalStats.textureBytesUploaded) / 1024 << " KB uploaded" << std::endl;
+}
+
+void NullRenderBackend::Present()
+{
+	mLastFrameStats = mStats;
+	mTotalStats.Add(mStats);
+	mStats = NullRenderBackendStats();
+	++mFrameCount;
+}
+
+void NullRenderBackend::BufferData(GLenum, GLsizeiptr size, const void* data, GLenum)
+{
+	// Allocating without data doesn't upload anything.
+	if(data != nullptr)
+	{
+		mStats.bufferBytesUploaded += size;
+	}
+}
+
+void NullRenderBackend::BufferSubData(GLenum, GLintptr, GLsizeiptr size, const void*)
+{
+	mStats.bufferBytesUploaded += size;
+}
+
+void NullRenderBackend::DrawArrays(GLenum, GLint, GLsizei count)
+{
+	++mStats.drawCalls;
+	mStats.verticesDrawn += count;
+}
+
+void NullRenderBackend::DrawElements(GLenum, GLsizei count, GLenum, const void*)
+{
+	++mStats.drawCalls;
+	mStats.verticesDrawn += count;
+}
+
+void NullRenderBackend::DrawArraysInstanced(GLenum, GLint, GLsizei count, GLsizei instanceCount)
+{
+	++mStats.drawCalls;
+	++mStats.instancedDrawCalls;
+	mStats.verticesDrawn += static_cast<int64_t>(count) * instanceCount;
+}
+
+void NullRenderBackend::DrawElementsInstanced(GLenum, GLsizei count, GLenum, const void*, GLsizei instanceCount)
+{
+	++mStats.drawCalls;
+	++mStats.instancedDrawCalls;
+	mStats.verticesDrawn += static_cast<int64_t>(count) * instanceCount;
+}
+
+void NullRenderBackend::TexImage2D(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	if(pixels != nullptr)
+	{
+		mStats.textureBytesUploaded += GetPixelDataSize(width, height, format, type);
+	}
+}
+
+void NullRenderBackend::TexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format, GLenum type, const void*)
+{
+	mStats.textureBytesUploaded += GetPixelDataSize(width, height, format, type);
+}
+
+GLuint NullRenderBackend::CreateShader(GLenum type)
+{
+	GLuint shader = mNextName++;
+	mShaders[shader].type = type;
+	return shader;
+}
+
+GLuint NullRenderBackend::CreateProgram()
+{
+	GLuint program = mNextName++;
+	mPrograms[program] = Program();
+	return program;
+}
+
+void NullRenderBackend::ShaderSource(GLuint shader, const char* source)
+{
+	auto it = mShaders.find(shader);
+	if(it != mShaders.end() && source != nullptr)
+	{
+		it->second.source = source;
+	}
+}
+
+void NullRenderBackend::GetShaderiv(GLuint, GLenum name, GLint* value)
+{
+	*value = (name == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+void NullRenderBackend::GetShaderInfoLog(GLuint, GLsizei bufferSize, GLsizei* length, GLchar* log)
+{
+	if(length != nullptr) { *length = 0; }
+	if(bufferSize > 0) { log[0] = '\0'; }
+}
+
+void NullRenderBackend::AttachShader(GLuint program, GLuint shader)
+{
+	auto it = mPrograms.find(program);
+	if(it != mPrograms.end())
+	{
+		it->second.attachedShaders.push_back(shader);
+	}
+}
+
+void NullRenderBackend::DetachShader(GLuint program, GLuint shader)
+{
+	auto it = mPrograms.find(program);
+	if(it != mPrograms.end())
+	{
+		std::vector<GLuint>& shaders = it->second.attachedShaders;
+		shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+	}
+}
+
+void NullRenderBackend::BindAttribLocation(GLuint program, GLuint index, const GLchar* name)
+{
+	// As in GL, bindings take effect at the next link.
+	auto it = mPrograms.find(program);
+	if(it != mPrograms.end())
+	{
+		it->second.boundAttributes[name] = index;
+	}
+}
+
+void NullRenderBackend::LinkProgram(GLuint program)
+{
+	auto programIt = mPrograms.find(program);
+	if(programIt == mPrograms.end()) { return; }
+	Program& linked = programIt->second;
+	linked.uniforms.clear();
+	linked.uniformBlocks.clear();
+	linked.attributes.clear();
+
+	// Gather top-level declarations from each attached shader.
+	// Only "uniform" and (in vertex shaders) "in" declarations matter - function bodies and parameter lists are skipped.
+	for(GLuint shader : linked.attachedShaders)
+	{
+		auto shaderIt = mShaders.find(shader);
+		if(shaderIt == mShaders.end()) { continue; }
+		bool isVertexShader = shaderIt->second.type == GL_VERTEX_SHADER;
+
+		std::vector<std::string> tokens = TokenizeShaderSource(shaderIt->second.source);
+		int depth = 0;
+		size_t i = 0;
+		while(i < tokens.size())
+		{
+			const std::string& token = tokens[i];
+			if(token == "{" || token == "(")
+			{
+				++depth;
+				++i;
+			}
+			else if(token == "}" || token == ")")
+			{
+				--depth;
+				++i;
+			}
+			else if(depth == 0 && token == "uniform" && i + 2 < tokens.size())
+			{
+				if(tokens[i + 2] == "{")
+				{
+					// Uniform block: each member is a uniform too, but is set through the block's buffer.
+					// Shaders in one program may both declare the same block, but it's only one block.
+					const std::string& blockName = tokens[i + 1];
+					bool isNewBlock = std::find(linked.uniformBlocks.begin(), linked.uniformBlocks.end(), blockName) == linked.uniformBlocks.end();
+					if(isNewBlock)
+					{
+						linked.uniformBlocks.push_back(blockName);
+					}
+					i += 3;
+					while(i + 1 < tokens.size() && tokens[i] != "}")
+					{
+						if(isNewBlock)
+						{
+							Uniform uniform;
+							uniform.type = GetUniformType(tokens[i]);
+							uniform.name = tokens[i + 1];
+							uniform.inBlock = true;
+							linked.uniforms.push_back(uniform);
+						}
+						i = SkipStatement(tokens, i);
+					}
+				}
+				else
+				{
+					// Likewise, a uniform declared by more than one shader is only one uniform.
+					const std::string& name = tokens[i + 2];
+					auto it = std::find_if(linked.uniforms.begin(), linked.uniforms.end(), [&name](const Uniform& uniform) {
+						return uniform.name == name;
+					});
+					if(it == linked.uniforms.end())
+					{
+						Uniform uniform;
+						uniform.type = GetUniformType(tokens[i + 1]);
+						uniform.name = name;
+						linked.uniforms.push_back(uniform);
+					}
+				}
+				i = SkipStatement(tokens, i);
+			}
+			else if(depth == 0 && token == "in" && isVertexShader && i + 2 < tokens.size())
+			{
+				linked.attributes.push_back(tokens[i + 2]);
+				i = SkipStatement(tokens, i);
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+}
+
+void NullRenderBackend::GetProgramiv(GLuint program, GLenum name, GLint* value)
+{
+	*value = 0;
+	if(name == GL_LINK_STATUS)
+	{
+		*value = GL_TRUE;
+		return;
+	}
+
+	auto it = mPrograms.find(program);
+	if(it == mPrograms.end()) { return; }
+	switch(name)
+	{
+	case GL_ACTIVE_UNIFORMS:
+		*value = static_cast<GLint>(it->second.uniforms.size());
+		break;
+	case GL_ACTIVE_UNIFORM_BLOCKS:
+		*value = static_cast<GLint>(it->second.uniformBlocks.size());
+		break;
+	case GL_ACTIVE_ATTRIBUTES:
+		*value = static_cast<GLint>(it->second.attributes.size());
+		break;
+	}
+}
+
+void NullRenderBackend::GetProgramInfoLog(GLuint, GLsizei bufferSize, GLsizei* length, GLchar* log)
+{
+	if(length != nullptr) { *length = 0; }
+	if(bufferSize > 0) { log[0] = '\0'; }
+}
+
+void NullRenderBackend::GetActiveUniform(GLuint program, GLuint index, GLsizei bufferSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+	// An index past the active uniform count has no uniform, which is reported as an empty name.
+	const Uniform* uniform = nullptr;
+	auto it = mPrograms.find(program);
+	if(it != mPrograms.end() && index < it->second.uniforms.size())
+	{
+		uniform = &it->second.uniforms[index];
+	}
+
+	// Copy as much of the name as fits, always null-terminated.
+	GLsizei nameLength = 0;
+	if(uniform != nullptr && bufferSize > 0)
+	{
+		nameLength = static_cast<GLsizei>(std::min<size_t>(uniform->name.size(), bufferSize - 1));
+		memcpy(name, uniform->name.c_str(), nameLength);
+	}
+	if(bufferSize > 0) { name[nameLength] = '\0'; }
+	if(length != nullptr) { *length = nameLength; }
+	if(size != nullptr) { *size = uniform != nullptr ? 1 : 0; }
+	if(type != nullptr) { *type = uniform != nullptr ? uniform->type : GL_NONE; }
+}
+
+GLint NullRenderBackend::GetUniformLocation(GLuint program, const GLchar* name)
+{
+	// A uniform's location is its index in the program's uniforms. Like GL, uniforms in a block have no location.
+	auto it = mPrograms.find(program);
+	if(it == mPrograms.end()) { return -1; }
+	const std::vector<Uniform>& uniforms = it->second.uniforms;
+	for(size_t i = 0; i < uniforms.size(); ++i)
+	{
+		if(uniforms[i].name == name)
+		{
+			return uniforms[i].inBlock ? -1 : static_cast<GLint>(i);
+		}
+	}
+	return -1;
+}
+
+GLint NullRenderBackend::GetAttribLocation(GLuint program, const GLchar* name)
+{
+	// Attributes use the location bound before linking. Otherwise, they're numbered in declaration order.
+	auto it = mPrograms.find(program);
+	if(it == mPrograms.end()) { return -1; }
+	const std::vector<std::string>& attributes = it->second.attributes;
+	auto attributeIt = std::find(attributes.begin(), attributes.end(), name);
+	if(attributeIt == attributes.end()) { return -1; }
+
+	auto boundIt = it->second.boundAttributes.find(name);
+	if(boundIt != it->second.boundAttributes.end())
+	{
+		return static_cast<GLint>(boundIt->second);
+	}
+	return static_cast<GLint>(attributeIt - attributes.begin());
+}
+
+GLuint NullRenderBackend::GetUniformBlockIndex(GLuint program, const GLchar* name)
+{
+	auto it = mPrograms.find(program);
+	if(it == mPrograms.end()) { return GL_INVALID_INDEX; }
+	const std::vector<std::string>& blocks = it->second.uniformBlocks;
+	auto blockIt = std::find(blocks.begin(), blocks.end(), name);
+	return blockIt != blocks.end() ? static_cast<GLuint>(blockIt - blocks.begin()) : GL_INVALID_INDEX;
+}
+
+void NullRenderBackend::GetIntegerv(GLenum name, GLint* value)
+{
+	switch(name)
+	{
+	case GL_MAX_TEXTURE_BUFFER_SIZE:
+		// GL 3.3 only guarantees 64K texels, but desktop GPUs allow far more. Use a typical size, so the same paths are taken.
+		*value = 128 * 1024 * 1024;
+		break;
+	default:
+		*value = 0;
+		break;
+	}
+}
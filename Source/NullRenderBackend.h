@@ -0,0 +1,182 @@
+//
+// NullRenderBackend.h
+//
+// Clark Kromenaker
+//
+// A render backend that doesn't render anything. It needs no window or GPU, so the game can run headless.
+//
+// It records what it's asked to do (draw calls, state changes, bytes uploaded), which is useful for measuring
+// CPU-side rendering cost on machines without a display. Queries are answered well enough for the engine to take
+// its normal paths: objects get unique names, shaders always compile and link, and a linked program's uniforms,
+// uniform blocks, and vertex attributes are found by scanning the declarations in its shader source.
+// Unlike a real driver, nothing unused is optimized away.
+//
+#pragma once
+#include "RenderBackend.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Counts of recorded commands.
+struct NullRenderBackendStats
+{
+	// Draw calls, instanced draw calls among them, and vertices (or indexes) drawn across all instances.
+	int drawCalls = 0;
+	int instancedDrawCalls = 0;
+	int64_t verticesDrawn = 0;
+
+	// Binds and fixed-function state changes, and uniform values set.
+	int stateChanges = 0;
+	int uniformChanges = 0;
+
+	// Bytes of buffer and texture data uploaded.
+	int64_t bufferBytesUploaded = 0;
+	int64_t textureBytesUploaded = 0;
+
+	void Add(const NullRenderBackendStats& other);
+};
+
+class NullRenderBackend : public RenderBackend
+{
+public:
+	// Nothing to create, so this always succeeds.
+	bool Initialize(const char*, int, int) override { return true; }
+	void Shutdown() override;
+
+	// Ends the frame: the frame's stats become the last frame stats, and are added to the totals.
+	void Present() override;
+
+	// Stats for the most recently presented frame, and for all frames so far.
+	const NullRenderBackendStats& GetFrameStats() const { return mLastFrameStats; }
+	const NullRenderBackendStats& GetTotalStats() const { return mTotalStats; }
+	int GetFrameCount() const { return mFrameCount; }
+
+	// Object creation and deletion.
+	GLuint CreateBuffer() override { return mNextName++; }
+	GLuint CreateVertexArray() override { return mNextName++; }
+	GLuint CreateTexture() override { return mNextName++; }
+	GLuint CreateFramebuffer() override { return mNextName++; }
+	GLuint CreateShader(GLenum type) override;
+	GLuint CreateProgram() override;
+	void DeleteBuffer(GLuint) override { }
+	void DeleteVertexArray(GLuint) override { }
+	void DeleteTexture(GLuint) override { }
+	void DeleteFramebuffer(GLuint) override { }
+	void DeleteShader(GLuint shader) override { mShaders.erase(shader); }
+	void DeleteProgram(GLuint program) override { mPrograms.erase(program); }
+
+	// Binds and fixed-function state.
+	void UseProgram(GLuint) override { ++mStats.stateChanges; }
+	void ActiveTexture(int) override { ++mStats.stateChanges; }
+	void BindTexture(GLenum, GLuint) override { ++mStats.stateChanges; }
+	void BindVertexArray(GLuint) override { ++mStats.stateChanges; }
+	void BindBuffer(GLenum, GLuint) override { ++mStats.stateChanges; }
+	void BindBufferBase(GLenum, GLuint, GLuint) override { ++mStats.stateChanges; }
+	void BindFramebuffer(GLenum, GLuint) override { ++mStats.stateChanges; }
+	void Enable(GLenum) override { ++mStats.stateChanges; }
+	void Disable(GLenum) override { ++mStats.stateChanges; }
+	void DepthMask(GLboolean) override { ++mStats.stateChanges; }
+	void DepthFunc(GLenum) override { ++mStats.stateChanges; }
+	void BlendFunc(GLenum, GLenum) override { ++mStats.stateChanges; }
+	void Viewport(GLint, GLint, GLsizei, GLsizei) override { ++mStats.stateChanges; }
+	void ClearColor(GLfloat, GLfloat, GLfloat, GLfloat) override { ++mStats.stateChanges; }
+	void ClearDepth(GLdouble) override { ++mStats.stateChanges; }
+	void Clear(GLbitfield) override { }
+
+	// Buffer contents.
+	void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+	void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+
+	// Vertex layout, in the bound vertex array.
+	void EnableVertexAttribArray(GLuint) override { ++mStats.stateChanges; }
+	void DisableVertexAttribArray(GLuint) override { ++mStats.stateChanges; }
+	void VertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) override { ++mStats.stateChanges; }
+	void VertexAttribDivisor(GLuint, GLuint) override { ++mStats.stateChanges; }
+
+	// Draws.
+	void DrawArrays(GLenum mode, GLint first, GLsizei count) override;
+	void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) override;
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) override;
+	void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) override;
+
+	// Texture contents, in the bound texture.
+	void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+	void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+	void TexParameteri(GLenum, GLenum, GLint) override { }
+	void TexBuffer(GLenum, GLenum, GLuint) override { }
+
+	// Framebuffer setup, in the bound framebuffer.
+	void FramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint) override { }
+	void DrawBuffers(GLsizei, const GLenum*) override { }
+	GLenum CheckFramebufferStatus(GLenum) override { return GL_FRAMEBUFFER_COMPLETE; }
+
+	// Shader compiling and linking. Everything succeeds, and linking scans the attached shaders' sources for declarations.
+	void ShaderSource(GLuint shader, const char* source) override;
+	void CompileShader(GLuint) override { }
+	void GetShaderiv(GLuint shader, GLenum name, GLint* value) override;
+	void GetShaderInfoLog(GLuint shader, GLsizei bufferSize, GLsizei* length, GLchar* log) override;
+	void AttachShader(GLuint program, GLuint shader) override;
+	void DetachShader(GLuint program, GLuint shader) override;
+	void BindAttribLocation(GLuint program, GLuint index, const GLchar* name) override;
+	void LinkProgram(GLuint program) override;
+	void GetProgramiv(GLuint program, GLenum name, GLint* value) override;
+	void GetProgramInfoLog(GLuint program, GLsizei bufferSize, GLsizei* length, GLchar* log) override;
+
+	// Shader inputs, from the declarations found when the program was linked.
+	// Locations and indexes stay the same for a program until it's linked again. Undeclared names aren't found, as in GL.
+	void GetActiveUniform(GLuint program, GLuint index, GLsizei bufferSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name) override;
+	GLint GetUniformLocation(GLuint program, const GLchar* name) override;
+	GLint GetAttribLocation(GLuint program, const GLchar* name) override;
+	GLuint GetUniformBlockIndex(GLuint program, const GLchar* name) override;
+	void UniformBlockBinding(GLuint, GLuint, GLuint) override { }
+
+	// Uniform values, in the program in use.
+	void Uniform1i(GLint, GLint) override { ++mStats.uniformChanges; }
+	void Uniform1f(GLint, GLfloat) override { ++mStats.uniformChanges; }
+	void Uniform3f(GLint, GLfloat, GLfloat, GLfloat) override { ++mStats.uniformChanges; }
+	void Uniform4f(GLint, GLfloat, GLfloat, GLfloat, GLfloat) override { ++mStats.uniformChanges; }
+	void UniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) override { ++mStats.uniformChanges; }
+
+	// Queries.
+	void GetIntegerv(GLenum name, GLint* value) override;
+
+private:
+	// A uniform declared in a program's shaders. Uniforms in a uniform block have no location.
+	struct Uniform
+	{
+		std::string name;
+		GLenum type = GL_NONE;
+		bool inBlock = false;
+	};
+
+	// What's known about a shader or program. Declarations are gathered from attached shaders when a program links.
+	struct Shader
+	{
+		GLenum type = GL_NONE;
+		std::string source;
+	};
+	struct Program
+	{
+		std::vector<GLuint> attachedShaders;
+		std::unordered_map<std::string, GLuint> boundAttributes;
+
+		std::vector<Uniform> uniforms;
+		std::vector<std::string> uniformBlocks;
+		std::vector<std::string> attributes;
+	};
+
+	// Next name to give a created object. Zero is never a valid name.
+	GLuint mNextName = 1;
+
+	// Shaders and programs that currently exist, by name.
+	std::unordered_map<GLuint, Shader> mShaders;
+	std::unordered_map<GLuint, Program> mPrograms;
+
+	// Stats for the frame in progress, the last presented frame, and all presented frames.
+	NullRenderBackendStats mStats;
+	NullRenderBackendStats mLastFrameStats;
+	NullRenderBackendStats mTotalStats;
+	int mFrameCount = 0;
+};
@@ -0,0 +1,401 @@
+//
+// OpenGLRenderBackend.cpp
+//
+// Clark Kromenaker
+//
+#include "OpenGLRenderBackend.h"
+
+bool OpenGLRenderBackend::Initialize(const char* title, int width, int height)
+{
+	// Init video subsystem.
+	if(SDL_InitSubSystem(SDL_INIT_VIDEO) != 0)
+	{
+		return false;
+	}
+	
+	// Tell SDL we want to use OpenGL 3.3
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	
+	// Request some GL parameters, just in case
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+	
+	// Create a window.
+	mWindow = SDL_CreateWindow(title, 100, 100, width, height, SDL_WINDOW_OPENGL);
+	if(!mWindow) { return false; }
+	
+	// Create OpenGL context.
+	mContext = SDL_GL_CreateContext(mWindow);
+	
+	// Initialize GLEW.
+	glewExperimental = GL_TRUE;
+	if(glewInit() != GLEW_OK)
+	{
+		SDL_Log("Failed to initialize GLEW.");
+		return false;
+	}
+	
+	// Clear any GLEW error.
+	glGetError();
+	return true;
+}
+
+void OpenGLRenderBackend::Shutdown()
+{
+	SDL_GL_DeleteContext(mContext);
+	SDL_DestroyWindow(mWindow);
+	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+	mContext = nullptr;
+	mWindow = nullptr;
+}
+
+void OpenGLRenderBackend::Present()
+{
+	SDL_GL_SwapWindow(mWindow);
+}
+
+GLuint OpenGLRenderBackend::CreateBuffer()
+{
+	GLuint buffer = GL_NONE;
+	glGenBuffers(1, &buffer);
+	return buffer;
+}
+
+GLuint OpenGLRenderBackend::CreateVertexArray()
+{
+	GLuint vertexArray = GL_NONE;
+	glGenVertexArrays(1, &vertexArray);
+	return vertexArray;
+}
+
+GLuint OpenGLRenderBackend::CreateTexture()
+{
+	GLuint texture = GL_NONE;
+	glGenTextures(1, &texture);
+	return texture;
+}
+
+GLuint OpenGLRenderBackend::CreateFramebuffer()
+{
+	GLuint framebuffer = GL_NONE;
+	glGenFramebuffers(1, &framebuffer);
+	return framebuffer;
+}
+
+GLuint OpenGLRenderBackend::CreateShader(GLenum type)
+{
+	return glCreateShader(type);
+}
+
+GLuint OpenGLRenderBackend::CreateProgram()
+{
+	return glCreateProgram();
+}
+
+void OpenGLRenderBackend::DeleteBuffer(GLuint buffer)
+{
+	glDeleteBuffers(1, &buffer);
+}
+
+void OpenGLRenderBackend::DeleteVertexArray(GLuint vertexArray)
+{
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+void OpenGLRenderBackend::DeleteTexture(GLuint texture)
+{
+	glDeleteTextures(1, &texture);
+}
+
+void OpenGLRenderBackend::DeleteFramebuffer(GLuint framebuffer)
+{
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+void OpenGLRenderBackend::DeleteShader(GLuint shader)
+{
+	glDeleteShader(shader);
+}
+
+void OpenGLRenderBackend::DeleteProgram(GLuint program)
+{
+	glDeleteProgram(program);
+}
+
+void OpenGLRenderBackend::UseProgram(GLuint program)
+{
+	glUseProgram(program);
+}
+
+void OpenGLRenderBackend::ActiveTexture(int textureUnit)
+{
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+}
+
+void OpenGLRenderBackend::BindTexture(GLenum target, GLuint texture)
+{
+	glBindTexture(target, texture);
+}
+
+void OpenGLRenderBackend::BindVertexArray(GLuint vertexArray)
+{
+	glBindVertexArray(vertexArray);
+}
+
+void OpenGLRenderBackend::BindBuffer(GLenum target, GLuint buffer)
+{
+	glBindBuffer(target, buffer);
+}
+
+void OpenGLRenderBackend::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	glBindBufferBase(target, index, buffer);
+}
+
+void OpenGLRenderBackend::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	glBindFramebuffer(target, framebuffer);
+}
+
+void OpenGLRenderBackend::Enable(GLenum capability)
+{
+	glEnable(capability);
+}
+
+void OpenGLRenderBackend::Disable(GLenum capability)
+{
+	glDisable(capability);
+}
+
+void OpenGLRenderBackend::DepthMask(GLboolean enabled)
+{
+	glDepthMask(enabled);
+}
+
+void OpenGLRenderBackend::DepthFunc(GLenum func)
+{
+	glDepthFunc(func);
+}
+
+void OpenGLRenderBackend::BlendFunc(GLenum sourceFactor, GLenum destFactor)
+{
+	glBlendFunc(sourceFactor, destFactor);
+}
+
+void OpenGLRenderBackend::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glViewport(x, y, width, height);
+}
+
+void OpenGLRenderBackend::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+	glClearColor(r, g, b, a);
+}
+
+void OpenGLRenderBackend::ClearDepth(GLdouble depth)
+{
+	glClearDepth(depth);
+}
+
+void OpenGLRenderBackend::Clear(GLbitfield mask)
+{
+	glClear(mask);
+}
+
+void OpenGLRenderBackend::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	glBufferData(target, size, data, usage);
+}
+
+void OpenGLRenderBackend::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	glBufferSubData(target, offset, size, data);
+}
+
+void OpenGLRenderBackend::EnableVertexAttribArray(GLuint index)
+{
+	glEnableVertexAttribArray(index);
+}
+
+void OpenGLRenderBackend::DisableVertexAttribArray(GLuint index)
+{
+	glDisableVertexAttribArray(index);
+}
+
+void OpenGLRenderBackend::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* offset)
+{
+	glVertexAttribPointer(index, size, type, normalized, stride, offset);
+}
+
+void OpenGLRenderBackend::VertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	glVertexAttribDivisor(index, divisor);
+}
+
+void OpenGLRenderBackend::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+}
+
+void OpenGLRenderBackend::DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset)
+{
+	glDrawElements(mode, count, type, offset);
+}
+
+void OpenGLRenderBackend::DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+{
+	glDrawArraysInstanced(mode, first, count, instanceCount);
+}
+
+void OpenGLRenderBackend::DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount)
+{
+	glDrawElementsInstanced(mode, count, type, offset, instanceCount);
+}
+
+void OpenGLRenderBackend::TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	glTexImage2D(target, level, internalFormat, width, height, 0, format, type, pixels);
+}
+
+void OpenGLRenderBackend::TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+void OpenGLRenderBackend::TexParameteri(GLenum target, GLenum name, GLint value)
+{
+	glTexParameteri(target, name, value);
+}
+
+void OpenGLRenderBackend::TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer)
+{
+	glTexBuffer(target, internalFormat, buffer);
+}
+
+void OpenGLRenderBackend::FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level)
+{
+	glFramebufferTexture2D(target, attachment, textureTarget, texture, level);
+}
+
+void OpenGLRenderBackend::DrawBuffers(GLsizei count, const GLenum* buffers)
+{
+	glDrawBuffers(count, buffers);
+}
+
+GLenum OpenGLRenderBackend::CheckFramebufferStatus(GLenum target)
+{
+	return glCheckFramebufferStatus(target);
+}
+
+void OpenGLRenderBackend::ShaderSource(GLuint shader, const char* source)
+{
+	glShaderSource(shader, 1, &source, nullptr);
+}
+
+void OpenGLRenderBackend::CompileShader(GLuint shader)
+{
+	glCompileShader(shader);
+}
+
+void OpenGLRenderBackend::GetShaderiv(GLuint shader, GLenum name, GLint* value)
+{
+	glGetShaderiv(shader, name, value);
+}
+
+void OpenGLRenderBackend::GetShaderInfoLog(GLuint shader, GLsizei bufferSize, GLsizei* length, GLchar* log)
+{
+	glGetShaderInfoLog(shader, bufferSize, length, log);
+}
+
+void OpenGLRenderBackend::AttachShader(GLuint program, GLuint shader)
+{
+	glAttachShader(program, shader);
+}
+
+void OpenGLRenderBackend::DetachShader(GLuint program, GLuint shader)
+{
+	glDetachShader(program, shader);
+}
+
+void OpenGLRenderBackend::BindAttribLocation(GLuint program, GLuint index, const GLchar* name)
+{
+	glBindAttribLocation(program, index, name);
+}
+
+void OpenGLRenderBackend::LinkProgram(GLuint program)
+{
+	glLinkProgram(program);
+}
+
+void OpenGLRenderBackend::GetProgramiv(GLuint program, GLenum name, GLint* value)
+{
+	glGetProgramiv(program, name, value);
+}
+
+void OpenGLRenderBackend::GetProgramInfoLog(GLuint program, GLsizei bufferSize, GLsizei* length, GLchar* log)
+{
+	glGetProgramInfoLog(program, bufferSize, length, log);
+}
+
+void OpenGLRenderBackend::GetActiveUniform(GLuint program, GLuint index, GLsizei bufferSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+	glGetActiveUniform(program, index, bufferSize, length, size, type, name);
+}
+
+GLint OpenGLRenderBackend::GetUniformLocation(GLuint program, const GLchar* name)
+{
+	return glGetUniformLocation(program, name);
+}
+
+GLint OpenGLRenderBackend::GetAttribLocation(GLuint program, const GLchar* name)
+{
+	return glGetAttribLocation(program, name);
+}
+
+GLuint OpenGLRenderBackend::GetUniformBlockIndex(GLuint program, const GLchar* name)
+{
+	return glGetUniformBlockIndex(program, name);
+}
+
+void OpenGLRenderBackend::UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding)
+{
+	glUniformBlockBinding(program, blockIndex, binding);
+}
+
+void OpenGLRenderBackend::Uniform1i(GLint location, GLint value)
+{
+	glUniform1i(location, value);
+}
+
+void OpenGLRenderBackend::Uniform1f(GLint location, GLfloat value)
+{
+	glUniform1f(location, value);
+}
+
+void OpenGLRenderBackend::Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+	glUniform3f(location, x, y, z);
+}
+
+void OpenGLRenderBackend::Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+	glUniform4f(location, x, y, z, w);
+}
+
+void OpenGLRenderBackend::UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+	glUniformMatrix4fv(location, count, transpose, value);
+}
+
+void OpenGLRenderBackend::GetIntegerv(GLenum name, GLint* value)
+{
+	glGetIntegerv(name, value);
+}
@@ -0,0 +1,115 @@
+//
+// OpenGLRenderBackend.h
+//
+// Clark Kromenaker
+//
+// Renders with OpenGL 3.3, in an SDL window.
+//
+#pragma once
+#include "RenderBackend.h"
+
+#include <SDL2/SDL.h>
+
+class OpenGLRenderBackend : public RenderBackend
+{
+public:
+	// Creates a window with a GL 3.3 core context, and loads GL functions.
+	bool Initialize(const char* title, int width, int height) override;
+	void Shutdown() override;
+
+	// Swaps the window's back buffer to the front.
+	void Present() override;
+
+	// Object creation and deletion.
+	GLuint CreateBuffer() override;
+	GLuint CreateVertexArray() override;
+	GLuint CreateTexture() override;
+	GLuint CreateFramebuffer() override;
+	GLuint CreateShader(GLenum type) override;
+	GLuint CreateProgram() override;
+	void DeleteBuffer(GLuint buffer) override;
+	void DeleteVertexArray(GLuint vertexArray) override;
+	void DeleteTexture(GLuint texture) override;
+	void DeleteFramebuffer(GLuint framebuffer) override;
+	void DeleteShader(GLuint shader) override;
+	void DeleteProgram(GLuint program) override;
+
+	// Binds and fixed-function state.
+	void UseProgram(GLuint program) override;
+	void ActiveTexture(int textureUnit) override;
+	void BindTexture(GLenum target, GLuint texture) override;
+	void BindVertexArray(GLuint vertexArray) override;
+	void BindBuffer(GLenum target, GLuint buffer) override;
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+	void BindFramebuffer(GLenum target, GLuint framebuffer) override;
+	void Enable(GLenum capability) override;
+	void Disable(GLenum capability) override;
+	void DepthMask(GLboolean enabled) override;
+	void DepthFunc(GLenum func) override;
+	void BlendFunc(GLenum sourceFactor, GLenum destFactor) override;
+	void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) override;
+	void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) override;
+	void ClearDepth(GLdouble depth) override;
+	void Clear(GLbitfield mask) override;
+
+	// Buffer contents.
+	void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+	void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+
+	// Vertex layout, in the bound vertex array.
+	void EnableVertexAttribArray(GLuint index) override;
+	void DisableVertexAttribArray(GLuint index) override;
+	void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* offset) override;
+	void VertexAttribDivisor(GLuint index, GLuint divisor) override;
+
+	// Draws.
+	void DrawArrays(GLenum mode, GLint first, GLsizei count) override;
+	void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) override;
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) override;
+	void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) override;
+
+	// Texture contents, in the bound texture.
+	void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+	void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+	void TexParameteri(GLenum target, GLenum name, GLint value) override;
+	void TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) override;
+
+	// Framebuffer setup, in the bound framebuffer.
+	void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) override;
+	void DrawBuffers(GLsizei count, const GLenum* buffers) override;
+	GLenum CheckFramebufferStatus(GLenum target) override;
+
+	// Shader compiling and linking.
+	void ShaderSource(GLuint shader, const char* source) override;
+	void CompileShader(GLuint shader) override;
+	void GetShaderiv(GLuint shader, GLenum name, GLint* value) override;
+	void GetShaderInfoLog(GLuint shader, GLsizei bufferSize, GLsizei* length, GLchar* log) override;
+	void AttachShader(GLuint program, GLuint shader) override;
+	void DetachShader(GLuint program, GLuint shader) override;
+	void BindAttribLocation(GLuint program, GLuint index, const GLchar* name) override;
+	void LinkProgram(GLuint program) override;
+	void GetProgramiv(GLuint program, GLenum name, GLint* value) override;
+	void GetProgramInfoLog(GLuint program, GLsizei bufferSize, GLsizei* length, GLchar* log) override;
+
+	// Shader inputs.
+	void GetActiveUniform(GLuint program, GLuint index, GLsizei bufferSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name) override;
+	GLint GetUniformLocation(GLuint program, const GLchar* name) override;
+	GLint GetAttribLocation(GLuint program, const GLchar* name) override;
+	GLuint GetUniformBlockIndex(GLuint program, const GLchar* name) override;
+	void UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) override;
+
+	// Uniform values, in the program in use.
+	void Uniform1i(GLint location, GLint value) override;
+	void Uniform1f(GLint location, GLfloat value) override;
+	void Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) override;
+	void Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) override;
+	void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) override;
+
+	// Queries.
+	void GetIntegerv(GLenum name, GLint* value) override;
+
+private:
+	// Window that's rendered into, and its GL context.
+	SDL_Window* mWindow = nullptr;
+	SDL_GLContext mContext = nullptr;
+};
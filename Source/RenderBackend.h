@@ -0,0 +1,116 @@
+//
+// RenderBackend.h
+//
+// Clark Kromenaker
+//
+// Interface for whatever actually carries out rendering commands.
+//
+// Functions mirror the OpenGL calls the engine makes (same names without the "gl" prefix, same GL types and enums),
+// so engine code reads the same regardless of backend. The OpenGL backend passes them straight to GL.
+// Other backends (e.g. the null backend) can run without a GPU, as long as they act enough like GL for the engine to carry on.
+//
+// Engine code doesn't use a backend directly for binds and fixed-function state - those go through GLState, which skips redundant calls.
+//
+#pragma once
+#include <GL/glew.h>
+
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() { }
+
+	// Creates a window/context (or whatever the backend needs) to render into.
+	virtual bool Initialize(const char* title, int width, int height) = 0;
+	virtual void Shutdown() = 0;
+
+	// Shows everything rendered this frame.
+	virtual void Present() = 0;
+
+	// Object creation and deletion.
+	virtual GLuint CreateBuffer() = 0;
+	virtual GLuint CreateVertexArray() = 0;
+	virtual GLuint CreateTexture() = 0;
+	virtual GLuint CreateFramebuffer() = 0;
+	virtual GLuint CreateShader(GLenum type) = 0;
+	virtual GLuint CreateProgram() = 0;
+	virtual void DeleteBuffer(GLuint buffer) = 0;
+	virtual void DeleteVertexArray(GLuint vertexArray) = 0;
+	virtual void DeleteTexture(GLuint texture) = 0;
+	virtual void DeleteFramebuffer(GLuint framebuffer) = 0;
+	virtual void DeleteShader(GLuint shader) = 0;
+	virtual void DeleteProgram(GLuint program) = 0;
+
+	// Binds and fixed-function state.
+	virtual void UseProgram(GLuint program) = 0;
+	virtual void ActiveTexture(int textureUnit) = 0;
+	virtual void BindTexture(GLenum target, GLuint texture) = 0;
+	virtual void BindVertexArray(GLuint vertexArray) = 0;
+	virtual void BindBuffer(GLenum target, GLuint buffer) = 0;
+	virtual void BindBufferBase(GLenum target, GLuint index, GLuint buffer) = 0;
+	virtual void BindFramebuffer(GLenum target, GLuint framebuffer) = 0;
+	virtual void Enable(GLenum capability) = 0;
+	virtual void Disable(GLenum capability) = 0;
+	virtual void DepthMask(GLboolean enabled) = 0;
+	virtual void DepthFunc(GLenum func) = 0;
+	virtual void BlendFunc(GLenum sourceFactor, GLenum destFactor) = 0;
+	virtual void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+	virtual void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) = 0;
+	virtual void ClearDepth(GLdouble depth) = 0;
+	virtual void Clear(GLbitfield mask) = 0;
+
+	// Buffer contents.
+	virtual void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) = 0;
+	virtual void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+
+	// Vertex layout, in the bound vertex array.
+	virtual void EnableVertexAttribArray(GLuint index) = 0;
+	virtual void DisableVertexAttribArray(GLuint index) = 0;
+	virtual void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* offset) = 0;
+	virtual void VertexAttribDivisor(GLuint index, GLuint divisor) = 0;
+
+	// Draws.
+	virtual void DrawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+	virtual void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) = 0;
+	virtual void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) = 0;
+	virtual void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) = 0;
+
+	// Texture contents, in the bound texture.
+	virtual void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) = 0;
+	virtual void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) = 0;
+	virtual void TexParameteri(GLenum target, GLenum name, GLint value) = 0;
+	virtual void TexBuffer(GLenum target, GLenum internalFormat, GLuint buffer) = 0;
+
+	// Framebuffer setup, in the bound framebuffer.
+	virtual void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) = 0;
+	virtual void DrawBuffers(GLsizei count, const GLenum* buffers) = 0;
+	virtual GLenum CheckFramebufferStatus(GLenum target) = 0;
+
+	// Shader compiling and linking.
+	virtual void ShaderSource(GLuint shader, const char* source) = 0;
+	virtual void CompileShader(GLuint shader) = 0;
+	virtual void GetShaderiv(GLuint shader, GLenum name, GLint* value) = 0;
+	virtual void GetShaderInfoLog(GLuint shader, GLsizei bufferSize, GLsizei* length, GLchar* log) = 0;
+	virtual void AttachShader(GLuint program, GLuint shader) = 0;
+	virtual void DetachShader(GLuint program, GLuint shader) = 0;
+	virtual void BindAttribLocation(GLuint program, GLuint index, const GLchar* name) = 0;
+	virtual void LinkProgram(GLuint program) = 0;
+	virtual void GetProgramiv(GLuint program, GLenum name, GLint* value) = 0;
+	virtual void GetProgramInfoLog(GLuint program, GLsizei bufferSize, GLsizei* length, GLchar* log) = 0;
+
+	// Shader inputs.
+	virtual void GetActiveUniform(GLuint program, GLuint index, GLsizei bufferSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name) = 0;
+	virtual GLint GetUniformLocation(GLuint program, const GLchar* name) = 0;
+	virtual GLint GetAttribLocation(GLuint program, const GLchar* name) = 0;
+	virtual GLuint GetUniformBlockIndex(GLuint program, const GLchar* name) = 0;
+	virtual void UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) = 0;
+
+	// Uniform values, in the program in use.
+	virtual void Uniform1i(GLint location, GLint value) = 0;
+	virtual void Uniform1f(GLint location, GLfloat value) = 0;
+	virtual void Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) = 0;
+	virtual void Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) = 0;
+	virtual void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) = 0;
+
+	// Queries.
+	virtual void GetIntegerv(GLenum name, GLint* value) = 0;
+};
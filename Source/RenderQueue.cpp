@@ -0,0 +1,83 @@
+//
+// RenderQueue.cpp
+//
+// Clark Kromenaker
+//
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const int kShaderBits = 10;
+	const int kTextureBits = 14;
+	const int kMeshBits = 14;
+	const int kDepthBits = 24;
+
+	// Hashes a pointer down to a few bits. Fibonacci hashing spreads nearby addresses across the whole range.
+	uint64_t HashPointer(const void* pointer, int bits)
+	{
+		if(pointer == nullptr) { return 0; }
+		uint64_t value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer));
+		return (value * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+	}
+
+	// For positive floats, the IEEE bit pattern increases as the value does.
+	// So the top bits of the pattern can be compared as an integer, with no need to know the max depth.
+	uint64_t QuantizeDepth(float depth)
+	{
+		if(!(depth > 0.0f)) { return 0; }
+		uint32_t bits = 0;
+		memcpy(&bits, &depth, sizeof(bits));
+		return bits >> (32 - kDepthBits);
+	}
+}
+
+uint64_t RenderQueue::MakeKey(Pass pass, const void* shader, const void* texture, const void* mesh, float depth)
+{
+	uint64_t key = static_cast<uint64_t>(pass) << 62;
+	uint64_t state = (HashPointer(shader, kShaderBits) << (kTextureBits + kMeshBits)) |
+					 (HashPointer(texture, kTextureBits) << kMeshBits) |
+					 HashPointer(mesh, kMeshBits);
+	uint64_t depthBits = QuantizeDepth(depth);
+	if(pass == Pass::Opaque)
+	{
+		// State first, then front-to-back.
+		key |= (state << kDepthBits) | depthBits;
+	}
+	else
+	{
+		// Back-to-front first, then state.
+		uint64_t invertedDepth = ((1ULL << kDepthBits) - 1) - depthBits;
+		key |= (invertedDepth << (kShaderBits + kTextureBits + kMeshBits)) | state;
+	}
+	return key;
+}
+
+RenderQueue::Item& RenderQueue::Add(uint64_t sortKey)
+{
+	mItems.emplace_back();
+	mItems.back().sortKey = sortKey;
+	return mItems.back();
+}
+
+void RenderQueue::Sort()
+{
+	std::stable_sort(mItems.begin(), mItems.end(), [](const Item& a, const Item& b) {
+		return a.sortKey < b.sortKey;
+	});
+}
+
+void RenderQueue::GetPassRange(Pass pass, int& start, int& end) const
+{
+	// Items are sorted by pass first, so each pass is one contiguous range.
+	auto startIt = std::lower_bound(mItems.begin(), mItems.end(), pass, [](const Item& item, Pass p) {
+		return GetPass(item.sortKey) < p;
+	});
+	auto endIt = std::upper_bound(startIt, mItems.end(), pass, [](Pass p, const Item& item) {
+		return p < GetPass(item.sortKey);
+	});
+	start = static_cast<int>(startIt - mItems.begin());
+	end = static_cast<int>(endIt - mItems.begin());
+}
@@ -0,0 +1,100 @@
+//
+// RenderQueue.h
+//
+// Clark Kromenaker
+//
+// Collects submesh draws for a frame, so they can be sorted before any are drawn.
+//
+// Each item gets a 64-bit sort key. Sorting by key groups items by render pass, and
+// orders items within a pass to reduce state changes and overdraw:
+//
+//  Opaque:      [pass:2][shader:10][texture:14][mesh:14][depth:24]
+//  Translucent: [pass:2][inverted depth:24][shader:10][texture:14][mesh:14]
+//
+// Opaque items are grouped by shader and texture first, since switching those is expensive.
+// Within a group, items of the same mesh end up together (so they can be instanced) and are drawn front-to-back.
+// Translucent items must blend over what's behind them, so they're drawn strictly back-to-front.
+//
+// Shader, texture, and mesh IDs are hashed from pointers. A hash collision only makes sorting less effective;
+// whoever executes the queue still compares actual pointers to decide when state changes.
+//
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Matrix4.h"
+
+class Material;
+class MeshRenderer;
+class Submesh;
+
+// Stats from the most recently executed render queue, for debugging/profiling.
+struct RenderQueueStats
+{
+	// Mesh renderers that added items to the queue, and those skipped for being outside the view frustum.
+	int renderersDrawn = 0;
+	int renderersCulled = 0;
+
+	// Items drawn, and draw calls used to draw them.
+	int itemsRendered = 0;
+	int drawCalls = 0;
+
+	// Instanced draw calls, and items drawn by them.
+	int instancedDrawCalls = 0;
+	int instancedItems = 0;
+
+	// Number of times the active shader or diffuse texture changed between draws.
+	int shaderChanges = 0;
+	int textureChanges = 0;
+};
+
+class RenderQueue
+{
+public:
+	enum class Pass
+	{
+		Opaque,
+		Translucent
+	};
+
+	struct Item
+	{
+		uint64_t sortKey = 0;
+
+		Submesh* submesh = nullptr;
+		Material* material = nullptr;
+		Matrix4 objectToWorldMatrix;
+
+		// Renderer that submitted the item, and which of its submeshes this is.
+		// Used for per-renderer state (e.g. GPU vertex animation) when drawing.
+		MeshRenderer* meshRenderer = nullptr;
+		int meshIndex = 0;
+		int submeshIndex = 0;
+
+		// If false, this item has per-draw state and can't be drawn in an instanced draw with other items.
+		bool instanceable = true;
+	};
+
+	// Builds a sort key for an item in a pass. Depth is distance from the camera; negative depths are treated as zero.
+	static uint64_t MakeKey(Pass pass, const void* shader, const void* texture, const void* mesh, float depth);
+
+	// Gets the pass from a sort key.
+	static Pass GetPass(uint64_t sortKey) { return static_cast<Pass>(sortKey >> 62); }
+
+	void Clear() { mItems.clear(); }
+
+	// Adds an item with a sort key (see MakeKey). Fill in the returned item before the queue is sorted.
+	Item& Add(uint64_t sortKey);
+
+	// Sorts all items by sort key. Items with equal keys keep the order they were added in.
+	void Sort();
+
+	// Gets the sorted items in a pass as a range of indexes [start, end).
+	void GetPassRange(Pass pass, int& start, int& end) const;
+
+	std::vector<Item>& GetItems() { return mItems; }
+	const std::vector<Item>& GetItems() const { return mItems; }
+
+private:
+	std::vector<Item> mItems;
+};
@@ -6,6 +6,7 @@
 //
 #include "Renderer.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -16,9 +17,14 @@
 #include "BSP.h"
 #include "Debug.h"
 #include "Camera.h"
+#include "Frustum.h"
+#include "GLState.h"
 #include "Matrix4.h"
+#include "Mesh.h"
 #include "MeshRenderer.h"
 #include "Model.h"
+#include "NullRenderBackend.h"
+#include "OpenGLRenderBackend.h"
 #include "RenderTransforms.h"
 #include "Shader.h"
 #include "Skybox.h"
@@ -110,35 +116,23 @@ float ui_quad_uvs[] = {
 
 Mesh* uiQuad = nullptr;
 
-bool Renderer::Initialize()
+bool Renderer::Initialize(bool headless)
 {
-    // Init video subsystem.
-    if(SDL_InitSubSystem(SDL_INIT_VIDEO) != 0)
+    // Headless rendering doesn't need a window or GPU, but still records what would be rendered.
+    // Without a window, SDL events must be initialized separately (video does it for us otherwise).
+    if(headless)
+    {
+        if(SDL_InitSubSystem(SDL_INIT_EVENTS) != 0) { return false; }
+        mBackend = new NullRenderBackend();
+    }
+    else
+    {
+        mBackend = new OpenGLRenderBackend();
+    }
+    if(!mBackend->Initialize("GK3", mScreenWidth, mScreenHeight))
     {
         return false;
     }
-    
-    // Tell SDL we want to use OpenGL 3.3
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-    
-    // Request some GL parameters, just in case
-    SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-    SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-    SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-    SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
-    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-    SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
-    
-    // Create a window.
-    mWindow = SDL_CreateWindow("GK3", 100, 100, mScreenWidth, mScreenHeight, SDL_WINDOW_OPENGL);
-    if(!mWindow) { return false; }
-    
-    // Create OpenGL context.
-    mContext = SDL_GL_CreateContext(mWindow);
 	
 	/*
 	// For debugging display count stuff...
@@ -152,29 +146,22 @@ bool Renderer::Initialize()
 	}
 	*/
 	
-    // Initialize GLEW.
-    glewExperimental = GL_TRUE;
-    if(glewInit() != GLEW_OK)
-    {
-        SDL_Log("Failed to initialize GLEW.");
-        return false;
-    }
-    
-    // Clear any GLEW error.
-    glGetError();
+    // All rendering goes through the backend from here on.
+    // Setting it also resets cached state: nothing is known about state in a new context, so the first state change of each kind must be issued.
+    GLState::SetBackend(mBackend);
     
     // Our clear color will be BLACK!
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    mBackend->ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     
     // For use with alpha blending during render loop.
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
 #if VIEW_HAND == VIEW_LH
     // We can use left-hand or right-hand view space, but GL's depth buffer defaults assume right-hand.
     // If using left-hand, we essentially "flip" the depth buffer.
     // Clear to 0 (instead of 1) and use GL_GREATER for depth tests (rather than GL_LESS).
-    glClearDepth(0);
-    glDepthFunc(GL_GREATER);
+    mBackend->ClearDepth(0);
+    GLState::DepthFunc(GL_GREATER);
 #endif
 	
     // Load default shader.
@@ -247,27 +234,38 @@ bool Renderer::Initialize()
     Submesh* uiQuadSubmesh = uiQuad->AddSubmesh(meshDefinition);
 	uiQuadSubmesh->SetRenderMode(RenderMode::Triangles);
     
+    // Create buffer for instanced draw matrices. It's filled in each frame.
+    mInstanceBuffer = mBackend->CreateBuffer();
+    
     // Init succeeded!
     return true;
 }
 
 void Renderer::Shutdown()
 {
-    SDL_GL_DeleteContext(mContext);
-    SDL_DestroyWindow(mWindow);
-    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    GLState::DeleteBuffer(mInstanceBuffer);
+    mInstanceBuffer = GL_NONE;
+    
+    // Anything deleted after this (e.g. static textures) has nothing to delete from.
+    GLState::SetBackend(nullptr);
+    if(mBackend != nullptr)
+    {
+        mBackend->Shutdown();
+        delete mBackend;
+        mBackend = nullptr;
+    }
 }
 
 void Renderer::Render()
 {
 	// Enable opaque rendering (no blend, write to & test depth buffer).
 	// Do this BEFORE clear to avoid some glitchy graphics.
-	glDisable(GL_BLEND); // do not perform alpha blending (opaque rendering)
-	glDepthMask(GL_TRUE); // start writing to depth buffer
-	glEnable(GL_DEPTH_TEST); // do depth comparisons and update the depth buffer
+	GLState::Disable(GL_BLEND); // do not perform alpha blending (opaque rendering)
+	GLState::DepthMask(GL_TRUE); // start writing to depth buffer
+	GLState::Enable(GL_DEPTH_TEST); // do depth comparisons and update the depth buffer
 	
 	// Clear color and depth buffers from last frame.
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	mBackend->Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	
 	// Render camera-oriented stuff.
     Matrix4 projectionMatrix;
@@ -278,10 +276,13 @@ void Renderer::Render()
         projectionMatrix = mCamera->GetProjectionMatrix();
         viewMatrix = mCamera->GetLookAtMatrix();
         
+        // Anything outside the view frustum isn't visible, so BSP and meshes can skip drawing it.
+        Frustum frustum(projectionMatrix * viewMatrix);
+        
         // SKYBOX RENDERING
         // Draw the skybox first, which is just a little cube around the camera.
         // Don't write to depth mask, or else you can ONLY see skybox (b/c again, little cube).
-        glDepthMask(GL_FALSE); // stops writing to depth buffer
+        GLState::DepthMask(GL_FALSE); // stops writing to depth buffer
         if(mSkybox != nullptr)
         {
             // To get the "infinite distance" skybox effect, we need to use a look-at
@@ -290,7 +291,7 @@ void Renderer::Render()
             Material::SetProjMatrix(projectionMatrix);
             mSkybox->Render();
         }
-        glDepthMask(GL_TRUE); // start writing to depth buffer
+        GLState::DepthMask(GL_TRUE); // start writing to depth buffer
         
         // OPAQUE WORLD RENDERING
         // All opaque world rendering uses alpha test.
@@ -304,17 +305,14 @@ void Renderer::Render()
         // Render opaque BSP. This should occur front-to-back, which has no overdraw.
         if(mBSP != nullptr)
         {
-            mBSP->RenderOpaque(mCamera->GetOwner()->GetPosition(), mCamera->GetOwner()->GetForward());
+            mBSP->RenderOpaque(mCamera->GetOwner()->GetPosition(), frustum);
         }
         
         // OPAQUE MESH RENDERING
-        // Render opaque meshes (no particular order).
-        // Sorting is probably not worthwhile b/c BSP likely mostly filled the z-buffer at this point.
-        // And with the z-buffer, we can render opaque meshed correctly regardless of order.
-        for(auto& meshRenderer : mMeshRenderers)
-        {
-            meshRenderer->RenderOpaque();
-        }
+        // Render opaque meshes, sorted by the render queue to minimize shader and texture changes.
+        // Within the same shader and texture, meshes are drawn front-to-back, though the BSP has likely mostly filled the z-buffer at this point.
+        BuildRenderQueue(frustum);
+        ExecuteRenderQueue(RenderQueue::Pass::Opaque);
         
         // Turn off alpha test.
         Material::UseAlphaTest(false);
@@ -323,13 +321,18 @@ void Renderer::Render()
         // So far, GK3 doesn't seem to have any translucent geometry AT ALL!
         // Everything is either opaque or alpha test.
         // If we DO need translucent rendering, it probably can only be meshes or BSP, but not both.
-        //TODO: Any translucent world rendering.
+        // Translucent meshes are drawn back-to-front, blending over what's already drawn.
+        GLState::Enable(GL_BLEND);
+        GLState::DepthMask(GL_FALSE);
+        ExecuteRenderQueue(RenderQueue::Pass::Translucent);
+        GLState::DepthMask(GL_TRUE);
+        GLState::Disable(GL_BLEND);
     }
     
     // UI RENDERING (TRANSLUCENT)
-    glEnable(GL_BLEND); // do alpha blending
-    glDepthMask(GL_FALSE); // don't write to the depth buffer
-    glDisable(GL_DEPTH_TEST); // no depth test b/c UI draws over everything
+    GLState::Enable(GL_BLEND); // do alpha blending
+    GLState::DepthMask(GL_FALSE); // don't write to the depth buffer
+    GLState::Disable(GL_DEPTH_TEST); // no depth test b/c UI draws over everything
     
     // UI uses a view/proj setup for now - world space for UI maps to pixel size of screen.
     // Bottom-left corner of screen is origin, +x is right, +y is up.
@@ -348,7 +351,7 @@ void Renderer::Render()
     // Switch back to opaque rendering for debug rendering.
     // Debug rendering happens after all else, so any previous function can ask for debug draws successfully.
     // Also, don't bother with depth write or depth test so debug lines aren't obfuscated!
-    glDisable(GL_BLEND); // do not perform alpha blending
+    GLState::Disable(GL_BLEND); // do not perform alpha blending
     
     // Gotta reset view/proj again...
     Material::SetViewMatrix(viewMatrix);
@@ -362,7 +365,8 @@ void Renderer::Render()
     Debug::Render();
     
 	// Present to window.
-	SDL_GL_SwapWindow(mWindow);
+	GLState::EndFrame();
+	mBackend->Present();
 }
 
 void Renderer::AddMeshRenderer(MeshRenderer* mr)
@@ -387,3 +391,91 @@ void Renderer::SetSkybox(Skybox* skybox)
 		mSkybox->SetMaterial(mSkyboxMaterial);
 	}
 }
+
+void Renderer::BuildRenderQueue(const Frustum& frustum)
+{
+    mRenderQueueStats = RenderQueueStats();
+    
+    // Collect items from all visible mesh components, and sort them.
+    // Culled mesh components never make it into the queue, so they don't cost any material changes or draws.
+    mRenderQueue.Clear();
+    Vector3 cameraPosition = mCamera->GetOwner()->GetPosition();
+    for(auto& meshRenderer : mMeshRenderers)
+    {
+        if(!meshRenderer->IsActiveAndEnabled()) { continue; }
+        if(!frustum.IntersectsAABB(meshRenderer->GetAABB()))
+        {
+            ++mRenderQueueStats.renderersCulled;
+            continue;
+        }
+        ++mRenderQueueStats.renderersDrawn;
+        meshRenderer->AddToRenderQueue(mRenderQueue, cameraPosition);
+    }
+    mRenderQueue.Sort();
+    
+    // Upload matrices for all items at once. A run of instanced items then uses a range of this buffer.
+    const std::vector<RenderQueue::Item>& items = mRenderQueue.GetItems();
+    if(items.empty()) { return; }
+    mInstanceMatrices.resize(items.size());
+    for(int i = 0; i < items.size(); ++i)
+    {
+        mInstanceMatrices[i] = items[i].objectToWorldMatrix;
+    }
+    GLState::BindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+    mBackend->BufferData(GL_ARRAY_BUFFER, mInstanceMatrices.size() * sizeof(Matrix4), &mInstanceMatrices[0], GL_STREAM_DRAW);
+}
+
+void Renderer::ExecuteRenderQueue(RenderQueue::Pass pass)
+{
+    int start = 0;
+    int end = 0;
+    mRenderQueue.GetPassRange(pass, start, end);
+    
+    std::vector<RenderQueue::Item>& items = mRenderQueue.GetItems();
+    Shader* lastShader = nullptr;
+    Texture* lastTexture = nullptr;
+    int runStart = start;
+    while(runStart < end)
+    {
+        // Consecutive items with the same submesh and material can be one instanced draw (if the shader supports it).
+        // Materials are compared by contents, since copies of a model share submeshes but each has its own materials.
+        RenderQueue::Item& item = items[runStart];
+        int runEnd = runStart + 1;
+        if(item.instanceable && item.material->GetShader()->SupportsInstancing())
+        {
+            while(runEnd < end && items[runEnd].instanceable && items[runEnd].submesh == item.submesh && *items[runEnd].material == *item.material)
+            {
+                ++runEnd;
+            }
+        }
+        
+        // Track state changes. Sorting is meant to keep these low.
+        Shader* shader = item.material->GetShader();
+        Texture* texture = item.material->GetDiffuseTexture();
+        if(shader != lastShader) { ++mRenderQueueStats.shaderChanges; }
+        if(texture != lastTexture) { ++mRenderQueueStats.textureChanges; }
+        lastShader = shader;
+        lastTexture = texture;
+        
+        int runLength = runEnd - runStart;
+        if(runLength > 1)
+        {
+            item.material->ActivateInstanced();
+            item.submesh->RenderInstanced(mInstanceBuffer, runStart, runLength);
+            ++mRenderQueueStats.instancedDrawCalls;
+            mRenderQueueStats.instancedItems += runLength;
+        }
+        else
+        {
+            item.material->Activate(item.objectToWorldMatrix);
+            if(item.meshRenderer != nullptr)
+            {
+                item.meshRenderer->ActivateGPUVertexAnimation(*item.material, item.meshIndex, item.submeshIndex);
+            }
+            item.submesh->Render();
+        }
+        ++mRenderQueueStats.drawCalls;
+        mRenderQueueStats.itemsRendered += runLength;
+        runStart = runEnd;
+    }
+}
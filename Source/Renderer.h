@@ -13,19 +13,23 @@
 
 #include "Material.h"
 #include "Matrix4.h"
+#include "RenderQueue.h"
 #include "Vector2.h"
 
 class BSP;
 class Camera;
+class Frustum;
 class MeshRenderer;
 class Model;
+class RenderBackend;
 class Shader;
 class Skybox;
 
 class Renderer
 {
 public:
-    bool Initialize();
+    // If headless, renders without a window or GPU (see NullRenderBackend).
+    bool Initialize(bool headless = false);
     void Shutdown();
     
     void Render();
@@ -37,6 +41,7 @@ public:
     void RemoveMeshRenderer(MeshRenderer* mc);
     
     void SetBSP(BSP* bsp) { mBSP = bsp; }
+    BSP* GetBSP() { return mBSP; }
     
 	void SetSkybox(Skybox* skybox);
     
@@ -45,22 +50,30 @@ public:
 	
 	Vector2 GetWindowSize() { return Vector2(static_cast<float>(mScreenWidth), static_cast<float>(mScreenHeight)); }
     
+    const RenderQueueStats& GetRenderQueueStats() const { return mRenderQueueStats; }
+    
 private:
     // Screen's width and height, in pixels.
     int mScreenWidth = 1024;
     int mScreenHeight = 768;
     
-    // Handle for the window object (contains the game).
-    SDL_Window* mWindow = nullptr;
-    
-    // Context handle for rendering in OpenGL.
-    SDL_GLContext mContext;
+    // Carries out rendering - with OpenGL in a window, or headless.
+    RenderBackend* mBackend = nullptr;
     
     // Our camera in the scene - we currently only support one.
     Camera* mCamera = nullptr;
     
     // List of mesh components to render.
     std::vector<MeshRenderer*> mMeshRenderers;
+    
+    // Submesh draws collected from mesh components each frame, sorted to reduce state changes before drawing.
+    // Consecutive draws of the same submesh and material become one instanced draw.
+    RenderQueue mRenderQueue;
+    RenderQueueStats mRenderQueueStats;
+    
+    // Buffer of per-instance object to world matrices for instanced draws. Refilled each frame, in render queue order.
+    GLuint mInstanceBuffer = GL_NONE;
+    std::vector<Matrix4> mInstanceMatrices;
 	
     // A BSP to render.
     BSP* mBSP = nullptr;
@@ -68,4 +81,7 @@ private:
     // A skybox to render.
 	Material mSkyboxMaterial;
     Skybox* mSkybox = nullptr;
+    
+    void BuildRenderQueue(const Frustum& frustum);
+    void ExecuteRenderQueue(RenderQueue::Pass pass);
 };
@@ -100,6 +100,17 @@ void Scene::Load()
 	
 	// Set BSP to be rendered.
     Services::GetRenderer()->SetBSP(mSceneData->GetBSP());
+	
+	// Build floor heightfield from floor model triangles.
+	// Need to do this before creating any actors, since they'll want to snap to the floor right away.
+	BSP* bsp = mSceneData->GetBSP();
+	if(bsp != nullptr)
+	{
+		std::vector<Triangle> floorTriangles;
+		std::vector<int> floorSurfaceIndexes;
+		bsp->GetObjectTriangles(mSceneData->GetFloorModelName(), floorTriangles, floorSurfaceIndexes);
+		mFloorHeightfield.Build(floorTriangles, floorSurfaceIndexes);
+	}
     
     // Figure out if we have a skybox, and set it to be rendered.
     Services::GetRenderer()->SetSkybox(mSceneData->GetSkybox());
@@ -502,30 +513,31 @@ void Scene::Interact(const Ray& ray, GKObject* interactHint)
 
 float Scene::GetFloorY(const Vector3& position) const
 {
-	// Calculate ray origin using passed position, but really high in the air!
-	Vector3 rayOrigin = position;
-	rayOrigin.y = 10000.0f;
-	
-	// Create ray with origin high in the sky and pointing straight down.
-	Ray downRay(rayOrigin, -Vector3::UnitY);
-	
-	// Raycast straight down and test against the floor BSP.
-	// If we hit something, just use the Y hit position as the floor's Y.
-	BSP* bsp = mSceneData->GetBSP();
-	if(bsp != nullptr)
+	// Look up floor height in floor heightfield.
+	float floorY = 0.0f;
+	if(mFloorHeightfield.GetHeight(position, floorY))
 	{
-		RaycastHit hitInfo;
-		if(bsp->RaycastSingle(downRay, mSceneData->GetFloorModelName(), hitInfo))
-		{
-			return downRay.GetPoint(hitInfo.t).y;
-		}
+		return floorY;
 	}
 	
-	// If didn't hit floor, just return 0.
+	// If there's no floor here, just return 0.
 	// TODO: Maybe we should return a default based on the floor BSP's height?
 	return 0.0f;
 }
 
+Texture* Scene::GetFloorTexture(const Vector3& position) const
+{
+	// Look up floor surface, and then the texture used by that surface.
+	float floorY = 0.0f;
+	int surfaceIndex = -1;
+	BSP* bsp = mSceneData != nullptr ? mSceneData->GetBSP() : nullptr;
+	if(bsp != nullptr && mFloorHeightfield.GetHeight(position, floorY, surfaceIndex) && surfaceIndex >= 0)
+	{
+		return bsp->GetSurfaceTexture(surfaceIndex);
+	}
+	return nullptr;
+}
+
 GKActor* Scene::GetSceneObjectByModelName(const std::string& modelName) const
 {
 	for(auto& object : mObjects)
@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "Collisions.h"
+#include "Heightfield.h"
 #include "SceneData.h"
 #include "Timeblock.h"
 
@@ -59,6 +60,7 @@ public:
     void Interact(const Ray& ray, GKObject* interactHint = nullptr);
 	
 	float GetFloorY(const Vector3& position) const;
+	Texture* GetFloorTexture(const Vector3& position) const;
 	
 	const std::string& GetEgoName() const { return mEgoName; }
 	GKActor* GetEgo() const { return mEgo; }
@@ -109,6 +111,9 @@ private:
 	// Actors in the BSP.
 	std::vector<BSPActor*> mBSPActors;
 	
+	// Grid built from the floor model's triangles, for quickly finding floor height and floor texture at a position.
+	Heightfield mFloorHeightfield;
+	
     // The name of actor and actor who we are controlling in the scene.
 	// We sometimes need just the name - that's safer during scene loading.
 	std::string mEgoName;
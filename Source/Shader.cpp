@@ -5,17 +5,47 @@
 //
 #include "Shader.h"
 
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
 #include "Color32.h"
+#include "GLState.h"
+#include "Material.h"
 #include "Matrix4.h"
 #include "Vector3.h"
+#include "VertexArray.h"
 #include "VertexDefinition.h"
 
+const char* Shader::kCameraUniformBlockName = "CameraUniforms";
+
+namespace
+{
+    // Names of built-in uniforms, in the same order as the BuiltInUniform enum.
+    const char* kBuiltInUniformNames[] = {
+        "gObjectToWorldMatrix",
+        "gAlphaTest",
+        "gVertexAnimation",
+        "gVertexAnimationEnabled",
+        "gVertexAnimationOffset0",
+        "gVertexAnimationOffset1",
+        "gVertexAnimationBlend",
+        "gInstanced"
+    };
+    static_assert(sizeof(kBuiltInUniformNames) / sizeof(kBuiltInUniformNames[0]) == static_cast<int>(BuiltInUniform::Count), "Missing built-in uniform name!");
+}
+
 Shader::Shader(const char* vertShaderPath, const char* fragShaderPath)
 {
+    RenderBackend* backend = GLState::GetBackend();
+    
+    // No built-in uniforms are available unless the shader links successfully.
+    for(GLint& location : mBuiltInUniformLocations)
+    {
+        location = -1;
+    }
+    
     // Load vertex and fragment shaders, and compile them.
     GLuint vertexShader = LoadAndCompileShaderFromFile(vertShaderPath, GL_VERTEX_SHADER);
     GLuint fragmentShader = LoadAndCompileShaderFromFile(fragShaderPath, GL_FRAGMENT_SHADER);
@@ -23,116 +53,170 @@ Shader::Shader(const char* vertShaderPath, const char* fragShaderPath)
     // If either shader could not be compiled successfully, fail with an error.
     if(!IsShaderCompiled(vertexShader) || !IsShaderCompiled(fragmentShader))
     {
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        backend->DeleteShader(vertexShader);
+        backend->DeleteShader(fragmentShader);
         return;
     }
     
     // Assemble shader program.
-    mProgram = glCreateProgram();
-    glAttachShader(mProgram, vertexShader);
-    glAttachShader(mProgram, fragmentShader);
+    mProgram = backend->CreateProgram();
+    backend->AttachShader(mProgram, vertexShader);
+    backend->AttachShader(mProgram, fragmentShader);
     
     // Bind shader attribute names to attribute indexes.
     int semanticCount = static_cast<int>(VertexAttribute::Semantic::SemanticCount);
     for(int i = 0; i < semanticCount; ++i)
     {
-        glBindAttribLocation(mProgram, i, gAttributeNames[i]);
+        backend->BindAttribLocation(mProgram, i, gAttributeNames[i]);
     }
+    backend->BindAttribLocation(mProgram, VertexArray::kInstanceMatrixAttribute, VertexArray::kInstanceMatrixAttributeName);
     
     // Link the shader program.
-    glLinkProgram(mProgram);
+    backend->LinkProgram(mProgram);
     if(!IsProgramLinked(mProgram))
     {
-        glDeleteProgram(mProgram);
+        GLState::DeleteProgram(mProgram);
         mProgram = GL_NONE;
         
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        backend->DeleteShader(vertexShader);
+        backend->DeleteShader(fragmentShader);
         return;
     }
     
     // Detach shaders after a successful link.
-    glDetachShader(mProgram, vertexShader);
-    glDetachShader(mProgram, fragmentShader);
+    backend->DetachShader(mProgram, vertexShader);
+    backend->DetachShader(mProgram, fragmentShader);
+    
+    // Unused attributes are optimized away, so this only finds the instance matrix if the shader actually uses it.
+    mSupportsInstancing = backend->GetAttribLocation(mProgram, VertexArray::kInstanceMatrixAttributeName) >= 0;
     
     // After shader program is compiled and linked, it's possible to query the program
-    // to determine the uniforms that exist in the program.
+    // to determine the uniforms that exist in the program. Looking up locations once here means setting uniforms later doesn't need to.
+    RefreshUniforms();
+    for(int i = 0; i < static_cast<int>(BuiltInUniform::Count); ++i)
+    {
+        mBuiltInUniformLocations[i] = GetUniformLocation(kBuiltInUniformNames[i]);
+    }
+    
+    // Camera matrices come from a uniform buffer that's shared by all shaders.
+    GLuint cameraBlockIndex = backend->GetUniformBlockIndex(mProgram, kCameraUniformBlockName);
+    if(cameraBlockIndex != GL_INVALID_INDEX)
+    {
+        backend->UniformBlockBinding(mProgram, cameraBlockIndex, kCameraUniformBlockBinding);
+    }
     
-    // This *may* be useful in the future so that a material knows what uniforms exist.
-    // But for now, we are assuming that the material has explicitly defined values for all uniforms.
-    //RefreshUniforms();
+    // Vertex animation sampler always uses its own texture unit, so it only needs to be set once.
+    Activate();
+    SetUniformInt(GetUniformLocation(BuiltInUniform::VertexAnimation), Material::kVertexAnimationTextureUnit);
 }
 
 Shader::~Shader()
 {
-    glDeleteProgram(mProgram);
+    GLState::DeleteProgram(mProgram);
 }
 
 void Shader::Activate()
 {
     if(mProgram != GL_NONE)
     {
-        glUseProgram(mProgram);
+        GLState::UseProgram(mProgram);
     }
 }
 
+GLint Shader::GetUniformLocation(const char* name) const
+{
+    for(auto& uniform : mUniforms)
+    {
+        if(uniform.name == name)
+        {
+            return uniform.location;
+        }
+    }
+    return -1;
+}
+
 void Shader::SetUniformInt(const char* name, int value)
 {
-    if(mProgram != GL_NONE)
+    SetUniformInt(GetUniformLocation(name), value);
+}
+
+void Shader::SetUniformInt(GLint location, int value)
+{
+    if(location >= 0)
     {
-        GLuint loc = glGetUniformLocation(mProgram, name);
-        glUniform1i(loc, value);
+        GLState::GetBackend()->Uniform1i(location, value);
     }
 }
 
 void Shader::SetUniformFloat(const char* name, float value)
 {
-    if(mProgram != GL_NONE)
+    SetUniformFloat(GetUniformLocation(name), value);
+}
+
+void Shader::SetUniformFloat(GLint location, float value)
+{
+    if(location >= 0)
     {
-        GLuint loc = glGetUniformLocation(mProgram, name);
-        glUniform1f(loc, value);
+        GLState::GetBackend()->Uniform1f(location, value);
     }
 }
 
 void Shader::SetUniformVector3(const char* name, const Vector3& vector)
 {
-    if(mProgram != GL_NONE)
+    SetUniformVector3(GetUniformLocation(name), vector);
+}
+
+void Shader::SetUniformVector3(GLint location, const Vector3& vector)
+{
+    if(location >= 0)
     {
-        GLuint vecLoc = glGetUniformLocation(mProgram, name);
-        glUniform3f(vecLoc, vector.x, vector.y, vector.z);
+        GLState::GetBackend()->Uniform3f(location, vector.x, vector.y, vector.z);
     }
 }
 
-void Shader::SetUniformVector4(const char *name, const Vector4& vector)
+void Shader::SetUniformVector4(const char* name, const Vector4& vector)
 {
-    if(mProgram != GL_NONE)
+    SetUniformVector4(GetUniformLocation(name), vector);
+}
+
+void Shader::SetUniformVector4(GLint location, const Vector4& vector)
+{
+    if(location >= 0)
     {
-        GLuint vecLoc = glGetUniformLocation(mProgram, name);
-        glUniform4f(vecLoc, vector.x, vector.y, vector.z, vector.w);
+        GLState::GetBackend()->Uniform4f(location, vector.x, vector.y, vector.z, vector.w);
     }
 }
 
 void Shader::SetUniformMatrix4(const char* name, const Matrix4& mat)
 {
-    if(mProgram != GL_NONE)
+    SetUniformMatrix4(GetUniformLocation(name), mat);
+}
+
+void Shader::SetUniformMatrix4(GLint location, const Matrix4& mat)
+{
+    if(location >= 0)
     {
-        GLuint loc = glGetUniformLocation(mProgram, name);
-        glUniformMatrix4fv(loc, 1, GL_FALSE, mat);
+        GLState::GetBackend()->UniformMatrix4fv(location, 1, GL_FALSE, mat);
     }
 }
 
 void Shader::SetUniformColor(const char* name, const Color32& color)
 {
-    if(mProgram != GL_NONE)
+    SetUniformColor(GetUniformLocation(name), color);
+}
+
+void Shader::SetUniformColor(GLint location, const Color32& color)
+{
+    if(location >= 0)
     {
-        GLuint vecLoc = glGetUniformLocation(mProgram, name);
-        glUniform4f(vecLoc, color.GetR() / 255.0f, color.GetG() / 255.0f, color.GetB() / 255.0f, color.GetA() / 255.0f);
+        GLState::GetBackend()->Uniform4f(location, color.GetR() / 255.0f, color.GetG() / 255.0f, color.GetB() / 255.0f, color.GetA() / 255.0f);
     }
 }
 
 GLuint Shader::LoadAndCompileShaderFromFile(const char* filePath, GLuint shaderType)
 {
+    RenderBackend* backend = GLState::GetBackend();
+    
     // Open the file, but freak out if not valid.
     std::ifstream file(filePath);
     if(!file.good())
@@ -150,26 +234,28 @@ GLuint Shader::LoadAndCompileShaderFromFile(const char* filePath, GLuint shaderT
     const char* fileContents = fileContentsStr.c_str();
     
     // Create shader, load file contents into it, and compile it.
-    GLuint shader = glCreateShader(shaderType);
-    glShaderSource(shader, 1, &fileContents, nullptr);
-    glCompileShader(shader);
+    GLuint shader = backend->CreateShader(shaderType);
+    backend->ShaderSource(shader, fileContents);
+    backend->CompileShader(shader);
     return shader;
 }
 
 bool Shader::IsShaderCompiled(GLuint shader)
 {
+    RenderBackend* backend = GLState::GetBackend();
+    
     // Ask GL whether compile succeeded for this shader.
     GLint compileSucceeded = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compileSucceeded);
+    backend->GetShaderiv(shader, GL_COMPILE_STATUS, &compileSucceeded);
     
     // If not, we'll output the error log and fail.
     if(compileSucceeded == GL_FALSE)
     {
         GLint errorLength = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &errorLength);
+        backend->GetShaderiv(shader, GL_INFO_LOG_LENGTH, &errorLength);
         
         GLchar* errorLog = new GLchar[errorLength];
-        glGetShaderInfoLog(shader, errorLength, &errorLength, errorLog);
+        backend->GetShaderInfoLog(shader, errorLength, &errorLength, errorLog);
         
         std::cout << "Error compiling shader: " << errorLog << std::endl;
         delete[] errorLog;
@@ -182,18 +268,20 @@ bool Shader::IsShaderCompiled(GLuint shader)
 
 bool Shader::IsProgramLinked(GLuint program)
 {
+    RenderBackend* backend = GLState::GetBackend();
+    
     // Ask GL whether link succeeded for this program.
     GLint linkSucceeded = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &linkSucceeded);
+    backend->GetProgramiv(program, GL_LINK_STATUS, &linkSucceeded);
     
     // If not, we'll output the error log and fail.
     if(linkSucceeded == GL_FALSE)
     {
         GLint errorLength = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &errorLength);
+        backend->GetProgramiv(program, GL_INFO_LOG_LENGTH, &errorLength);
         
         GLchar* errorLog = new GLchar[errorLength];
-        glGetProgramInfoLog(program, errorLength, &errorLength, errorLog);
+        backend->GetProgramInfoLog(program, errorLength, &errorLength, errorLog);
         
         std::cout << "Error linking shader program: " << errorLog << std::endl;
         delete[] errorLog;
@@ -204,32 +292,31 @@ bool Shader::IsProgramLinked(GLuint program)
     return true;
 }
 
-/*
 void Shader::RefreshUniforms()
 {
+    RenderBackend* backend = GLState::GetBackend();
+    
     // Save listing of uniforms used by this shader.
-    const GLsizei kMaxUniformNameLength = 32;
+    mUniforms.clear();
+    const GLsizei kMaxUniformNameLength = 64;
     GLchar uniformNameBuffer[kMaxUniformNameLength];
     GLsizei uniformNameLength = 0;
     GLsizei uniformSize = 0;
     GLenum uniformType = GL_NONE;
     
     GLint uniformCount = 0;
-    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+    backend->GetProgramiv(mProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
     for(GLuint i = 0; i < uniformCount; ++i)
     {
-        glGetActiveUniform(mProgram, i, kMaxUniformNameLength, &uniformNameLength, &uniformSize, &uniformType, uniformNameBuffer);
+        backend->GetActiveUniform(mProgram, i, kMaxUniformNameLength, &uniformNameLength, &uniformSize, &uniformType, uniformNameBuffer);
         
         // If returned name length is 0, that means the uniform is not valid (compile/link failed?).
         if(uniformNameLength <= 0) { continue; }
         
-        // We only want to track user-defined uniforms.
-        // We want to ignore built-in OpenGL uniforms, which have "gl_" prefix.
-        // We want to ignore built-in G-Engine uniforms, which have a "g" prefix.
-        // So really, we can just ignore any uniform with a "g" prefix to cover both scenarios!
-        if(uniformNameLength > 0 && uniformNameBuffer[0] == 'g') { continue; }
-        printf("Uniform %d, Type %u, Name %s\n", i, uniformType, uniformNameBuffer);
-           
+        // Ignore built-in OpenGL uniforms, which have "gl_" prefix.
+        // Built-in G-Engine uniforms (with a "g" prefix) are kept, so their locations can be looked up too.
+        if(strncmp(uniformNameBuffer, "gl_", 3) == 0) { continue; }
+        
         // Convert GLenum type to an actual enum type.
         UniformType type = UniformType::Unknown;
         switch(uniformType)
@@ -270,6 +357,10 @@ void Shader::RefreshUniforms()
         case GL_SAMPLER_2D:
             type = UniformType::Texture2D;
             break;
+        case GL_SAMPLER_BUFFER:
+            type = UniformType::TextureBuffer;
+            break;
+            
         case GL_SAMPLER_CUBE:
             type = UniformType::TextureCube;
             break;
@@ -280,13 +371,11 @@ void Shader::RefreshUniforms()
         }
         
         // Create and save uniform info.
-        if(type != UniformType::Unknown)
-        {
-            Uniform uniform;
-            uniform.type = type;
-            uniform.name = std::string(uniformNameBuffer);
-            mUniforms.push_back(uniform);
-        }
+        // Uniforms in a uniform block don't have a location - they're set through the block's buffer instead.
+        Uniform uniform;
+        uniform.type = type;
+        uniform.name = std::string(uniformNameBuffer);
+        uniform.location = backend->GetUniformLocation(mProgram, uniformNameBuffer);
+        mUniforms.push_back(uniform);
     }
 }
-*/
@@ -34,7 +34,8 @@ enum class UniformType
     Matrix4,
     
     Texture2D,
-    TextureCube
+    TextureCube,
+    TextureBuffer
     //TODO: Add more as needed
 };
 
@@ -45,34 +46,78 @@ struct Uniform
     
     // Uniform name.
     std::string name;
+    
+    // Location for setting the uniform's value. -1 for uniforms in a uniform block.
+    GLint location = -1;
+};
+
+// Uniforms the engine sets for any shader that declares them.
+enum class BuiltInUniform
+{
+    ObjectToWorldMatrix,
+    AlphaTest,
+    VertexAnimation,
+    VertexAnimationEnabled,
+    VertexAnimationOffset0,
+    VertexAnimationOffset1,
+    VertexAnimationBlend,
+    Instanced,
+    Count
 };
 
 class Shader
 {
 public:
+    // Uniform block for camera matrices (view, projection, and world to projection), shared by all shaders.
+    static const char* kCameraUniformBlockName;
+    static const GLuint kCameraUniformBlockBinding = 0;
+    
     Shader(const char* vertShaderPath, const char* fragShaderPath);
     ~Shader();
     
     void Activate();
     
+    // Uniform locations are looked up once, after linking. Returns -1 if the shader doesn't use the uniform.
+    // For uniforms set often, get the location once and use the location-based setters.
+    GLint GetUniformLocation(const char* name) const;
+    GLint GetUniformLocation(BuiltInUniform uniform) const { return mBuiltInUniformLocations[static_cast<int>(uniform)]; }
+    
+    // Setters do nothing if the location is -1. The shader must be active.
 	void SetUniformInt(const char* name, int value);
+	void SetUniformInt(GLint location, int value);
 	void SetUniformFloat(const char* name, float value);
+	void SetUniformFloat(GLint location, float value);
 	
     void SetUniformVector3(const char* name, const Vector3& vector);
+    void SetUniformVector3(GLint location, const Vector3& vector);
 	void SetUniformVector4(const char* name, const Vector4& vector);
+	void SetUniformVector4(GLint location, const Vector4& vector);
     
     void SetUniformMatrix4(const char* name, const Matrix4& mat);
+    void SetUniformMatrix4(GLint location, const Matrix4& mat);
     
     void SetUniformColor(const char* name, const Color32& color);
+    void SetUniformColor(GLint location, const Color32& color);
     
     bool IsGood() const { return mProgram != GL_NONE; }
     
+    // If true, the shader can be used for instanced draws (it reads object to world matrices from an instance attribute).
+    bool SupportsInstancing() const { return mSupportsInstancing; }
+    
 private:
     // Handle to the compiled and linked GL shader program.
     GLuint mProgram = GL_NONE;
     
-    // Uniforms for this shader, excluding "built-in" ones.
-    //std::vector<Uniform> mUniforms;
+    // Whether the shader uses the per-instance matrix attribute.
+    bool mSupportsInstancing = false;
+    
+    // Uniforms for this shader, including "built-in" ones.
+    std::vector<Uniform> mUniforms;
+    
+    // Locations of built-in uniforms, indexed by BuiltInUniform.
+    GLint mBuiltInUniformLocations[static_cast<int>(BuiltInUniform::Count)];
+    
+    void RefreshUniforms();
     
     GLuint LoadAndCompileShaderFromFile(const char* filePath, GLuint shaderType);
     
@@ -5,6 +5,7 @@
 //
 #include "Skybox.h"
 
+#include "GLState.h"
 #include "Mesh.h"
 #include "Services.h"
 #include "Texture.h"
@@ -71,6 +72,8 @@ Skybox::~Skybox()
 
 void Skybox::Render()
 {
+    RenderBackend* backend = GLState::GetBackend();
+    
     // Generate submesh on the fly, if not yet generated.
     if(mSkyboxMesh == nullptr)
     {
@@ -88,56 +91,56 @@ void Skybox::Render()
     
     if(mCubemapTextureId == GL_NONE)
     {
-        glActiveTexture(GL_TEXTURE0);
-        glGenTextures(1, &mCubemapTextureId);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, mCubemapTextureId);
+        GLState::ActiveTexture(0);
+        mCubemapTextureId = backend->CreateTexture();
+        GLState::BindTexture(GL_TEXTURE_CUBE_MAP, mCubemapTextureId);
         
         // Create each texture for the cubemap.
         // Note that we MUST create 6 textures, or the cubemap will not display properly.
         // Also, Front is -Z and Back is +Z. Not sure if this indicates a bug, or a conversion done in the original game, or what?
         if(mRightTexture != nullptr)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA,
-                         mRightTexture->GetWidth(), mRightTexture->GetHeight(), 0,
+            backend->TexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA,
+                         mRightTexture->GetWidth(), mRightTexture->GetHeight(),
                          GL_RGBA, GL_UNSIGNED_BYTE, mRightTexture->GetPixelData());
         }
         if(mLeftTexture != nullptr)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA,
-                         mLeftTexture->GetWidth(), mLeftTexture->GetHeight(), 0,
+            backend->TexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA,
+                         mLeftTexture->GetWidth(), mLeftTexture->GetHeight(),
                          GL_RGBA, GL_UNSIGNED_BYTE, mLeftTexture->GetPixelData());
         }
         if(mFrontTexture != nullptr)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA,
-                         mFrontTexture->GetWidth(), mFrontTexture->GetHeight(), 0,
+            backend->TexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA,
+                         mFrontTexture->GetWidth(), mFrontTexture->GetHeight(),
                          GL_RGBA, GL_UNSIGNED_BYTE, mFrontTexture->GetPixelData());
         }
         if(mBackTexture != nullptr)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, GL_RGBA,
-                         mBackTexture->GetWidth(), mBackTexture->GetHeight(), 0,
+            backend->TexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X, 0, GL_RGBA,
+                         mBackTexture->GetWidth(), mBackTexture->GetHeight(),
                          GL_RGBA, GL_UNSIGNED_BYTE, mBackTexture->GetPixelData());
         }
         if(mUpTexture != nullptr)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA,
-                         mUpTexture->GetWidth(), mUpTexture->GetHeight(), 0,
+            backend->TexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA,
+                         mUpTexture->GetWidth(), mUpTexture->GetHeight(),
                          GL_RGBA, GL_UNSIGNED_BYTE, mUpTexture->GetPixelData());
         }
         if(mDownTexture != nullptr)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA,
-                         mDownTexture->GetWidth(), mDownTexture->GetHeight(), 0,
+            backend->TexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA,
+                         mDownTexture->GetWidth(), mDownTexture->GetHeight(),
                          GL_RGBA, GL_UNSIGNED_BYTE, mDownTexture->GetPixelData());
         }
         
         // These settings help to avoid visible seams around the edges of the skybox.
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        backend->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        backend->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        backend->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        backend->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        backend->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     }
 	
 	// Activate the material (or fail).
@@ -145,8 +148,8 @@ void Skybox::Render()
 	mMaterial->Activate(Matrix4::Identity);
 	
 	// Activate and bind the cubemap texture.
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, mCubemapTextureId);
+    GLState::ActiveTexture(0);
+    GLState::BindTexture(GL_TEXTURE_CUBE_MAP, mCubemapTextureId);
 	
 	// Render the skybox.
     mSkyboxMesh->Render();
@@ -142,6 +142,31 @@ namespace StringUtil
         return std::equal(str1.begin(), str1.end(), str2.begin(), iequal());
     }
     
+    // Hash/equality functors for using strings as case-insensitive keys in unordered containers.
+    // Avoids needing to make lowercase copies of strings for every insert or lookup.
+    struct CaseInsensitiveHash
+    {
+        std::size_t operator()(const std::string& str) const
+        {
+            // FNV-1a hash of uppercased characters.
+            std::size_t hash = 2166136261u;
+            for(char c : str)
+            {
+                hash ^= static_cast<std::size_t>(std::toupper(static_cast<unsigned char>(c)));
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+    };
+    
+    struct CaseInsensitiveEquals
+    {
+        bool operator()(const std::string& str1, const std::string& str2) const
+        {
+            return EqualsIgnoreCase(str1, str2);
+        }
+    };
+    
     inline bool ToBool(const std::string& str)
     {
         // If the string is "yes" or "true", we'll say it converts to "true".
@@ -5,8 +5,11 @@
 //
 #include "Submesh.h"
 
+#include <cstring>
+
 #include "Collisions.h"
 #include "Ray.h"
+#include "VertexCompression.h"
 
 Submesh::Submesh(const MeshDefinition& meshDefinition) :
     mVertexCount(meshDefinition.vertexCount),
@@ -62,6 +65,25 @@ void Submesh::Render(unsigned int offset, unsigned int count) const
 	}
 }
 
+void Submesh::RenderInstanced(GLuint instanceBuffer, unsigned int firstInstance, unsigned int instanceCount) const
+{
+	GLenum mode = GL_TRIANGLES;
+	switch(mRenderMode)
+	{
+	default:
+	case RenderMode::Triangles:
+		mode = GL_TRIANGLES;
+		break;
+	case RenderMode::TriangleFan:
+		mode = GL_TRIANGLE_FAN;
+		break;
+	case RenderMode::Lines:
+		mode = GL_LINES;
+		break;
+	}
+	mVertexArray.DrawInstanced(mode, instanceBuffer, firstInstance, instanceCount);
+}
+
 Vector3 Submesh::GetVertexPosition(int index) const
 {
 	// Handle error cases.
@@ -83,58 +105,67 @@ bool Submesh::GetVertexNormal(int index, Vector3& n) const
 
 int Submesh::GetTriangleCount() const
 {
-	if(mRenderMode == RenderMode::Triangles)
+	int count = mIndexes != nullptr ? mIndexCount : mVertexCount;
+	switch(mRenderMode)
 	{
-		return mIndexes != nullptr ? (mIndexCount / 3) : (mVertexCount / 3);
+	case RenderMode::Triangles:
+		return count / 3;
+	case RenderMode::TriangleStrip:
+	case RenderMode::TriangleFan:
+		return count >= 3 ? count - 2 : 0;
+	default:
+		// Can't compute triangle count!
+		return 0;
 	}
-	//TODO: Add support for TriangleFan/TriangleStrip modes.
-	
-	// Can't compute triangle count!
-	return 0;
 }
 
 bool Submesh::GetTriangle(int index, Vector3& p0, Vector3& p1, Vector3& p2) const
 {
-	if(mRenderMode == RenderMode::Triangles)
-	{
-		if(mIndexes != nullptr)
-		{
-			int offset = index * 3;
-			p0 = GetVertexPosition(mIndexes[offset]);
-			p1 = GetVertexPosition(mIndexes[offset + 1]);
-			p2 = GetVertexPosition(mIndexes[offset + 2]);
-			return true;
-		}
-		//TODO: Add support if no indexes present
-	}
-	//TODO: Add support for triangle fans/strips.
+	if(index < 0 || index >= GetTriangleCount()) { return false; }
 	
-	return false;
-}
-
-bool Submesh::Raycast(const Ray& ray)
-{
-	if(mRenderMode != RenderMode::Triangles || mIndexes == nullptr)
+	// Figure out which vertices make up the triangle (or which indexes, if the submesh uses indexes).
+	int i0 = 0;
+	int i1 = 0;
+	int i2 = 0;
+	switch(mRenderMode)
 	{
-		std::cout << "Submesh::Raycast only supports Triangle meshes with indexes for now - aborting." << std::endl;
+	case RenderMode::Triangles:
+		i0 = index * 3;
+		i1 = i0 + 1;
+		i2 = i0 + 2;
+		break;
+	case RenderMode::TriangleStrip:
+		// Every other triangle in a strip has flipped winding; swap to keep winding consistent.
+		i0 = index;
+		i1 = index % 2 == 0 ? index + 1 : index + 2;
+		i2 = index % 2 == 0 ? index + 2 : index + 1;
+		break;
+	case RenderMode::TriangleFan:
+		i0 = 0;
+		i1 = index + 1;
+		i2 = index + 2;
+		break;
+	default:
 		return false;
 	}
 	
-    RaycastHit hitInfo;
-	for(int i = 0; i < mIndexCount; i += 3)
+	if(mIndexes != nullptr)
 	{
-		Vector3 vert1 = GetVertexPosition(mIndexes[i]);
-		Vector3 vert2 = GetVertexPosition(mIndexes[i + 1]);
-		Vector3 vert3 = GetVertexPosition(mIndexes[i + 2]);
-		
-		if(Collisions::TestRayTriangle(ray, vert1, vert2, vert3, hitInfo))
-		{
-			return true;
-		}
+		i0 = mIndexes[i0];
+		i1 = mIndexes[i1];
+		i2 = mIndexes[i2];
 	}
-	
-	// Ray did not hit any triangles.
-	return false;
+	p0 = GetVertexPosition(i0);
+	p1 = GetVertexPosition(i1);
+	p2 = GetVertexPosition(i2);
+	return true;
+}
+
+bool Submesh::Raycast(const Ray& ray, RaycastHit& hitInfo)
+{
+	UpdateBVH();
+	int triangleIndex = -1;
+	return mBVH.RaycastNearest(ray, [](int) { return true; }, hitInfo, triangleIndex);
 }
 
 void Submesh::SetPositions(float* positions, bool createCopy)
@@ -152,7 +183,15 @@ void Submesh::SetPositions(float* positions, bool createCopy)
     {
         mPositions = positions;
     }
-    mVertexArray.ChangeVertexData(VertexAttribute::Semantic::Position, mPositions);
+    MarkPositionsChanged();
+    UploadVertexData(VertexAttribute::Semantic::Position, mPositions);
+}
+
+void Submesh::MarkPositionsChanged()
+{
+	// Tag no longer describes the positions, and the BVH needs to be refit before the next raycast.
+	mPositionsTag = 0;
+	mBVHDirty = true;
 }
 
 void Submesh::SetColors(float* colors, bool createCopy)
@@ -170,7 +209,7 @@ void Submesh::SetColors(float* colors, bool createCopy)
     {
         mColors = colors;
     }
-    mVertexArray.ChangeVertexData(VertexAttribute::Semantic::Color, mColors);
+    UploadVertexData(VertexAttribute::Semantic::Color, mColors);
 }
 
 void Submesh::SetNormals(float* normals, bool createCopy)
@@ -188,7 +227,7 @@ void Submesh::SetNormals(float* normals, bool createCopy)
     {
         mNormals = normals;
     }
-    mVertexArray.ChangeVertexData(VertexAttribute::Semantic::Normal, mNormals);
+    UploadVertexData(VertexAttribute::Semantic::Normal, mNormals);
 }
 
 void Submesh::SetUV1s(float* uvs, bool createCopy)
@@ -206,7 +245,7 @@ void Submesh::SetUV1s(float* uvs, bool createCopy)
     {
         mUV1 = uvs;
     }
-    mVertexArray.ChangeVertexData(VertexAttribute::Semantic::UV1, mUV1);
+    UploadVertexData(VertexAttribute::Semantic::UV1, mUV1);
 }
 
 void Submesh::SetIndexes(unsigned short* indexes, bool createCopy)
@@ -226,3 +265,45 @@ void Submesh::SetIndexes(unsigned short* indexes, bool createCopy)
     }
     mVertexArray.ChangeIndexData(mIndexes, mIndexCount);
 }
+
+void Submesh::UpdateBVH()
+{
+	if(mBVHBuilt && !mBVHDirty) { return; }
+	
+	// Gather triangles in their current positions.
+	int triangleCount = GetTriangleCount();
+	mBVHTriangles.resize(triangleCount);
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		Triangle& triangle = mBVHTriangles[i];
+		GetTriangle(i, triangle.p0, triangle.p1, triangle.p2);
+	}
+	
+	// Building is slow, so only do it once. After that, just refit to new positions - triangle count doesn't change.
+	if(!mBVHBuilt)
+	{
+		mBVH.Build(mBVHTriangles);
+		mBVHBuilt = true;
+	}
+	else
+	{
+		mBVH.Refit(mBVHTriangles);
+	}
+	mBVHDirty = false;
+}
+
+void Submesh::UploadVertexData(VertexAttribute::Semantic semantic, float* data)
+{
+	// Compact attribute formats need float data converted before upload.
+	const VertexAttribute* attribute = mVertexArray.GetVertexDefinition().GetAttribute(semantic);
+	if(attribute != nullptr && attribute->type != VertexAttribute::Type::Float && data != nullptr)
+	{
+		std::vector<uint8_t> encoded(mVertexCount * attribute->GetSize());
+		VertexCompression::EncodeAttribute(*attribute, data, mVertexCount, encoded.data(), attribute->GetSize());
+		mVertexArray.ChangeVertexData(semantic, encoded.data());
+	}
+	else
+	{
+		mVertexArray.ChangeVertexData(semantic, data);
+	}
+}
@@ -7,12 +7,15 @@
 // a Submesh owns vertex data and provides some other functionality (e.g getting triangles, raycasting).
 //
 #pragma once
+#include <cstdint>
 #include <string>
 
+#include "BVH.h"
 #include "Vector3.h"
 #include "VertexArray.h"
 
 class Ray;
+struct RaycastHit;
 
 enum class RenderMode
 {
@@ -33,6 +36,9 @@ public:
 	void Render() const;
 	void Render(unsigned int offset, unsigned int count) const;
 	
+	// Renders the whole submesh once per instance, with object to world matrices from an instance buffer.
+	void RenderInstanced(GLuint instanceBuffer, unsigned int firstInstance, unsigned int instanceCount) const;
+	
 	unsigned int GetVertexCount() const { return mVertexCount; }
 	Vector3 GetVertexPosition(int index) const;
     bool GetVertexNormal(int index, Vector3& n) const;
@@ -40,10 +46,19 @@ public:
 	int GetTriangleCount() const;
 	bool GetTriangle(int index, Vector3& p0, Vector3& p1, Vector3& p2) const;
 	
-	bool Raycast(const Ray& ray);
+	// Finds the nearest triangle hit by the ray, if any.
+	bool Raycast(const Ray& ray, RaycastHit& hitInfo);
     
     void SetPositions(float* positions, bool createCopy = false);
     float* GetPositions() { return mPositions; }
+	
+	// If position data is modified directly (via GetPositions), call this so anything derived from positions is updated.
+	void MarkPositionsChanged();
+	
+	// An optional value identifying what's in the position data (e.g. a particular animation pose), so redundant updates can be skipped.
+	// Zero means unknown. Setting positions resets it.
+	void SetPositionsTag(uint64_t tag) { mPositionsTag = tag; }
+	uint64_t GetPositionsTag() const { return mPositionsTag; }
     
     void SetNormals(float* normals, bool createCopy = false);
     float* GetNormals() { return mNormals; }
@@ -74,6 +89,7 @@ private:
 	
 	// Vertex data. The submesh owns this data.
 	float* mPositions = nullptr;
+	uint64_t mPositionsTag = 0;
 	float* mColors = nullptr;
 	float* mNormals = nullptr;
 	float* mUV1 = nullptr;
@@ -81,7 +97,16 @@ private:
 	
     // Vertex array that actually renders using the underlying rendering system.
     VertexArray mVertexArray;
+	
+	// Speeds up raycasts. Built on first raycast, and refit (rather than rebuilt) when positions change, such as during vertex animation.
+	BVH mBVH;
+	bool mBVHBuilt = false;
+	bool mBVHDirty = false;
+	std::vector<Triangle> mBVHTriangles;
     
 	// Name of the default texture to use for this submesh.
 	std::string mTextureName;
+	
+	void UpdateBVH();
+	void UploadVertexData(VertexAttribute::Semantic semantic, float* data);
 };
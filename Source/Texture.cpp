@@ -11,6 +11,7 @@
 
 #include "BinaryReader.h"
 #include "BinaryWriter.h"
+#include "GLState.h"
 #include "GMath.h"
 
 Texture Texture::White(2, 2, Color32::White);
@@ -62,7 +63,7 @@ Texture::~Texture()
 {
 	if(mTextureId != GL_NONE)
 	{
-		glDeleteTextures(1, &mTextureId);
+		GLState::DeleteTexture(mTextureId);
 	}
 	if(mPalette != nullptr)
 	{
@@ -83,7 +84,7 @@ Texture::~Texture()
 
 void Texture::Activate(int textureUnit)
 {
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    GLState::ActiveTexture(textureUnit);
     
     if(mDirty)
     {
@@ -91,7 +92,7 @@ void Texture::Activate(int textureUnit)
         mDirty = false;
     }
     
-    glBindTexture(GL_TEXTURE_2D, mTextureId);
+    GLState::BindTexture(GL_TEXTURE_2D, mTextureId);
 }
 
 void Texture::Deactivate()
@@ -285,35 +286,37 @@ void Texture::ApplyAlphaChannel(const Texture& alphaTexture)
 
 void Texture::UploadToGPU()
 {
+	RenderBackend* backend = GLState::GetBackend();
+	
 	if(mTextureId == GL_NONE)
 	{
 		// Generate and bind the texture object in OpenGL.
-		glGenTextures(1, &mTextureId);
-		glBindTexture(GL_TEXTURE_2D, mTextureId);
+		mTextureId = backend->CreateTexture();
+		GLState::BindTexture(GL_TEXTURE_2D, mTextureId);
 		
 		// Load texture data into texture object.
         // OpenGL assumes that pixel data is from bottom-left, BUT our pixels array is from top-left!
         // You'd think this would lead to upside-down textures in-game...BUT GK3 uses DirectX style UVs (from top-left).
         // So, this "double inversion" actually leads to textures displaying correctly in OpenGL.
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-					 mWidth, mHeight, 0,
+		backend->TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+					 mWidth, mHeight,
 					 GL_RGBA, GL_UNSIGNED_BYTE, mPixels);
 		
 		// Set filter mode for the texture.
         GLfloat filterParam = mFilterMode == FilterMode::Point ? GL_NEAREST : GL_LINEAR;
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterParam);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterParam);
+		backend->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterParam);
+        backend->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterParam);
         
         // Set wrap mode for the texture.
         GLfloat wrapParam = mWrapMode == WrapMode::Repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE;
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapParam);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapParam);
+        backend->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapParam);
+        backend->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapParam);
 	}
 	else
 	{
 		// Update texture data on GPU.
-		glBindTexture(GL_TEXTURE_2D, mTextureId);
-		glTexSubImage2D(GL_TEXTURE_2D, 0,
+		GLState::BindTexture(GL_TEXTURE_2D, mTextureId);
+		backend->TexSubImage2D(GL_TEXTURE_2D, 0,
 						0, 0, mWidth, mHeight,
 						GL_RGBA, GL_UNSIGNED_BYTE, mPixels);
 	}
@@ -88,6 +88,7 @@ void Transform::SetWorldRotation(const Quaternion& rotation)
 	{
 		mLocalRotation = rotation;
 	}
+	SetDirty();
 }
 
 Vector3 Transform::GetWorldScale() const
@@ -244,6 +245,7 @@ void Transform::SetDirty()
 {
 	mLocalToWorldDirty = true;
 	mWorldToLocalDirty = true;
+	++mChangeCount;
 	
 	for(auto& child : mChildren)
 	{
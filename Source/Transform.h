@@ -9,6 +9,7 @@
 #pragma once
 #include "Component.h"
 
+#include <cstdint>
 #include <vector>
 
 #include "Matrix4.h"
@@ -61,6 +62,10 @@ public:
 	const Matrix4& GetLocalToWorldMatrix();
 	const Matrix4& GetWorldToLocalMatrix();
 	
+	// Goes up each time this transform (or a parent) moves, rotates, or scales.
+	// Anything derived from the world transform can compare this to know when it's stale.
+	uint32_t GetChangeCount() const { return mChangeCount; }
+	
 	// Transforms points/directions from local space to world space.
 	Vector3 LocalToWorldPoint(const Vector3& localPoint);
 	Vector3 LocalToWorldDirection(const Vector3& localDirection);
@@ -99,6 +104,7 @@ protected:
 	// We only recalculate our matrices when we have to. This keeps track of that.
 	bool mLocalToWorldDirty = true;
 	bool mWorldToLocalDirty = true;
+	uint32_t mChangeCount = 0;
 	
 	// If we are a child of any other transform, parent is set.
 	// If we have any children, they are in the children vector.
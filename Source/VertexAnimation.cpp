@@ -5,169 +5,367 @@
 //
 #include "VertexAnimation.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
-#include <vector>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
+
+// Pose interpolation lerps four floats at a time on x86 builds with SSE2.
+// Other targets (e.g. ARM Macs) use the plain loop that also handles leftover floats.
+#if defined(__SSE2__) || defined(_M_X64)
+	#define VERTEX_ANIMATION_SSE
+	#include <xmmintrin.h>
+#endif
 
 #include "BinaryReader.h"
+#include "GLState.h"
 #include "GMath.h"
 #include "Matrix3.h"
 
 //#define DEBUG_OUTPUT
 
-VertexAnimation::VertexAnimation(std::string name, char* data, int dataLength) : Asset(name)
+namespace
+{
+	// Max number of compressed keyframes in a row. Limits how many deltas must be applied to decode a keyframe.
+	const int kMaxDeltaChainLength = 8;
+	
+	// Used to give each animation a unique pose tag ID.
+	std::atomic<uint32_t> nextPoseTagId(1);
+	
+	// Pose cache counters. Poses can be sampled on any thread.
+	std::atomic<int> poseCacheHits(0);
+	std::atomic<int> poseCacheMisses(0);
+	std::atomic<int> poseUploadsSkipped(0);
+	
+	AABB GetPositionBounds(const std::vector<Vector3>& positions)
+	{
+		if(positions.empty()) { return AABB(); }
+		AABB bounds(positions[0], positions[0]);
+		for(auto& position : positions)
+		{
+			bounds.GrowToContain(position);
+		}
+		return bounds;
+	}
+}
+
+VertexPoseCacheStats VertexAnimation::GetPoseCacheStats()
+{
+	VertexPoseCacheStats stats;
+	stats.hits = poseCacheHits;
+	stats.misses = poseCacheMisses;
+	stats.uploadsSkipped = poseUploadsSkipped;
+	return stats;
+}
+
+void VertexAnimation::CountSkippedUpload()
+{
+	++poseUploadsSkipped;
+}
+
+VertexAnimation::VertexAnimation(std::string name, char* data, int dataLength) : Asset(name),
+	mPoseTagId(nextPoseTagId++)
 {
     ParseFromData(data, dataLength);
 }
 
+VertexAnimation::~VertexAnimation()
+{
+	if(mGPUTexture != GL_NONE)
+	{
+		GLState::DeleteTexture(mGPUTexture);
+	}
+	if(mGPUBuffer != GL_NONE)
+	{
+		GLState::DeleteBuffer(mGPUBuffer);
+	}
+}
+
 Vector3 VertexAnimation::SampleVertexPosition(float time, int framesPerSecond, int meshIndex, int submeshIndex, int vertexIndex)
 {
-	float duration = GetDuration(framesPerSecond);
-	float localTime = time;
-	if(localTime > duration)
+	// If no vertex data exists for this mesh/submesh/vertex, we'll have to return an error state.
+	const VertexKeyframes* keyframes = GetVertexKeyframes(meshIndex, submeshIndex);
+	if(keyframes == nullptr || vertexIndex < 0 || vertexIndex >= keyframes->vertexCount)
 	{
-		localTime = Math::Mod(time, duration);
+		return Vector3::Zero;
 	}
 	
-	float currentPoseTime = 0.0f;
-    float nextPoseTime = 0.0f;
+	// Interpolate between the keyframes before and after the time.
+	int currentKeyframe = 0;
+	int nextKeyframe = 0;
+	float t = 1.0f;
+	FindKeyframes(keyframes->frameNumbers, keyframes->frameToKeyframe, time, framesPerSecond, currentKeyframe, nextKeyframe, t);
+	std::unique_lock<std::shared_mutex> lock(mDecodeMutex);
+	Vector3 current = GetKeyframePositions(*keyframes, currentKeyframe)[vertexIndex];
+	Vector3 next = GetKeyframePositions(*keyframes, nextKeyframe)[vertexIndex];
+	return Vector3::Lerp(current, next, t);
+}
+
+bool VertexAnimation::SampleVertexPose(float time, int framesPerSecond, int meshIndex, int submeshIndex, float* outPositions, int vertexCount)
+{
+	// If no vertex data was found, nothing to sample.
+	const VertexKeyframes* keyframes = GetVertexKeyframes(meshIndex, submeshIndex);
+	if(keyframes == nullptr) { return false; }
+	
+	// Round to the nearest pose step. At high frame rates, consecutive samples often land on the same step.
+	int poseStep = 0;
+	float poseTime = GetPoseTime(time, framesPerSecond, poseStep);
+	int floatCount = Math::Min(vertexCount, keyframes->vertexCount) * 3;
 	
-	// Find the first vertex pose defined for this mesh/submesh.
-	VertexAnimationVertexPose* firstVertexPose = nullptr;
-	auto it = mVertexPoses.find(meshIndex);
-	if(it != mVertexPoses.end())
+	// If this pose was sampled recently, just copy it.
+	VertexKeyframes::CachedPose& cachedPose = keyframes->cachedPoses[poseStep % VertexKeyframes::kCachedPoseCount];
 	{
-		auto it2 = it->second.find(submeshIndex);
-		if(it2 != it->second.end())
+		std::shared_lock<std::shared_mutex> lock(mDecodeMutex);
+		if(cachedPose.time == poseTime && cachedPose.framesPerSecond == framesPerSecond && cachedPose.positions.size() == floatCount)
 		{
-			firstVertexPose = it2->second;
+			memcpy(outPositions, cachedPose.positions.data(), floatCount * sizeof(float));
+			++poseCacheHits;
+			return true;
 		}
 	}
+	++poseCacheMisses;
 	
-	// If no vertex pose was found, we'll have to return an error state.
-	if(firstVertexPose == nullptr)
+	// Otherwise, interpolate and save for next time.
+	InterpolateVertexPose(*keyframes, poseTime, framesPerSecond, outPositions, vertexCount);
+	std::unique_lock<std::shared_mutex> lock(mDecodeMutex);
+	cachedPose.time = poseTime;
+	cachedPose.framesPerSecond = framesPerSecond;
+	cachedPose.positions.assign(outPositions, outPositions + floatCount);
+	return true;
+}
+
+uint64_t VertexAnimation::GetPoseTag(float time, int framesPerSecond) const
+{
+	// The same time gives a different pose at a different frame rate, since frame rate decides which frame a time lands on.
+	// So combine animation ID (low 20 bits) and frame rate (low 12 bits) in the upper half, with the pose time's bits in the lower half.
+	int poseStep = 0;
+	float poseTime = GetPoseTime(time, framesPerSecond, poseStep);
+	uint32_t poseTimeBits = 0;
+	memcpy(&poseTimeBits, &poseTime, sizeof(poseTimeBits));
+	uint32_t animationBits = ((mPoseTagId & 0xFFFFF) << 12) | (static_cast<uint32_t>(framesPerSecond) & 0xFFF);
+	return (static_cast<uint64_t>(animationBits) << 32) | poseTimeBits;
+}
+
+VertexAnimationTransformPose VertexAnimation::SampleTransformPose(float time, int framesPerSecond, int meshIndex)
+{
+	// If there's no transform data for this mesh, return an error state.
+	if(meshIndex < 0 || meshIndex >= mTransformKeyframes.size() || mTransformKeyframes[meshIndex].frameNumbers.empty())
 	{
-		return Vector3::Zero;
+		VertexAnimationTransformPose pose;
+		pose.mFrameNumber = -1;
+		return pose;
 	}
 	
-	// Calculate how many seconds should be used for a single frame - used later.
-    float secondsPerFrame = 1.0f / framesPerSecond;
+	// Determine between which two transform poses the desired time is located.
+	// E.g. if time is 50% between pose 5 and 6, we  want to interpolate 50% between those two poses.
+	const TransformKeyframes& keyframes = mTransformKeyframes[meshIndex];
+	int currentKeyframe = 0;
+	int nextKeyframe = 0;
+	float t = 1.0f;
+	FindKeyframes(keyframes.frameNumbers, keyframes.frameToKeyframe, time, framesPerSecond, currentKeyframe, nextKeyframe, t);
+	const VertexAnimationTransformPose& currentTransformPose = keyframes.poses[currentKeyframe];
+	const VertexAnimationTransformPose& nextTransformPose = keyframes.poses[nextKeyframe];
 	
-	// Determine the poses right before the desired local time on the animation.
-    VertexAnimationVertexPose* currentVertexPose = firstVertexPose;
-    while(currentVertexPose->mNext != nullptr)
-    {
-        currentPoseTime = secondsPerFrame * currentVertexPose->mFrameNumber;
-        nextPoseTime = secondsPerFrame * currentVertexPose->mNext->mFrameNumber;
-        if(nextPoseTime > localTime) { break; }
-		
-        currentVertexPose = currentVertexPose->mNext;
-    }
+	// Finally, create a pose with lerp/slerp that is interpolated between the two poses.
+    VertexAnimationTransformPose pose;
+    pose.mLocalPosition = Vector3::Lerp(currentTransformPose.mLocalPosition, nextTransformPose.mLocalPosition, t);
+	pose.mLocalScale = Vector3::Lerp(currentTransformPose.mLocalScale, nextTransformPose.mLocalScale, t);
+    Quaternion::Slerp(pose.mLocalRotation, currentTransformPose.mLocalRotation, nextTransformPose.mLocalRotation, t);
+    return pose;
+}
+
+bool VertexAnimation::SampleMeshBounds(float time, int framesPerSecond, int meshIndex, AABB& outBounds) const
+{
+	if(meshIndex < 0 || meshIndex >= mVertexKeyframes.size()) { return false; }
 	
-	// Get the next pose, after the desired local time.
-	// If it doesn't exist, loop back to the first pose.
-    VertexAnimationVertexPose* nextVertexPose = currentVertexPose->mNext;
-    if(nextVertexPose == nullptr)
-    {
-		nextVertexPose = currentVertexPose;
-		nextPoseTime = currentPoseTime;
-    }
-    
-    // Determine our "t" value between the current and next pose.
-    float t = 1.0f;
-    if(!Math::IsZero(nextPoseTime - currentPoseTime))
-    {
-        t = (localTime - currentPoseTime) / (nextPoseTime - currentPoseTime);
-    }
-    assert(t >= 0.0f && t <= 1.0f);
+	// CPU poses are sampled at the nearest pose step, which may be just past a keyframe. So cover keyframes around both times.
+	int poseStep = 0;
+	float times[2] = { time, GetPoseTime(time, framesPerSecond, poseStep) };
 	
-    // Now calculate interpolated positions between current and next poses for this time t.
-	return Vector3::Lerp(currentVertexPose->mVertexPositions[vertexIndex], nextVertexPose->mVertexPositions[vertexIndex], t);
+	// Interpolated positions are always between keyframe positions, so they're within the keyframes' combined bounds.
+	bool found = false;
+	for(auto& keyframes : mVertexKeyframes[meshIndex])
+	{
+		if(keyframes.keyframes.empty()) { continue; }
+		for(float keyframeTime : times)
+		{
+			int currentKeyframe = 0;
+			int nextKeyframe = 0;
+			float t = 1.0f;
+			FindKeyframes(keyframes.frameNumbers, keyframes.frameToKeyframe, keyframeTime, framesPerSecond, currentKeyframe, nextKeyframe, t);
+			if(!found)
+			{
+				outBounds = keyframes.keyframes[currentKeyframe].bounds;
+				found = true;
+			}
+			else
+			{
+				outBounds.GrowToContain(keyframes.keyframes[currentKeyframe].bounds);
+			}
+			outBounds.GrowToContain(keyframes.keyframes[nextKeyframe].bounds);
+		}
+	}
+	return found;
 }
 
-VertexAnimationVertexPose VertexAnimation::SampleVertexPose(float time, int framesPerSecond, int meshIndex, int submeshIndex)
+bool VertexAnimation::CreateGPUKeyframes()
 {
-	float duration = GetDuration(framesPerSecond);
-	float localTime = time;
-	if(localTime > duration)
+	RenderBackend* backend = GLState::GetBackend();
+	
+	if(mGPUTexture != GL_NONE) { return true; }
+	if(mGPUKeyframesFailed) { return false; }
+	
+	// Figure out where each submesh's keyframes go in the buffer.
+	int totalVertexCount = 0;
+	for(auto& meshKeyframes : mVertexKeyframes)
 	{
-		localTime = Math::Mod(time, duration);
+		for(auto& keyframes : meshKeyframes)
+		{
+			keyframes.gpuOffset = totalVertexCount;
+			totalVertexCount += static_cast<int>(keyframes.keyframes.size()) * keyframes.vertexCount;
+		}
 	}
 	
-    float currentPoseTime = 0.0f;
-    float nextPoseTime = 0.0f;
+	// Each position takes three texels. Make sure that fits in a texture buffer.
+	GLint maxTexelCount = 0;
+	backend->GetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexelCount);
+	if(totalVertexCount == 0 || totalVertexCount > maxTexelCount / 3)
+	{
+		mGPUKeyframesFailed = true;
+		return false;
+	}
 	
-	// Find the first vertex pose defined for this mesh/submesh.
-	VertexAnimationVertexPose* firstVertexPose = nullptr;
-	auto it = mVertexPoses.find(meshIndex);
-	if(it != mVertexPoses.end())
+	// Decode every keyframe into one big array.
+	std::unique_lock<std::shared_mutex> lock(mDecodeMutex);
+	std::vector<Vector3> positions;
+	positions.reserve(totalVertexCount);
+	for(auto& meshKeyframes : mVertexKeyframes)
 	{
-		auto it2 = it->second.find(submeshIndex);
-		if(it2 != it->second.end())
+		for(auto& keyframes : meshKeyframes)
 		{
-			firstVertexPose = it2->second;
+			for(int i = 0; i < keyframes.keyframes.size(); i++)
+			{
+				const Vector3* keyframePositions = GetKeyframePositions(keyframes, i);
+				positions.insert(positions.end(), keyframePositions, keyframePositions + keyframes.vertexCount);
+			}
 		}
 	}
 	
-	// If no vertex pose was found, we'll have to return an error state.
-	if(firstVertexPose == nullptr)
+	// Upload to a buffer, and create a texture so shaders can read from it.
+	mGPUBuffer = backend->CreateBuffer();
+	GLState::BindBuffer(GL_TEXTURE_BUFFER, mGPUBuffer);
+	backend->BufferData(GL_TEXTURE_BUFFER, positions.size() * sizeof(Vector3), positions.data(), GL_STATIC_DRAW);
+	GLState::BindBuffer(GL_TEXTURE_BUFFER, GL_NONE);
+	
+	mGPUTexture = backend->CreateTexture();
+	GLState::BindTexture(GL_TEXTURE_BUFFER, mGPUTexture);
+	backend->TexBuffer(GL_TEXTURE_BUFFER, GL_R32F, mGPUBuffer);
+	GLState::BindTexture(GL_TEXTURE_BUFFER, GL_NONE);
+	return true;
+}
+
+void VertexAnimation::ActivateGPUKeyframes(int textureUnit)
+{
+	GLState::ActiveTexture(textureUnit);
+	GLState::BindTexture(GL_TEXTURE_BUFFER, mGPUTexture);
+}
+
+bool VertexAnimation::SampleGPUKeyframes(float time, int framesPerSecond, int meshIndex, int submeshIndex, int& outOffset0, int& outOffset1, float& outBlend)
+{
+	const VertexKeyframes* keyframes = GetVertexKeyframes(meshIndex, submeshIndex);
+	if(keyframes == nullptr || mGPUTexture == GL_NONE) { return false; }
+	
+	int currentKeyframe = 0;
+	int nextKeyframe = 0;
+	FindKeyframes(keyframes->frameNumbers, keyframes->frameToKeyframe, time, framesPerSecond, currentKeyframe, nextKeyframe, outBlend);
+	outOffset0 = keyframes->gpuOffset + currentKeyframe * keyframes->vertexCount;
+	outOffset1 = keyframes->gpuOffset + nextKeyframe * keyframes->vertexCount;
+	return true;
+}
+
+float VertexAnimation::GetPoseTime(float time, int framesPerSecond, int& outPoseStep) const
+{
+	outPoseStep = Math::Max(Math::RoundToInt(time * framesPerSecond * kPoseStepsPerFrame), 0);
+	
+	// Don't let rounding push a time at the end of the animation past the end - that would loop back to the start.
+	int lastPoseStep = mFrameCount * kPoseStepsPerFrame;
+	if(time <= GetDuration(framesPerSecond) && outPoseStep >= lastPoseStep)
 	{
-		VertexAnimationVertexPose pose;
-		pose.mFrameNumber = -1;
-		return pose;
+		outPoseStep = lastPoseStep;
+		return GetDuration(framesPerSecond);
 	}
+	return static_cast<float>(outPoseStep) / (framesPerSecond * kPoseStepsPerFrame);
+}
+
+void VertexAnimation::InterpolateVertexPose(const VertexKeyframes& keyframes, float time, int framesPerSecond, float* outPositions, int vertexCount)
+{
+	// Find keyframes before and after the time.
+	int currentKeyframe = 0;
+	int nextKeyframe = 0;
+	float t = 1.0f;
+	FindKeyframes(keyframes.frameNumbers, keyframes.frameToKeyframe, time, framesPerSecond, currentKeyframe, nextKeyframe, t);
 	
-	// Calculate how many seconds should be used for a single frame - used later.
-    float secondsPerFrame = 1.0f / framesPerSecond;
+	// If sitting exactly on a keyframe, no need to interpolate (or decode the next keyframe).
+	bool onKeyframe = currentKeyframe == nextKeyframe || t <= 0.0f;
 	
-	// Determine the poses right before the desired local time on the animation.
-    VertexAnimationVertexPose* currentVertexPose = firstVertexPose;
-    while(currentVertexPose->mNext != nullptr)
-    {
-        currentPoseTime = secondsPerFrame * currentVertexPose->mFrameNumber;
-        nextPoseTime = secondsPerFrame * currentVertexPose->mNext->mFrameNumber;
-        if(nextPoseTime > localTime) { break; }
-		
-        currentVertexPose = currentVertexPose->mNext;
-    }
+	// Usually, keyframes are already decoded (by an earlier sample, or another actor playing the same animation).
+	// Those can be read by many threads at once. Only take an exclusive lock if something needs decoding.
+	std::shared_lock<std::shared_mutex> sharedLock(mDecodeMutex);
+	std::unique_lock<std::shared_mutex> exclusiveLock;
+	const Vector3* currentPositions = FindKeyframePositions(keyframes, currentKeyframe);
+	const Vector3* nextPositions = onKeyframe ? currentPositions : FindKeyframePositions(keyframes, nextKeyframe);
+	if(currentPositions == nullptr || nextPositions == nullptr)
+	{
+		sharedLock.unlock();
+		exclusiveLock = std::unique_lock<std::shared_mutex>(mDecodeMutex);
+		currentPositions = GetKeyframePositions(keyframes, currentKeyframe);
+		nextPositions = onKeyframe ? currentPositions : GetKeyframePositions(keyframes, nextKeyframe);
+	}
 	
-	// Get the next pose, after the desired local time.
-	// If it doesn't exist, loop back to the first pose.
-    VertexAnimationVertexPose* nextVertexPose = currentVertexPose->mNext;
-    if(nextVertexPose == nullptr)
-    {
-		// Clamp approach.
-		nextVertexPose = currentVertexPose;
-		nextPoseTime = currentPoseTime;
-		
-		// Loop approach.
-        //nextVertexPose = firstVertexPose;
-        //nextPoseTime = GetDuration(framesPerSecond);
-    }
-    
-    // Determine our "t" value between the current and next pose.
-    float t = 1.0f;
-    if(!Math::IsZero(nextPoseTime - currentPoseTime))
-    {
-        t = (localTime - currentPoseTime) / (nextPoseTime - currentPoseTime);
-    }
-    assert(t >= 0.0f && t <= 1.0f);
+	// Positions are stored as plain x/y/z floats, so the whole pose can be lerped as one float array.
+	int floatCount = Math::Min(vertexCount, keyframes.vertexCount) * 3;
+	const float* current = reinterpret_cast<const float*>(currentPositions);
+	if(onKeyframe)
+	{
+		memcpy(outPositions, current, floatCount * sizeof(float));
+		return;
+	}
+	const float* next = reinterpret_cast<const float*>(nextPositions);
 	
-    // Now calculate interpolated positions between current and next poses for this time t.
-	VertexAnimationVertexPose pose;
-    for(int i = 0; i < currentVertexPose->mVertexPositions.size(); i++)
-    {
-        pose.mVertexPositions.push_back(Vector3::Lerp(currentVertexPose->mVertexPositions[i], nextVertexPose->mVertexPositions[i], t));
-    }
-    return pose;
+	// Same math as Vector3::Lerp, so results match sampling a single vertex.
+	float oneMinusT = 1.0f - t;
+	int i = 0;
+	#ifdef VERTEX_ANIMATION_SSE
+	__m128 fromScale = _mm_set1_ps(oneMinusT);
+	__m128 toScale = _mm_set1_ps(t);
+	for(; i + 4 <= floatCount; i += 4)
+	{
+		__m128 from = _mm_mul_ps(_mm_loadu_ps(current + i), fromScale);
+		__m128 to = _mm_mul_ps(_mm_loadu_ps(next + i), toScale);
+		_mm_storeu_ps(outPositions + i, _mm_add_ps(from, to));
+	}
+	#endif
+	for(; i < floatCount; ++i)
+	{
+		outPositions[i] = (oneMinusT * current[i]) + (t * next[i]);
+	}
 }
 
-VertexAnimationTransformPose VertexAnimation::SampleTransformPose(float time, int framesPerSecond, int meshIndex)
+const VertexAnimation::VertexKeyframes* VertexAnimation::GetVertexKeyframes(int meshIndex, int submeshIndex) const
 {
-	// Calculate how many seconds should be used for a single frame.
-	float secondsPerFrame = 1.0f / framesPerSecond;
+	if(meshIndex < 0 || meshIndex >= mVertexKeyframes.size()) { return nullptr; }
+	if(submeshIndex < 0 || submeshIndex >= mVertexKeyframes[meshIndex].size()) { return nullptr; }
 	
+	const VertexKeyframes& keyframes = mVertexKeyframes[meshIndex][submeshIndex];
+	return keyframes.frameNumbers.empty() ? nullptr : &keyframes;
+}
+
+void VertexAnimation::FindKeyframes(const std::vector<int>& frameNumbers, const std::vector<int>& frameToKeyframe, float time, int framesPerSecond,
+									int& outCurrentKeyframe, int& outNextKeyframe, float& outT) const
+{
 	// Caller may pass in a global time that extends beyond the local time of this particular animation.
 	// Desire here is for the animation to "loop", so we calculate how many seconds in we are.
 	float duration = GetDuration(framesPerSecond);
@@ -177,50 +375,54 @@ VertexAnimationTransformPose VertexAnimation::SampleTransformPose(float time, in
 		localTime = Math::Mod(time, duration);
 	}
 	
-	// Determine between which two transform poses the desired local time is located.
-	// E.g. if local time is 50% between pose 5 and 6, we  want to interpolate 50% between those two poses.
-    float currentPoseTime = 0.0f;
-    float nextPoseTime = 0.0f;
-    VertexAnimationTransformPose* firstTransformPose = mTransformPoses[meshIndex];
-    VertexAnimationTransformPose* currentTransformPose = firstTransformPose;
-    while(currentTransformPose->mNext != nullptr)
-    {
-        currentPoseTime = secondsPerFrame * currentTransformPose->mFrameNumber;
-        nextPoseTime = secondsPerFrame * currentTransformPose->mNext->mFrameNumber;
-        if(nextPoseTime > localTime) { break; }
-        
-        // Move on to next one.
-        currentTransformPose = currentTransformPose->mNext;
-    }
+	// Calculate how many seconds should be used for a single frame.
+	float secondsPerFrame = 1.0f / framesPerSecond;
+	
+	// Look up the keyframe at or before the frame containing this time.
+	// Frame boundaries may not exactly match keyframe times due to float precision, so nudge to the correct keyframe if needed.
+	int keyframeCount = static_cast<int>(frameNumbers.size());
+	int frame = Math::Clamp(static_cast<int>(localTime * framesPerSecond), 0, static_cast<int>(frameToKeyframe.size()) - 1);
+	int current = frameToKeyframe.empty() ? 0 : frameToKeyframe[frame];
+	while(current + 1 < keyframeCount && secondsPerFrame * frameNumbers[current + 1] <= localTime)
+	{
+		++current;
+	}
+	while(current > 0 && secondsPerFrame * frameNumbers[current] > localTime)
+	{
+		--current;
+	}
 	
 	// If there is no "next" pose, we can either loop to the first pose, or "clamp" on the last pose.
 	// Testing suggests GK3 expects the "clamp" approach, but more generally, a parameter for this might make sense.
-    VertexAnimationTransformPose* nextTransformPose = currentTransformPose->mNext;
-    if(nextTransformPose == nullptr)
-    {
-		// Clamp approach.
-		nextTransformPose = currentTransformPose;
-		nextPoseTime = currentPoseTime;
-		
-		// Loop approach.
-        //nextTransformPose = firstTransformPose;
-        //nextPoseTime = GetDuration(framesPerSecond);
-    }
+	int next = current + 1 < keyframeCount ? current + 1 : current;
 	
-    // Determine our "t" value between the prev and next pose.
-    float t = 1.0f;
+	// Determine our "t" value between the current and next pose.
+	float currentPoseTime = secondsPerFrame * frameNumbers[current];
+	float nextPoseTime = secondsPerFrame * frameNumbers[next];
+	float t = 1.0f;
 	if(!Math::IsZero(nextPoseTime - currentPoseTime))
-    {
-        t = (localTime - currentPoseTime) / (nextPoseTime - currentPoseTime);
-    }
-    assert(t >= 0.0f && t <= 1.0f);
+	{
+		t = (localTime - currentPoseTime) / (nextPoseTime - currentPoseTime);
+	}
+	assert(t >= 0.0f && t <= 1.0f);
 	
-	// Finally, create a pose with lerp/slerp that is interpolated between the two poses.
-    VertexAnimationTransformPose pose;
-    pose.mLocalPosition = Vector3::Lerp(currentTransformPose->mLocalPosition, nextTransformPose->mLocalPosition, t);
-	pose.mLocalScale = Vector3::Lerp(currentTransformPose->mLocalScale, nextTransformPose->mLocalScale, t);
-    Quaternion::Slerp(pose.mLocalRotation, currentTransformPose->mLocalRotation, nextTransformPose->mLocalRotation, t);
-    return pose;
+	outCurrentKeyframe = current;
+	outNextKeyframe = next;
+	outT = t;
+}
+
+void VertexAnimation::BuildFrameToKeyframe(const std::vector<int>& frameNumbers, std::vector<int>& outFrameToKeyframe) const
+{
+	outFrameToKeyframe.resize(mFrameCount);
+	int keyframe = 0;
+	for(int i = 0; i < mFrameCount; i++)
+	{
+		while(keyframe + 1 < frameNumbers.size() && frameNumbers[keyframe + 1] <= i)
+		{
+			++keyframe;
+		}
+		outFrameToKeyframe[i] = keyframe;
+	}
 }
 
 void VertexAnimation::ParseFromData(char *data, int dataLength)
@@ -269,8 +471,13 @@ void VertexAnimation::ParseFromData(char *data, int dataLength)
         offsets.push_back(reader.ReadUInt());
     }
     
-    std::unordered_map<int, VertexAnimationVertexPose*> lastVertexPoseLookup;
-    std::unordered_map<int, VertexAnimationTransformPose*> lastTransformPoseLookup;
+    // There's an entry for each mesh in each keyframe, so we know how many meshes have keyframes.
+    mVertexKeyframes.resize(meshCount);
+    mTransformKeyframes.resize(meshCount);
+    
+    // While parsing, track the latest positions for each submesh, and how many compressed keyframes in a row it has.
+    std::unordered_map<int, std::vector<Vector3>> lastPositionsLookup;
+    std::unordered_map<int, int> deltaChainLengthLookup;
 	
 	// Read in data for each keyframe.
     for(int i = 0; i < mFrameCount; i++)
@@ -321,30 +528,19 @@ void VertexAnimation::ParseFromData(char *data, int dataLength)
                     #ifdef DEBUG_OUTPUT
                     std::cout << "        Submesh Index: " << submeshIndex << std::endl;
                     #endif
-					
-					// This is a pretty sorry hash...but assuming we'll never
-					// have more than 1000 submeshes (pretty likely for GK3), this'll do OK.
-                    int hash = meshIndex * 1000 + submeshIndex;
-					
-					// Create a vertex pose for this frame and stick it in our dictionary and linked list.
-                    VertexAnimationVertexPose* vertexPose = new VertexAnimationVertexPose();
-                    vertexPose->mFrameNumber = i;
-                    if(i == 0)
-                    {
-                        mVertexPoses[meshIndex][submeshIndex] = vertexPose;
-                        lastVertexPoseLookup[hash] = vertexPose;
-                    }
-                    else
-                    {
-                        lastVertexPoseLookup[hash]->mNext = vertexPose;
-                        lastVertexPoseLookup[hash] = vertexPose;
-                    }
                     
                     // 2 bytes: Vertex count.
                     unsigned short vertexCount = reader.ReadUShort();
                     #ifdef DEBUG_OUTPUT
                     std::cout << "        Vertex Count: " << vertexCount << std::endl;
                     #endif
+					
+					// This is a pretty sorry hash...but assuming we'll never
+					// have more than 1000 submeshes (pretty likely for GK3), this'll do OK.
+                    int hash = meshIndex * 1000 + submeshIndex;
+                    VertexKeyframes& keyframes = GetOrCreateVertexKeyframes(meshIndex, submeshIndex, vertexCount);
+                    std::vector<Vector3>& positions = lastPositionsLookup[hash];
+                    positions.resize(keyframes.vertexCount);
                     
                     // Next, three floats per vertex (X, Y, Z).
                     for(int k = 0; k < vertexCount; k++)
@@ -352,8 +548,20 @@ void VertexAnimation::ParseFromData(char *data, int dataLength)
                         float x = reader.ReadFloat();
 						float z = reader.ReadFloat();
                         float y = reader.ReadFloat();
-                        vertexPose->mVertexPositions.push_back(Vector3(x, y, z));
+                        if(k < positions.size())
+                        {
+                            positions[k] = Vector3(x, y, z);
+                        }
                     }
+                    
+                    // Save as a full keyframe.
+                    VertexKeyframes::Keyframe keyframe;
+                    keyframe.bounds = GetPositionBounds(positions);
+                    keyframe.offset = static_cast<int>(keyframes.fullPositions.size());
+                    keyframes.fullPositions.insert(keyframes.fullPositions.end(), positions.begin(), positions.end());
+                    keyframes.keyframes.push_back(keyframe);
+                    keyframes.frameNumbers.push_back(i);
+                    deltaChainLengthLookup[hash] = 0;
                 }
                 // Identifier 1 also is vertex data, but in a compressed format.
                 else if(dataId == 1)
@@ -371,103 +579,44 @@ void VertexAnimation::ParseFromData(char *data, int dataLength)
                     #ifdef DEBUG_OUTPUT
                     std::cout << "        Submesh Index: " << submeshIndex << std::endl;
                     #endif
-                    
-                    // Find position data from last recorded frame.
-                    int hash = meshIndex * 1000 + submeshIndex;
-                    std::vector<Vector3>& prevPositions = lastVertexPoseLookup[hash]->mVertexPositions;
-					
-					// Create a vertex pose to hold this new data and insert it into the vertex pose chain.
-                    VertexAnimationVertexPose* vertexPose = new VertexAnimationVertexPose();
-                    vertexPose->mFrameNumber = i;
-                    if(i == 0)
-                    {
-						mVertexPoses[meshIndex][submeshIndex] = vertexPose;
-                        lastVertexPoseLookup[hash] = vertexPose;
-                    }
-                    else
-                    {
-                        lastVertexPoseLookup[hash]->mNext = vertexPose;
-                        lastVertexPoseLookup[hash] = vertexPose;
-                    }
 					
                     // 2 bytes: Vertex count.
+                    // This and all the remaining data in the block is the compressed delta data. We'll keep this data as-is in memory.
+                    int blockStart = reader.GetPosition();
                     unsigned short vertexCount = reader.ReadUShort();
                     #ifdef DEBUG_OUTPUT
                     std::cout << "        Vertex Count: " << vertexCount << std::endl;
                     #endif
                     
-                    // Next ((VertexCount/4) + 1) bytes: Compression info for vertex data.
-                    // Every 2 bits indicates how the vertex at that index is compressed.
-                    unsigned short compressionInfoSize = (vertexCount / 4) + 1;
-                    unsigned char* compressionInfo = new unsigned char[compressionInfoSize];
-                    reader.Read(compressionInfo, compressionInfoSize);
+                    // Apply deltas to the previous keyframe's positions to get this keyframe's positions.
+                    // If there's no previous keyframe, there's nothing to apply deltas to, so start with zeros.
+                    int hash = meshIndex * 1000 + submeshIndex;
+                    VertexKeyframes& keyframes = GetOrCreateVertexKeyframes(meshIndex, submeshIndex, vertexCount);
+                    std::vector<Vector3>& positions = lastPositionsLookup[hash];
+                    positions.resize(keyframes.vertexCount);
+                    const unsigned char* blockData = reinterpret_cast<unsigned char*>(data) + blockStart;
+                    int blockSize = ApplyVertexDeltas(blockData, positions.data(), static_cast<int>(positions.size()));
+                    reader.Seek(blockStart + blockSize);
                     
-                    // Iterate through the compression info and, for each vertex, determine
-                    // how it is stored (uncompressed, compressed, not present at all)
-                    unsigned char* vertexDataFormat = new unsigned char[vertexCount];
-                    for(int k = 0; k < vertexCount; k += 4)
+                    // Store compressed data, unless this would make too long a chain of deltas. In that case, store full positions.
+                    VertexKeyframes::Keyframe keyframe;
+                    keyframe.bounds = GetPositionBounds(positions);
+                    int& deltaChainLength = deltaChainLengthLookup[hash];
+                    if(!keyframes.keyframes.empty() && deltaChainLength < kMaxDeltaChainLength)
                     {
-                        unsigned char byte = compressionInfo[k / 4];
-                        unsigned int val1 = (byte & 0x3);
-                        unsigned int val2 = (byte & 0xC) >> 2;
-                        unsigned int val3 = (byte & 0x30) >> 4;
-                        unsigned int val4 = (byte & 0xC0) >> 6;
-
-                        vertexDataFormat[k] = val1;        // Masking 0000 0011
-                        if(k + 1 < vertexCount)
-                        {
-                            vertexDataFormat[k + 1] = val2;    // Masking 0000 1100
-                        }
-                        if(k + 2 < vertexCount)
-                        {
-                            vertexDataFormat[k + 2] = val3;    // Masking 0011 0000
-                        }
-                        if(k + 3 < vertexCount)
-                        {
-                            vertexDataFormat[k + 3] = val4;    // Masking 1100 0000
-                        }
+                        keyframe.offset = static_cast<int>(keyframes.deltaData.size());
+                        keyframe.compressed = true;
+                        keyframes.deltaData.insert(keyframes.deltaData.end(), blockData, blockData + blockSize);
+                        ++deltaChainLength;
                     }
-                    
-                    // Now that we have deciphered how each vertex is compressed, we can read in each vertex.
-                    for(int k = 0; k < vertexCount; k++)
+                    else
                     {
-						// 0 means no vertex data, so just use whatever we had for the previous frame.
-						// If the vertex data hasn't changed since last frame, it isn't stored, to save space.
-                        if(vertexDataFormat[k] == 0)
-                        {
-                            vertexPose->mVertexPositions.push_back(prevPositions[k]);
-                        }
-                        // 1 means (X, Y, Z) are compressed in next 3 bytes.
-						// This tends to be used for storing vertex position delta for internal vertices in a mesh.
-                        else if(vertexDataFormat[k] == 1)
-                        {
-                            float x = DecompressFloatFromByte(reader.ReadByte());
-							float z = DecompressFloatFromByte(reader.ReadByte());
-                            float y = DecompressFloatFromByte(reader.ReadByte());
-                            vertexPose->mVertexPositions.push_back(prevPositions[k] + Vector3(x, y, z));
-                        }
-                        // 2 means (X, Y, Z) are compressed in next 3 ushorts.
-						// This tends to be used for storing vertex position deltas where meshes meet (like a knee or elbow).
-                        else if(vertexDataFormat[k] == 2)
-                        {
-                            float x = DecompressFloatFromUShort(reader.ReadUShort());
-							float z = DecompressFloatFromUShort(reader.ReadUShort());
-							float y = DecompressFloatFromUShort(reader.ReadUShort());
-							vertexPose->mVertexPositions.push_back(prevPositions[k] + Vector3(x, y, z));
-                        }
-                        // 3 means (X, Y, Z) are not compressed - just floats.
-                        else if(vertexDataFormat[k] == 3)
-                        {
-                            float x = reader.ReadFloat();
-							float z = reader.ReadFloat();
-                            float y = reader.ReadFloat();
-                            vertexPose->mVertexPositions.push_back(prevPositions[k] + Vector3(x, y, z));
-                        }
+                        keyframe.offset = static_cast<int>(keyframes.fullPositions.size());
+                        keyframes.fullPositions.insert(keyframes.fullPositions.end(), positions.begin(), positions.end());
+                        deltaChainLength = 0;
                     }
-                    
-                    // Don't need these anymore!
-                    delete[] compressionInfo;
-                    delete[] vertexDataFormat;
+                    keyframes.keyframes.push_back(keyframe);
+                    keyframes.frameNumbers.push_back(i);
                 }
                 // Identifier 2 is transform matrix data.
                 else if(dataId == 2)
@@ -519,21 +668,19 @@ void VertexAnimation::ParseFromData(char *data, int dataLength)
                     std::cout << "        Mesh Position: " << meshPos << std::endl;
                     #endif
                     
-                    VertexAnimationTransformPose* transformPose = new VertexAnimationTransformPose();
-                    transformPose->mFrameNumber = i;
-                    transformPose->mLocalPosition = meshPos;
-                    transformPose->mLocalRotation = rotQuat;
-					transformPose->mLocalScale = scale;
-                    if(i == 0)
-                    {
-                        mTransformPoses.push_back(transformPose);
-                        lastTransformPoseLookup[meshIndex] = transformPose;
-                    }
-                    else
+                    VertexAnimationTransformPose transformPose;
+                    transformPose.mFrameNumber = i;
+                    transformPose.mLocalPosition = meshPos;
+                    transformPose.mLocalRotation = rotQuat;
+					transformPose.mLocalScale = scale;
+                    
+                    if(meshIndex >= mTransformKeyframes.size())
                     {
-                        lastTransformPoseLookup[meshIndex]->mNext = transformPose;
-                        lastTransformPoseLookup[meshIndex] = transformPose;
+                        mTransformKeyframes.resize(meshIndex + 1);
                     }
+                    TransformKeyframes& keyframes = mTransformKeyframes[meshIndex];
+                    keyframes.frameNumbers.push_back(i);
+                    keyframes.poses.push_back(transformPose);
                 }
                 // Identifier 3 is min/max data.
                 else if(dataId == 3)
@@ -566,6 +713,178 @@ void VertexAnimation::ParseFromData(char *data, int dataLength)
             } // while(byteCount > 0)
         } // iterate mesh groups
     } // iterate keyframes
+    
+    // With all keyframes read in, we can build frame-to-keyframe lookups.
+    for(auto& meshKeyframes : mVertexKeyframes)
+    {
+        for(auto& keyframes : meshKeyframes)
+        {
+            BuildFrameToKeyframe(keyframes.frameNumbers, keyframes.frameToKeyframe);
+        }
+    }
+    for(auto& keyframes : mTransformKeyframes)
+    {
+        BuildFrameToKeyframe(keyframes.frameNumbers, keyframes.frameToKeyframe);
+    }
+}
+
+const Vector3* VertexAnimation::FindKeyframePositions(const VertexKeyframes& keyframes, int keyframeIndex)
+{
+	// Uncompressed keyframes can be used directly.
+	const VertexKeyframes::Keyframe& keyframe = keyframes.keyframes[keyframeIndex];
+	if(!keyframe.compressed)
+	{
+		return keyframes.fullPositions.data() + keyframe.offset;
+	}
+	
+	// See if this keyframe was decoded recently.
+	for(auto& decoded : mDecodedKeyframes)
+	{
+		if(decoded.keyframes == &keyframes && decoded.keyframeIndex == keyframeIndex)
+		{
+			decoded.lastUsed = ++mDecodeCounter;
+			return decoded.positions.data();
+		}
+	}
+	return nullptr;
+}
+
+const Vector3* VertexAnimation::GetKeyframePositions(const VertexKeyframes& keyframes, int keyframeIndex)
+{
+	const Vector3* positions = FindKeyframePositions(keyframes, keyframeIndex);
+	if(positions != nullptr) { return positions; }
+	
+	// Not decoded - find the least recently used entry to decode into.
+	DecodedKeyframe* leastRecentlyUsed = &mDecodedKeyframes[0];
+	for(auto& decoded : mDecodedKeyframes)
+	{
+		if(decoded.lastUsed < leastRecentlyUsed->lastUsed)
+		{
+			leastRecentlyUsed = &decoded;
+		}
+	}
+	
+	// Deltas are from the previous keyframe, so walk back until we find a keyframe that's uncompressed or already decoded.
+	// The first keyframe is never compressed, so this always finds something.
+	int baseIndex = keyframeIndex - 1;
+	const DecodedKeyframe* baseDecoded = nullptr;
+	while(keyframes.keyframes[baseIndex].compressed)
+	{
+		for(auto& decoded : mDecodedKeyframes)
+		{
+			if(decoded.keyframes == &keyframes && decoded.keyframeIndex == baseIndex)
+			{
+				baseDecoded = &decoded;
+				break;
+			}
+		}
+		if(baseDecoded != nullptr) { break; }
+		--baseIndex;
+	}
+	
+	// Decode into the least recently used entry. If that entry happens to be the base keyframe, we can decode in place.
+	DecodedKeyframe& result = *leastRecentlyUsed;
+	if(baseDecoded != &result)
+	{
+		const Vector3* basePositions = baseDecoded != nullptr ? baseDecoded->positions.data() : keyframes.fullPositions.data() + keyframes.keyframes[baseIndex].offset;
+		result.positions.assign(basePositions, basePositions + keyframes.vertexCount);
+	}
+	for(int i = baseIndex + 1; i <= keyframeIndex; i++)
+	{
+		ApplyVertexDeltas(&keyframes.deltaData[keyframes.keyframes[i].offset], result.positions.data(), keyframes.vertexCount);
+	}
+	result.keyframes = &keyframes;
+	result.keyframeIndex = keyframeIndex;
+	result.lastUsed = ++mDecodeCounter;
+	return result.positions.data();
+}
+
+VertexAnimation::VertexKeyframes& VertexAnimation::GetOrCreateVertexKeyframes(int meshIndex, int submeshIndex, int vertexCount)
+{
+	if(meshIndex >= mVertexKeyframes.size())
+	{
+		mVertexKeyframes.resize(meshIndex + 1);
+	}
+	if(submeshIndex >= mVertexKeyframes[meshIndex].size())
+	{
+		mVertexKeyframes[meshIndex].resize(submeshIndex + 1);
+	}
+	VertexKeyframes& keyframes = mVertexKeyframes[meshIndex][submeshIndex];
+	
+	// Every keyframe for a submesh should have the same vertex count. If not, extra vertices are ignored.
+	if(keyframes.keyframes.empty())
+	{
+		keyframes.vertexCount = vertexCount;
+	}
+	else if(vertexCount != keyframes.vertexCount)
+	{
+		std::cout << "Vertex count mismatch in vertex animation " << mName << std::endl;
+	}
+	return keyframes;
+}
+
+int VertexAnimation::ApplyVertexDeltas(const unsigned char* data, Vector3* positions, int positionCount)
+{
+	// 2 bytes: Vertex count.
+	const unsigned char* current = data;
+	unsigned short vertexCount = 0;
+	memcpy(&vertexCount, current, sizeof(vertexCount));
+	current += sizeof(vertexCount);
+	
+	// Next ((VertexCount/4) + 1) bytes: Compression info for vertex data.
+	// Every 2 bits indicates how the vertex at that index is compressed.
+	const unsigned char* compressionInfo = current;
+	current += (vertexCount / 4) + 1;
+	
+	// Now, read each vertex's delta based on how it is compressed.
+	for(int k = 0; k < vertexCount; k++)
+	{
+		unsigned int vertexDataFormat = (compressionInfo[k / 4] >> ((k % 4) * 2)) & 0x3;
+		
+		// 0 means no vertex data, so just use whatever we had for the previous frame.
+		// If the vertex data hasn't changed since last frame, it isn't stored, to save space.
+		Vector3 delta;
+		if(vertexDataFormat == 0)
+		{
+			continue;
+		}
+		// 1 means (X, Y, Z) are compressed in next 3 bytes.
+		// This tends to be used for storing vertex position delta for internal vertices in a mesh.
+		else if(vertexDataFormat == 1)
+		{
+			delta.x = DecompressFloatFromByte(current[0]);
+			delta.z = DecompressFloatFromByte(current[1]);
+			delta.y = DecompressFloatFromByte(current[2]);
+			current += 3;
+		}
+		// 2 means (X, Y, Z) are compressed in next 3 ushorts.
+		// This tends to be used for storing vertex position deltas where meshes meet (like a knee or elbow).
+		else if(vertexDataFormat == 2)
+		{
+			unsigned short values[3];
+			memcpy(values, current, sizeof(values));
+			delta.x = DecompressFloatFromUShort(values[0]);
+			delta.z = DecompressFloatFromUShort(values[1]);
+			delta.y = DecompressFloatFromUShort(values[2]);
+			current += sizeof(values);
+		}
+		// 3 means (X, Y, Z) are not compressed - just floats.
+		else
+		{
+			float values[3];
+			memcpy(values, current, sizeof(values));
+			delta.x = values[0];
+			delta.z = values[1];
+			delta.y = values[2];
+			current += sizeof(values);
+		}
+		
+		if(k < positionCount)
+		{
+			positions[k] += delta;
+		}
+	}
+	return static_cast<int>(current - data);
 }
 
 float VertexAnimation::DecompressFloatFromByte(unsigned char val)
@@ -11,29 +11,25 @@
 #pragma once
 #include "Asset.h"
 
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
 #include <vector>
-#include <unordered_map>
 
+#include <GL/glew.h>
+
+#include "AABB.h"
 #include "Matrix4.h"
 #include "Vector3.h"
 
-struct VertexAnimationVertexPose
-{
-    int mFrameNumber = 0;
-    
-    std::vector<Vector3> mVertexPositions;
-    VertexAnimationVertexPose* mNext = nullptr;
-};
-
 struct VertexAnimationTransformPose
 {
+    // Frame number is -1 if the animation has no transform data for the mesh.
     int mFrameNumber = 0;
     
     Quaternion mLocalRotation;
     Vector3 mLocalPosition;
 	Vector3 mLocalScale;
-	
-    VertexAnimationTransformPose* mNext = nullptr;
     
     Matrix4 GetMeshToLocalMatrix()
     {
@@ -43,19 +39,65 @@ struct VertexAnimationTransformPose
     }
 };
 
+// Counts for reuse of sampled vertex poses, since startup.
+struct VertexPoseCacheStats
+{
+	// Poses that were copied from the cache, or needed interpolating.
+	int hits = 0;
+	int misses = 0;
+	
+	// Submesh updates skipped because the submesh already held the pose.
+	int uploadsSkipped = 0;
+	
+	float GetHitRate() const { return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.0f; }
+};
+
 class VertexAnimation : public Asset
 {
 public:
+	// Vertex poses are sampled at this many steps per animation frame.
+	// Any more is indistinguishable at normal display rates, and lets actors sampling nearly the same time share a pose.
+	static const int kPoseStepsPerFrame = 4;
+	
+	static VertexPoseCacheStats GetPoseCacheStats();
+	static void CountSkippedUpload();
+	
     VertexAnimation(std::string name, char* data, int dataLength);
+    ~VertexAnimation();
     
 	// Queries the position of a single vertex at a particular time of the animation.
 	Vector3 SampleVertexPosition(float time, int framesPerSecond, int meshIndex, int submeshIndex, int vertexIndex);
 	
 	// Queries positions of ALL vertices for a submesh at a particular time of the animation.
-	VertexAnimationVertexPose SampleVertexPose(float time, int framesPerSecond, int meshIndex, int submeshIndex);
+	// Interpolated positions (x/y/z floats per vertex) are written to the passed in buffer, which must have room for "vertexCount" vertices.
+	// Time is rounded to the nearest pose step, and recently sampled poses are reused.
+	// Returns false (and leaves buffer untouched) if the animation has no vertex data for this submesh.
+	bool SampleVertexPose(float time, int framesPerSecond, int meshIndex, int submeshIndex, float* outPositions, int vertexCount);
+	
+	// Gets a value identifying the pose SampleVertexPose gives for a time and frame rate. Any submesh sampled with the same tag gets the same positions.
+	uint64_t GetPoseTag(float time, int framesPerSecond) const;
 	
 	// Queries a mesh's transform properties (position, rotation, scale) at a particular time of the animation.
 	VertexAnimationTransformPose SampleTransformPose(float time, int framesPerSecond, int meshIndex);
+	
+	// Gets bounds (in mesh space) of a mesh's animated vertices at a particular time of the animation.
+	// Covers the keyframes on either side of the time, so it contains the pose whether sampled on the CPU or GPU.
+	// Returns false if the animation has no vertex data for the mesh.
+	bool SampleMeshBounds(float time, int framesPerSecond, int meshIndex, AABB& outBounds) const;
+	
+	// Returns true if the animation has vertex data for a submesh.
+	bool HasVertexKeyframes(int meshIndex, int submeshIndex) const { return GetVertexKeyframes(meshIndex, submeshIndex) != nullptr; }
+	
+	// Uploads all keyframe positions to a texture buffer, so vertex shaders can do the interpolation. Only done once.
+	// Returns false if keyframes can't be put on the GPU (e.g. too big for a texture buffer).
+	bool CreateGPUKeyframes();
+	
+	// Binds the keyframe texture buffer to a texture unit.
+	void ActivateGPUKeyframes(int textureUnit);
+	
+	// Gets offsets (in vertices) of the keyframes before and after a time in the keyframe texture buffer, and the blend between them.
+	// Returns false if the animation has no vertex data for this submesh.
+	bool SampleGPUKeyframes(float time, int framesPerSecond, int meshIndex, int submeshIndex, int& outOffset0, int& outOffset1, float& outBlend);
     
 	// Length and duration.
 	int GetFrameCount() const { return mFrameCount; }
@@ -67,18 +109,118 @@ private:
     // The number of frames in this animation.
     int mFrameCount = 0;
 	
+	// Unique for each animation, so pose tags from different animations never match (until over a million animations are loaded).
+	uint32_t mPoseTagId = 0;
+	
 	// The name of the model that is meant to play this animation.
 	// If we ever play the animation on a mismatched model, the graphics will probably glitch out.
 	std::string mModelName;
     
-	// Each array element is the FIRST vertex pose for each mesh/submesh index.
-	// Subsequent poses for the mesh are stored in the "next" of the first pose.
-	std::unordered_map<int, std::unordered_map<int, VertexAnimationVertexPose*>> mVertexPoses;
+	// Keyframes for one submesh's vertex positions.
+	//
+	// Most ACT keyframes store only small deltas from the previous keyframe, which take far less memory than full positions.
+	// So, we keep the delta data as-is, and only decode keyframes when sampled. Every so often, a keyframe is stored
+	// with full positions, so decoding never needs to apply too many deltas in a row.
+	struct VertexKeyframes
+	{
+		struct Keyframe
+		{
+			// Offset into either full positions (in vertices) or delta data (in bytes).
+			int offset = 0;
+			bool compressed = false;
+			
+			// Bounds of the keyframe's positions.
+			AABB bounds;
+		};
+		
+		int vertexCount = 0;
+		std::vector<int> frameNumbers;
+		std::vector<int> frameToKeyframe;
+		std::vector<Keyframe> keyframes;
+		
+		// Offset (in vertices) of the first keyframe in the GPU keyframe buffer. Keyframes follow one another.
+		int gpuOffset = 0;
+		
+		// Recently sampled poses, indexed by pose step (modulo cached pose count). Uses the decode mutex.
+		// Frame rate is part of the key: it decides which keyframes a time falls between.
+		struct CachedPose
+		{
+			float time = -1.0f;
+			int framesPerSecond = 0;
+			std::vector<float> positions;
+		};
+		static const int kCachedPoseCount = 2;
+		mutable CachedPose cachedPoses[kCachedPoseCount];
+		
+		// Full positions for uncompressed keyframes, and delta data (same format as the ACT file) for compressed keyframes.
+		std::vector<Vector3> fullPositions;
+		std::vector<unsigned char> deltaData;
+	};
+	
+	// A compressed keyframe that has been decoded. Recently decoded keyframes are kept around,
+	// since consecutive samples (and multiple actors playing the same animation) tend to need the same keyframes.
+	struct DecodedKeyframe
+	{
+		const VertexKeyframes* keyframes = nullptr;
+		int keyframeIndex = -1;
+		std::atomic<unsigned int> lastUsed { 0 };
+		std::vector<Vector3> positions;
+	};
+	
+	// Keyframes for one mesh's transform.
+	struct TransformKeyframes
+	{
+		std::vector<int> frameNumbers;
+		std::vector<int> frameToKeyframe;
+		std::vector<VertexAnimationTransformPose> poses;
+	};
+	
+	// Vertex keyframes for each submesh, indexed by [meshIndex][submeshIndex].
+	// A submesh with no vertex data has no frames.
+	std::vector<std::vector<VertexKeyframes>> mVertexKeyframes;
+	
+	// Transform keyframes for each mesh, indexed by mesh index.
+	std::vector<TransformKeyframes> mTransformKeyframes;
+	
+	// Buffer and texture containing all keyframe positions, for interpolating on the GPU. Each position is three floats.
+	GLuint mGPUBuffer = GL_NONE;
+	GLuint mGPUTexture = GL_NONE;
+	bool mGPUKeyframesFailed = false;
+	
+	// Least-recently-used cache of decoded keyframes.
+	// Poses may be sampled from multiple threads. Cache lookups need a shared lock, and decoding needs an exclusive lock.
+	static const int kDecodedKeyframeCacheSize = 8;
+	DecodedKeyframe mDecodedKeyframes[kDecodedKeyframeCacheSize];
+	std::atomic<unsigned int> mDecodeCounter { 0 };
+	std::shared_mutex mDecodeMutex;
+	
+	const VertexKeyframes* GetVertexKeyframes(int meshIndex, int submeshIndex) const;
+	
+	// Given keyframe frame numbers, finds the keyframes before and after a time, and the "t" value between them.
+	void FindKeyframes(const std::vector<int>& frameNumbers, const std::vector<int>& frameToKeyframe, float time, int framesPerSecond,
+					   int& outCurrentKeyframe, int& outNextKeyframe, float& outT) const;
+	
+	// Gets positions for a keyframe if it's uncompressed or already decoded, or null otherwise. Requires a shared lock.
+	const Vector3* FindKeyframePositions(const VertexKeyframes& keyframes, int keyframeIndex);
+	
+	// Gets positions for a keyframe, decoding it if needed. Requires an exclusive lock.
+	const Vector3* GetKeyframePositions(const VertexKeyframes& keyframes, int keyframeIndex);
+	
+	// Rounds a time to the nearest pose step. Returns the rounded time.
+	float GetPoseTime(float time, int framesPerSecond, int& outPoseStep) const;
+	
+	// Interpolates positions between the keyframes before and after a time.
+	void InterpolateVertexPose(const VertexKeyframes& keyframes, float time, int framesPerSecond, float* outPositions, int vertexCount);
+	
+	// Gets keyframes for a submesh, creating them if they don't exist yet.
+	VertexKeyframes& GetOrCreateVertexKeyframes(int meshIndex, int submeshIndex, int vertexCount);
+	
+	// Applies a compressed block of vertex deltas to positions. Returns the number of bytes in the block.
+	int ApplyVertexDeltas(const unsigned char* data, Vector3* positions, int positionCount);
+	
+	// Fills in a lookup from each frame in the animation to the last keyframe at or before it.
+	void BuildFrameToKeyframe(const std::vector<int>& frameNumbers, std::vector<int>& outFrameToKeyframe) const;
 	
-	// Each element of array is the FIRST transform poses for each mesh index.
-	// Subsequent poses for the mesh are stored in the "next" of the first pose.
-    std::vector<VertexAnimationTransformPose*> mTransformPoses;
-    
     void ParseFromData(char* data, int dataLength);
     
     float DecompressFloatFromByte(unsigned char val);
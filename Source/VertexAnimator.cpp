@@ -5,18 +5,144 @@
 //
 #include "VertexAnimator.h"
 
-#include <vector>
+#include <algorithm>
 
 #include "Actor.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "JobSystem.h"
 #include "Mesh.h"
 #include "MeshRenderer.h"
-#include "VertexAnimation.h"
+#include "Renderer.h"
+#include "Services.h"
 
 TYPE_DEF_CHILD(Component, VertexAnimator);
 
+std::vector<VertexAnimator*> VertexAnimator::sVertexAnimators;
+const float VertexAnimator::kReducedRateScreenSize = 0.1f;
+VertexAnimationLODStats VertexAnimator::sLODStats;
+
+void VertexAnimator::UpdateAll()
+{
+	// Gather animators that need a sample this frame.
+	// GPU keyframes are created here, since GL calls must be on the main thread.
+	struct PendingSample
+	{
+		VertexAnimator* animator = nullptr;
+		VertexAnimation* animation = nullptr;
+		float time = 0.0f;
+		bool useGPU = false;
+	};
+	std::vector<PendingSample> pendingSamples;
+	
+	// Visibility decides how much sampling work each animator needs: none if off screen, less if small on screen.
+	sLODStats = VertexAnimationLODStats();
+	Renderer* renderer = Services::GetRenderer();
+	Camera* camera = renderer != nullptr ? renderer->GetCamera() : nullptr;
+	Frustum frustum;
+	Vector3 cameraPosition;
+	float reducedRateDistanceScale = 0.0f;
+	if(camera != nullptr)
+	{
+		frustum = Frustum(camera->GetProjectionMatrix() * camera->GetLookAtMatrix());
+		cameraPosition = camera->GetOwner()->GetPosition();
+		
+		// If bounds radius is less than distance times this, the actor covers less than "screen size" of half the view height.
+		reducedRateDistanceScale = kReducedRateScreenSize * Math::Tan(camera->GetCameraFovRadians() * 0.5f);
+	}
+	
+	for(auto& animator : sVertexAnimators)
+	{
+		if(!animator->mSamplePending || animator->mVertexAnimation == nullptr) { continue; }
+		animator->mSamplePending = false;
+		
+		PendingSample pendingSample;
+		pendingSample.animator = animator;
+		pendingSample.animation = animator->mVertexAnimation;
+		
+		float duration = pendingSample.animation->GetDuration(animator->mFramesPerSecond);
+		pendingSample.time = Math::Clamp(animator->mVertexAnimationTimer, 0.0f, duration);
+		
+		// The final pose is always sampled, so actors don't come back into view in the wrong pose.
+		if(camera != nullptr && animator->mLODEnabled && animator->mVertexAnimationTimer < duration)
+		{
+			AABB bounds = animator->mMeshRenderer->GetAABB();
+			if(!frustum.IntersectsAABB(bounds))
+			{
+				++sLODStats.culled;
+				continue;
+			}
+			
+			// Small on screen, so only sample every few frames.
+			float radius = bounds.GetExtents().GetLength();
+			float distance = (bounds.GetCenter() - cameraPosition).GetLength();
+			if(radius < distance * reducedRateDistanceScale)
+			{
+				float step = static_cast<float>(kReducedRateFrames) / animator->mFramesPerSecond;
+				pendingSample.time = Math::Floor(pendingSample.time / step) * step;
+				if(pendingSample.time == animator->mLastSampleTime)
+				{
+					++sLODStats.reducedRate;
+					continue;
+				}
+			}
+		}
+		
+		pendingSample.useGPU = pendingSample.animation->CreateGPUKeyframes();
+		pendingSamples.push_back(pendingSample);
+	}
+	sLODStats.sampled = static_cast<int>(pendingSamples.size());
+	if(pendingSamples.empty()) { return; }
+	
+	// Sample every animator in parallel. Each animator only writes to its own buffers.
+	auto samplePoses = [&pendingSamples](int start, int end) {
+		for(int i = start; i < end; ++i)
+		{
+			PendingSample& pendingSample = pendingSamples[i];
+			pendingSample.animator->SamplePose(pendingSample.animation, pendingSample.time, pendingSample.useGPU);
+		}
+	};
+	JobSystem* jobSystem = Services::Get<JobSystem>();
+	if(jobSystem != nullptr)
+	{
+		jobSystem->ParallelFor(static_cast<int>(pendingSamples.size()), 1, samplePoses);
+	}
+	else
+	{
+		samplePoses(0, static_cast<int>(pendingSamples.size()));
+	}
+	
+	// Apply results and handle animations reaching the end, in a fixed order.
+	for(auto& pendingSample : pendingSamples)
+	{
+		// A stop callback from an earlier animator may have stopped or changed this animation. If so, the sample is stale.
+		VertexAnimator* animator = pendingSample.animator;
+		if(animator->mVertexAnimation != pendingSample.animation) { continue; }
+		animator->ApplyPose(pendingSample.animation, pendingSample.time, pendingSample.useGPU);
+		animator->mLastSampleTime = pendingSample.time;
+		
+		// If at the end of the animation, clear animation.
+		// GK3 doesn't really have the concept of a "looping" animation. Looping is handled by higher-level control scripts.
+		if(animator->mVertexAnimationTimer >= pendingSample.animation->GetDuration(animator->mFramesPerSecond))
+		{
+			animator->Stop(nullptr);
+		}
+	}
+}
+
 VertexAnimator::VertexAnimator(Actor* owner) : Component(owner)
 {
 	mMeshRenderer = owner->GetComponent<MeshRenderer>();
+	sVertexAnimators.push_back(this);
+}
+
+VertexAnimator::~VertexAnimator()
+{
+	auto it = std::find(sVertexAnimators.begin(), sVertexAnimators.end(), this);
+	if(it != sVertexAnimators.end())
+	{
+		sVertexAnimators.erase(it);
+	}
 }
 
 void VertexAnimator::Start(VertexAnimation* anim, int framesPerSecond, std::function<void()> stopCallback)
@@ -31,6 +157,8 @@ void VertexAnimator::Start(VertexAnimation* anim, int framesPerSecond, std::func
 	
 	// Reset animation timer.
 	mVertexAnimationTimer = 0.0f;
+	mSamplePending = false;
+	mLastSampleTime = -1.0f;
 }
 
 void VertexAnimator::Start(VertexAnimation* anim, int framesPerSecond, std::function<void()> stopCallback, float time)
@@ -39,7 +167,7 @@ void VertexAnimator::Start(VertexAnimation* anim, int framesPerSecond, std::func
 	mVertexAnimationTimer = time;
 
 	// Sample animation at current timer value.
-	TakeSample(mVertexAnimation, mVertexAnimationTimer);
+	TakeSample(mVertexAnimation, mVertexAnimationTimer, true);
 }
 
 void VertexAnimator::Stop(VertexAnimation* anim)
@@ -47,6 +175,13 @@ void VertexAnimator::Stop(VertexAnimation* anim)
 	// Stop if animation matches playing one OR null was passed in.
 	if(mVertexAnimation != nullptr && (mVertexAnimation == anim || anim == nullptr))
 	{
+		// If vertices were being interpolated on the GPU, bake the final pose into the submeshes.
+		// Otherwise, the renderer would keep referring to an animation that may be unloaded.
+		if(mMeshRenderer->GetGPUVertexAnimation() == mVertexAnimation)
+		{
+			TakeSample(mVertexAnimation, mMeshRenderer->GetGPUVertexAnimationTime());
+		}
+		
 		// Fire stop callback if an animation was in progress.
 		if(mStopCallback != nullptr)
 		{
@@ -73,43 +208,107 @@ void VertexAnimator::OnUpdate(float deltaTime)
 	// Need a vertex animation to update.
 	if(mVertexAnimation != nullptr)
 	{
-		// Increment animation timer.
+		// Increment animation timer. Sampling happens for all animators at once, in UpdateAll.
 		mVertexAnimationTimer += deltaTime;
-		
-		// Sample animation at current timer value, clamping to anim duration.
-		float animDuration = mVertexAnimation->GetDuration(mFramesPerSecond);
-		TakeSample(mVertexAnimation, Math::Clamp(mVertexAnimationTimer, 0.0f, animDuration));
-		
-		// If at the end of the animation, clear animation.
-		// GK3 doesn't really have the concept of a "looping" animation. Looping is handled by higher-level control scripts.
-		if(mVertexAnimationTimer >= animDuration)
-		{
-			Stop(nullptr);
-		}
+		mSamplePending = true;
 	}
 }
 
-void VertexAnimator::TakeSample(VertexAnimation* animation, float time)
+void VertexAnimator::TakeSample(VertexAnimation* animation, float time, bool allowGPU)
+{
+	// Vertex positions can be interpolated by the vertex shader, which saves sampling and uploading every vertex every frame.
+	// Fall back on the CPU if keyframes can't be put on the GPU.
+	bool useGPU = allowGPU && animation->CreateGPUKeyframes();
+	SamplePose(animation, time, useGPU);
+	ApplyPose(animation, time, useGPU);
+}
+
+void VertexAnimator::SamplePose(VertexAnimation* animation, float time, bool useGPU)
 {
 	// Iterate through each mesh and sample it in the vertex animation.
 	// We need to sample both vertex poses and transform poses to get the right result.
-	const std::vector<Mesh*> meshes = mMeshRenderer->GetMeshes();
+	const std::vector<Mesh*>& meshes = mMeshRenderer->GetMeshes();
+	mSampledTransforms.resize(meshes.size());
+	mSampledBounds.resize(meshes.size());
+	mSampledBoundsValid.resize(meshes.size());
+	mSampledPoseTag = animation->GetPoseTag(time, mFramesPerSecond);
+	int submeshIndex = 0;
 	for(int i = 0; i < meshes.size(); i++)
 	{
 		const std::vector<Submesh*>& submeshes = meshes[i]->GetSubmeshes();
-		for(int j = 0; j < submeshes.size(); j++)
+		for(int j = 0; j < submeshes.size() && !useGPU; j++)
+		{
+			if(submeshIndex >= mSampledPositions.size())
+			{
+				mSampledPositions.emplace_back();
+				mSampledPositionsValid.push_back(false);
+			}
+			
+			// If the submesh already holds this pose (e.g. display rate is higher than pose rate), no need to sample it.
+			if(submeshes[j]->GetPositionsTag() == mSampledPoseTag)
+			{
+				mSampledPositionsValid[submeshIndex] = false;
+				++submeshIndex;
+				continue;
+			}
+			
+			// Sample into a buffer, rather than the submesh - the submesh may be shared with actors being sampled on other threads.
+			int vertexCount = submeshes[j]->GetVertexCount();
+			std::vector<float>& positions = mSampledPositions[submeshIndex];
+			positions.resize(vertexCount * 3);
+			mSampledPositionsValid[submeshIndex] = animation->SampleVertexPose(time, mFramesPerSecond, i, j, positions.data(), vertexCount);
+			++submeshIndex;
+		}
+		
+		mSampledTransforms[i] = animation->SampleTransformPose(time, mFramesPerSecond, i);
+		mSampledBoundsValid[i] = animation->SampleMeshBounds(time, mFramesPerSecond, i, mSampledBounds[i]);
+	}
+}
+
+void VertexAnimator::ApplyPose(VertexAnimation* animation, float time, bool useGPU)
+{
+	mMeshRenderer->SetGPUVertexAnimation(useGPU ? animation : nullptr, time, mFramesPerSecond);
+	
+	const std::vector<Mesh*>& meshes = mMeshRenderer->GetMeshes();
+	int submeshIndex = 0;
+	for(int i = 0; i < meshes.size() && i < mSampledTransforms.size(); i++)
+	{
+		// Copy sampled positions into the submesh, which also uploads them.
+		// Skip if the submesh already holds this pose - another actor sharing the mesh may have just applied it.
+		const std::vector<Submesh*>& submeshes = meshes[i]->GetSubmeshes();
+		for(int j = 0; j < submeshes.size() && !useGPU; j++)
 		{
-			VertexAnimationVertexPose sample = animation->SampleVertexPose(time, mFramesPerSecond, i, j);
-			if(sample.mFrameNumber >= 0)
+			Submesh* submesh = submeshes[j];
+			if(submesh->GetPositionsTag() == mSampledPoseTag)
 			{
-                submeshes[j]->SetPositions(reinterpret_cast<float*>(sample.mVertexPositions.data()), true);
+				VertexAnimation::CountSkippedUpload();
 			}
+			else if(mSampledPositionsValid[submeshIndex] && submesh->GetPositions() != nullptr)
+			{
+				submesh->SetPositions(mSampledPositions[submeshIndex].data(), true);
+				submesh->SetPositionsTag(mSampledPoseTag);
+			}
+			++submeshIndex;
+		}
+		
+		if(mSampledTransforms[i].mFrameNumber >= 0)
+		{
+			meshes[i]->SetMeshToLocalMatrix(mSampledTransforms[i].GetMeshToLocalMatrix());
 		}
 		
-		VertexAnimationTransformPose transformSample = animation->SampleTransformPose(time, mFramesPerSecond, i);
-		if(transformSample.mFrameNumber >= 0)
+		// Posed vertices can move well away from the mesh's own bounds, so bounds must follow the pose.
+		// Without vertex data, the mesh keeps its last pose's vertices, so it keeps that pose's bounds too.
+		if(mSampledBoundsValid[i])
 		{
-			meshes[i]->SetMeshToLocalMatrix(transformSample.GetMeshToLocalMatrix());
+			mMeshRenderer->SetPoseAABB(i, mSampledBounds[i]);
 		}
 	}
+	
+	// Meshes have likely moved, so world bounds are out of date.
+	mMeshRenderer->SetBoundsDirty();
+	
+	if(mPoseAppliedCallback != nullptr)
+	{
+		mPoseAppliedCallback();
+	}
 }
@@ -9,9 +9,24 @@
 #include "Component.h"
 
 #include <functional>
+#include <vector>
+
+#include "VertexAnimation.h"
 
 class MeshRenderer;
-class VertexAnimation;
+
+// Counts of vertex animation sampling work done and skipped in the last frame.
+struct VertexAnimationLODStats
+{
+	// Animators that sampled a pose.
+	int sampled = 0;
+	
+	// Animators that didn't sample because they were off screen.
+	int culled = 0;
+	
+	// Animators that didn't sample because they're small on screen, and the reduced rate pose hadn't changed.
+	int reducedRate = 0;
+};
 
 /*
 struct VertexAnimParams
@@ -34,7 +49,15 @@ class VertexAnimator : public Component
 {
 	TYPE_DECL_CHILD();
 public:
+	// Samples all playing vertex animations, spread across job threads, then applies the results on this thread.
+	// Results are applied (and stop callbacks fired) in the order animators were created, so it's deterministic.
+	// Called once per frame, after actors update.
+	static void UpdateAll();
+	
+	static const VertexAnimationLODStats& GetLODStats() { return sLODStats; }
+	
 	VertexAnimator(Actor* owner);
+	~VertexAnimator();
 	
 	void Start(VertexAnimation* anim, int framesPerSecond, std::function<void()> stopCallback);
 	void Start(VertexAnimation* anim, int framesPerSecond, std::function<void()> stopCallback, float time);
@@ -44,10 +67,29 @@ public:
 	
 	bool IsPlaying() const { return mVertexAnimation != nullptr; }
 	
+	// Fired right after each new pose is applied to the meshes, in the same frame it was sampled.
+	// Anything that follows the mesh's pose (e.g. an actor moved by its animation) should sync here, not in its own update.
+	void SetPoseAppliedCallback(std::function<void()> callback) { mPoseAppliedCallback = callback; }
+	
+	// If enabled, sampling is skipped while the actor is off screen, and done at a reduced rate while it's small on screen.
+	// The animation still advances, and the final pose is always sampled. Disable if something relies on the pose every frame.
+	void SetLODEnabled(bool enabled) { mLODEnabled = enabled; }
+	
 protected:
 	void OnUpdate(float deltaTime) override;
 	
 private:
+	// All vertex animators, in creation order.
+	static std::vector<VertexAnimator*> sVertexAnimators;
+	
+	// Actors smaller than this on screen (bounds radius relative to half the view height) sample at a reduced rate.
+	static const float kReducedRateScreenSize;
+	
+	// When sampling at a reduced rate, poses are only sampled every this many animation frames.
+	static const int kReducedRateFrames = 2;
+	
+	static VertexAnimationLODStats sLODStats;
+	
 	// The mesh renderer that will be animated.
 	MeshRenderer* mMeshRenderer = nullptr;
 	
@@ -61,8 +103,34 @@ private:
 	// "Stops" means manually stopped OR reached end of playback!
 	std::function<void()> mStopCallback = nullptr;
 	
+	// Callback that is fired after a pose is applied.
+	std::function<void()> mPoseAppliedCallback = nullptr;
+	
 	// Timer for tracking progress on vertex animation.
 	float mVertexAnimationTimer = 0.0f;
 	
-	void TakeSample(VertexAnimation* animation, float time);
+	// Set when the timer advances, so the animation is sampled in the next UpdateAll.
+	bool mSamplePending = false;
+	
+	// Whether sampling can be skipped/reduced based on visibility, and time of the last applied sample (negative if none).
+	bool mLODEnabled = true;
+	float mLastSampleTime = -1.0f;
+	
+	// Results of the last sample, waiting to be applied to the meshes.
+	// Positions are per submesh, counting across all meshes. Positions are only sampled if not interpolating on the GPU.
+	// Bounds of each mesh's sampled vertices are kept whether or not interpolating on the GPU.
+	std::vector<VertexAnimationTransformPose> mSampledTransforms;
+	std::vector<AABB> mSampledBounds;
+	std::vector<bool> mSampledBoundsValid;
+	std::vector<std::vector<float>> mSampledPositions;
+	std::vector<bool> mSampledPositionsValid;
+	uint64_t mSampledPoseTag = 0;
+	
+	// Samples transforms and vertices. If "allowGPU" is set and the animation supports it, vertices are interpolated on the GPU.
+	void TakeSample(VertexAnimation* animation, float time, bool allowGPU = false);
+	
+	// Sampling is split in two: sampling only reads from the animation and meshes, so it can run on any thread.
+	// Applying changes meshes (which may be shared with other actors), so it must happen on the main thread.
+	void SamplePose(VertexAnimation* animation, float time, bool useGPU);
+	void ApplyPose(VertexAnimation* animation, float time, bool useGPU);
 };
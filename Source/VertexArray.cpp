@@ -7,26 +7,50 @@
 
 #include <iostream>
 
+#include "GLState.h"
+
 // Some OpenGL calls take in array indexes/offsets as pointers.
 // This macro just makes the syntax clearer for the reader.
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
+namespace
+{
+    GLenum GetGLType(VertexAttribute::Type type)
+    {
+        switch(type)
+        {
+        default:
+        case VertexAttribute::Type::Float:
+            return GL_FLOAT;
+        case VertexAttribute::Type::HalfFloat:
+            return GL_HALF_FLOAT;
+        case VertexAttribute::Type::Short:
+            return GL_SHORT;
+        case VertexAttribute::Type::UnsignedShort:
+            return GL_UNSIGNED_SHORT;
+        }
+    }
+}
+
+const char* VertexArray::kInstanceMatrixAttributeName = "vInstanceMatrix";
+
 VertexArray::VertexArray(const MeshDefinition& data) :
     mData(data)
 {
     // Generate and bind VBO.
-    glGenBuffers(1, &mVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    mVBO = GLState::GetBackend()->CreateBuffer();
+    GLState::BindBuffer(GL_ARRAY_BUFFER, mVBO);
     
     // Determine VBO usage and size.
     GLenum usage = (mData.meshUsage == MeshUsage::Static) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
     GLsizeiptr size = mData.vertexCount * mData.vertexDefinition.CalculateSize();
     
     // For packed data, we'll assume that the vertex data is a struct containing ordered pointers to each packed section.
-    if(mData.vertexDefinition.layout == VertexDefinition::Layout::Packed)
+    // If no vertex data is provided, the buffer is left empty - fill it in later with ChangeVertexData.
+    if(mData.vertexDefinition.layout == VertexDefinition::Layout::Packed && mData.vertexData != nullptr)
     {
         // Create buffer of desired size, but don't fill it with anything.
-        glBufferData(GL_ARRAY_BUFFER, size, NULL, usage);
+        GLState::GetBackend()->BufferData(GL_ARRAY_BUFFER, size, NULL, usage);
         
         // For packed data, we'll assume the vertex data is a structure containing pointers to each packed attribute.
         // For example: struct VertexData { float* positions; float* uvs; }
@@ -46,7 +70,7 @@ VertexArray::VertexArray(const MeshDefinition& data) :
             void* actualDataPtr = *pointerToPointerToData;
             
             // Load attribute data to GPU.
-            glBufferSubData(GL_ARRAY_BUFFER, offset, attributeSize, actualDataPtr);
+            GLState::GetBackend()->BufferSubData(GL_ARRAY_BUFFER, offset, attributeSize, actualDataPtr);
             
             // Next attribute's offset is calculated by adding this attribute's size.
             offset += attributeSize;
@@ -55,10 +79,14 @@ VertexArray::VertexArray(const MeshDefinition& data) :
             dataPtr = static_cast<char*>(dataPtr) + sizeof(char*);
         }
     }
+    else if(mData.vertexDefinition.layout == VertexDefinition::Layout::Packed)
+    {
+        GLState::GetBackend()->BufferData(GL_ARRAY_BUFFER, size, NULL, usage);
+    }
     else
     {
         // Allocate VBO of needed size, and fill it with provided vertex data (if any).
-        glBufferData(GL_ARRAY_BUFFER, size, data.vertexData, usage);
+        GLState::GetBackend()->BufferData(GL_ARRAY_BUFFER, size, data.vertexData, usage);
     }
     
     // If index data was provided, populate IBO.
@@ -66,8 +94,8 @@ VertexArray::VertexArray(const MeshDefinition& data) :
     
     // Generate and bind VAO object.
     {
-        glGenVertexArrays(1, &mVAO);
-        glBindVertexArray(mVAO);
+        mVAO = GLState::GetBackend()->CreateVertexArray();
+        GLState::BindVertexArray(mVAO);
         
         // Stride can be calculated once and used over and over.
         // For packed data, stride is zero. For interleaved data, stride is size of vertex.
@@ -80,16 +108,16 @@ VertexArray::VertexArray(const MeshDefinition& data) :
             int attributeId = static_cast<int>(attribute.semantic);
             
             // Must enable the attribute to use it in shader code.
-            glEnableVertexAttribArray(attributeId);
+            GLState::GetBackend()->EnableVertexAttribArray(attributeId);
             
             // Convert attribute values to GL types.
             GLint count = attribute.count;
-            GLenum type = GL_FLOAT; //TODO: We can assume float for now...but when supporting other attribute types, we'll need some conversion logic.
+            GLenum type = GetGLType(attribute.type);
             GLboolean normalize = attribute.normalize ? GL_TRUE : GL_FALSE;
             int offset = mData.vertexDefinition.CalculateAttributeOffset(attributeIndex, mData.vertexCount);
             
             // Define vertex attribute in VAO.
-            glVertexAttribPointer(attributeId, count, type, normalize, stride, BUFFER_OFFSET(offset));
+            GLState::GetBackend()->VertexAttribPointer(attributeId, count, type, normalize, stride, BUFFER_OFFSET(offset));
             ++attributeIndex;
         }
     }
@@ -102,9 +130,9 @@ VertexArray::VertexArray(const MeshDefinition& data) :
 
 VertexArray::~VertexArray()
 {
-    glDeleteBuffers(1, &mVBO);
-    glDeleteVertexArrays(1, &mVAO);
-    glDeleteBuffers(1, &mIBO);
+    GLState::DeleteBuffer(mVBO);
+    GLState::DeleteVertexArray(mVAO);
+    GLState::DeleteBuffer(mIBO);
 }
 
 VertexArray::VertexArray(VertexArray&& other)
@@ -118,6 +146,7 @@ VertexArray& VertexArray::operator=(VertexArray&& other)
     mVBO = other.mVBO;
     mVAO = other.mVAO;
     mIBO = other.mIBO;
+    mIBOCapacity = other.mIBOCapacity;
     
     other.mVBO = GL_NONE;
     other.mVAO = GL_NONE;
@@ -128,8 +157,8 @@ VertexArray& VertexArray::operator=(VertexArray&& other)
 void VertexArray::ChangeVertexData(void* data)
 {
     // Assuming that the data is the correct size to fill the entire buffer.
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, mData.vertexCount * mData.vertexDefinition.CalculateSize(), data);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, mVBO);
+    GLState::GetBackend()->BufferSubData(GL_ARRAY_BUFFER, 0, mData.vertexCount * mData.vertexDefinition.CalculateSize(), data);
 }
 
 void VertexArray::ChangeVertexData(VertexAttribute::Semantic semantic, void *data)
@@ -153,8 +182,8 @@ void VertexArray::ChangeVertexData(VertexAttribute::Semantic semantic, void *dat
         // Update sub-data, if semantic matches.
         if(attribute.semantic == semantic)
         {
-            glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-            glBufferSubData(GL_ARRAY_BUFFER, offset, attributeSize, data);
+            GLState::BindBuffer(GL_ARRAY_BUFFER, mVBO);
+            GLState::GetBackend()->BufferSubData(GL_ARRAY_BUFFER, offset, attributeSize, data);
             return;
         }
         
@@ -165,10 +194,11 @@ void VertexArray::ChangeVertexData(VertexAttribute::Semantic semantic, void *dat
 
 void VertexArray::ChangeIndexData(unsigned short* indexes, unsigned int count)
 {
-    // If changing existing buffer contents, but the count is different, we must create delete old buffer and make a new one.
-    if(mIBO != GL_NONE && mData.indexCount != count)
+    // If changing existing buffer contents, but the new data doesn't fit, we must delete old buffer and make a new one.
+    // If the new data is smaller, it can just overwrite the start of the existing buffer.
+    if(mIBO != GL_NONE && count > mIBOCapacity)
     {
-        glDeleteBuffers(1, &mIBO);
+        GLState::DeleteBuffer(mIBO);
         mIBO = GL_NONE;
     }
     
@@ -227,42 +257,82 @@ void VertexArray::Draw(GLenum mode) const
 void VertexArray::Draw(GLenum mode, unsigned int offset, unsigned int count) const
 {
     // Bind vertex array object.
-    glBindVertexArray(mVAO);
+    GLState::BindVertexArray(mVAO);
     
     // Draw method depends on whether we have indexes or not.
     if(mIBO != GL_NONE)
     {
         // Bind index buffer.
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+        GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
         
         // Draw "count" indices at offset.
-        glDrawElements(mode, count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(offset * sizeof(GLushort)));
+        GLState::GetBackend()->DrawElements(mode, count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(offset * sizeof(GLushort)));
     }
     else
     {
         // Draw "count" triangles at offset.
-        glDrawArrays(mode, offset, count);
+        GLState::GetBackend()->DrawArrays(mode, offset, count);
+    }
+}
+
+void VertexArray::DrawInstanced(GLenum mode, GLuint instanceBuffer, unsigned int firstInstance, unsigned int instanceCount) const
+{
+    RenderBackend* backend = GLState::GetBackend();
+    
+    // Bind vertex array object.
+    GLState::BindVertexArray(mVAO);
+    
+    // Point the instance matrix columns at this draw's matrices, advancing once per instance rather than once per vertex.
+    // GL 3.3 can't offset instance IDs when drawing, so the first instance is applied as a buffer offset instead.
+    GLState::BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    GLsizei matrixSize = 16 * sizeof(GLfloat);
+    for(int i = 0; i < 4; ++i)
+    {
+        GLuint attributeId = kInstanceMatrixAttribute + i;
+        backend->EnableVertexAttribArray(attributeId);
+        backend->VertexAttribPointer(attributeId, 4, GL_FLOAT, GL_FALSE, matrixSize, BUFFER_OFFSET(firstInstance * matrixSize + i * 4 * sizeof(GLfloat)));
+        backend->VertexAttribDivisor(attributeId, 1);
+    }
+    
+    // Draw method depends on whether we have indexes or not.
+    if(mIBO != GL_NONE)
+    {
+        GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+        backend->DrawElementsInstanced(mode, mData.indexCount, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0), instanceCount);
+    }
+    else
+    {
+        backend->DrawArraysInstanced(mode, 0, mData.vertexCount, instanceCount);
+    }
+    
+    // Non-instanced draws with this VAO shouldn't read from the instance buffer.
+    for(int i = 0; i < 4; ++i)
+    {
+        backend->DisableVertexAttribArray(kInstanceMatrixAttribute + i);
     }
 }
                     
 void VertexArray::RefreshIBOContents(unsigned short* indexData, int indexCount)
 {
+    RenderBackend* backend = GLState::GetBackend();
+    
     if(indexData != nullptr && indexCount > 0)
     {
         // Either create new buffer and fill with index data,
         // Or populate existing buffer with new data.
         if(mIBO == GL_NONE)
         {
-            glGenBuffers(1, &mIBO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+            mIBO = backend->CreateBuffer();
+            GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
             
             GLenum glUsage = (mData.meshUsage == MeshUsage::Static) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLushort), indexData, glUsage);
+            backend->BufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLushort), indexData, glUsage);
+            mIBOCapacity = indexCount;
         }
         else
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
-            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * sizeof(GLushort), indexData);
+            GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+            backend->BufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * sizeof(GLushort), indexData);
         }
     }
 }
@@ -49,6 +49,11 @@ struct MeshDefinition
 class VertexArray
 {
 public:
+    // Instanced draws get a per-instance object to world matrix from this attribute, after all vertex semantics.
+    // A matrix takes four attribute slots, one per column.
+    static const int kInstanceMatrixAttribute = static_cast<int>(VertexAttribute::Semantic::SemanticCount);
+    static const char* kInstanceMatrixAttributeName;
+    
     VertexArray() = default;
     VertexArray(const MeshDefinition& data);
     ~VertexArray();
@@ -61,6 +66,8 @@ public:
     VertexArray(VertexArray&& other);
     VertexArray& operator=(VertexArray&& other);
     
+    const VertexDefinition& GetVertexDefinition() const { return mData.vertexDefinition; }
+    
     void ChangeVertexData(void* data);
     void ChangeVertexData(VertexAttribute::Semantic semantic, void* data);
     
@@ -81,6 +88,10 @@ public:
     void Draw(GLenum mode) const;
     void Draw(GLenum mode, unsigned int offset, unsigned int count) const;
     
+    // Draws all vertices/indexes once per instance.
+    // Instance matrices are read from a buffer of tightly packed Matrix4s, starting at the given instance.
+    void DrawInstanced(GLenum mode, GLuint instanceBuffer, unsigned int firstInstance, unsigned int instanceCount) const;
+    
 private:
     // Definition data passed in.
     // Note that vertex/index data pointers SHOULD NOT be considered valid after construction!
@@ -93,6 +104,9 @@ private:
     // It's optional, but improves performance.
     GLuint mIBO = GL_NONE;
     
+    // Number of indexes the IBO has room for. Index data up to this size can be changed without reallocating.
+    unsigned int mIBOCapacity = 0;
+    
     // The VAO (vertex array object) provides mapping info for the VBO.
     // The VBO is just a big chunk of memory. The VAO dictates how to interpret the memory to read vertex data.
     GLuint mVAO = GL_NONE;
@@ -0,0 +1,223 @@
+//
+// VertexCompression.cpp
+//
+// Clark Kromenaker
+//
+#include "VertexCompression.h"
+
+#include <cstring>
+
+#include "GMath.h"
+
+namespace
+{
+	// Number of floats per vertex in source data for each attribute semantic.
+	int GetSourceCount(VertexAttribute::Semantic semantic)
+	{
+		switch(semantic)
+		{
+		case VertexAttribute::Semantic::Position:
+		case VertexAttribute::Semantic::Normal:
+			return 3;
+		case VertexAttribute::Semantic::Color:
+			return 4;
+		default:
+			return 2;
+		}
+	}
+	
+	// Like Sign, but zero counts as positive. Octahedral encoding needs every value to fold to one side or the other.
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+uint16_t VertexCompression::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t floatExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	
+	// Infinity stays infinity, and NaN stays NaN.
+	if(floatExponent == 0xFF)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+	}
+	
+	// Too big for a half becomes infinity.
+	int exponent = static_cast<int>(floatExponent) - 127 + 15;
+	if(exponent >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00);
+	}
+	
+	// Too small for a normal half becomes a subnormal half, or zero.
+	if(exponent <= 0)
+	{
+		if(exponent < -10) { return static_cast<uint16_t>(sign); }
+		
+		// Add implicit leading 1 and shift down. Round to nearest, ties to even.
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if(remainder > halfway || (remainder == halfway && (half & 1) != 0)) { ++half; }
+		return static_cast<uint16_t>(sign | half);
+	}
+	
+	// Drop low mantissa bits. Round to nearest, ties to even. Rounding up may carry into the exponent, which is still correct.
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0)) { ++half; }
+	return static_cast<uint16_t>(sign | half);
+}
+
+float VertexCompression::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+	
+	uint32_t bits = 0;
+	if(exponent == 0)
+	{
+		if(mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// Subnormal half - shift until there's a leading 1, which a float represents implicitly.
+			exponent = 127 - 15 + 1;
+			while((mantissa & 0x400) == 0)
+			{
+				mantissa <<= 1;
+				--exponent;
+			}
+			mantissa &= 0x3FF;
+			bits = sign | (exponent << 23) | (mantissa << 13);
+		}
+	}
+	else if(exponent == 31)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+int16_t VertexCompression::FloatToSnorm16(float value)
+{
+	return static_cast<int16_t>(Math::RoundToInt(Math::Clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint16_t VertexCompression::FloatToUnorm16(float value)
+{
+	return static_cast<uint16_t>(Math::RoundToInt(Math::Clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+Vector2 VertexCompression::EncodeOctahedral(const Vector3& normal)
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1.
+	float length = Math::Abs(normal.x) + Math::Abs(normal.y) + Math::Abs(normal.z);
+	if(length <= 0.0f) { return Vector2(0.0f, 0.0f); }
+	Vector2 encoded(normal.x / length, normal.y / length);
+	
+	// The upper half maps to the inner diamond of the square. Fold the lower half out into the corners.
+	if(normal.z < 0.0f)
+	{
+		encoded = Vector2((1.0f - Math::Abs(encoded.y)) * SignNotZero(encoded.x),
+						  (1.0f - Math::Abs(encoded.x)) * SignNotZero(encoded.y));
+	}
+	return encoded;
+}
+
+Vector3 VertexCompression::DecodeOctahedral(const Vector2& encoded)
+{
+	// Reverse of encode: unfold corners back to the lower half, then normalize off the octahedron.
+	Vector3 normal(encoded.x, encoded.y, 1.0f - Math::Abs(encoded.x) - Math::Abs(encoded.y));
+	if(normal.z < 0.0f)
+	{
+		float x = normal.x;
+		normal.x = (1.0f - Math::Abs(normal.y)) * SignNotZero(x);
+		normal.y = (1.0f - Math::Abs(x)) * SignNotZero(normal.y);
+	}
+	normal.Normalize();
+	return normal;
+}
+
+bool VertexCompression::IsInRange(const float* values, int count, float min, float max)
+{
+	for(int i = 0; i < count; ++i)
+	{
+		if(values[i] < min || values[i] > max) { return false; }
+	}
+	return true;
+}
+
+void VertexCompression::EncodeAttribute(const VertexAttribute& attribute, const float* source, int vertexCount, uint8_t* output, int stride)
+{
+	int sourceCount = GetSourceCount(attribute.semantic);
+	for(int i = 0; i < vertexCount; ++i)
+	{
+		const float* sourceVertex = source + i * sourceCount;
+		uint8_t* outputVertex = output + i * stride;
+		
+		// Two component normals use octahedral encoding. Otherwise, each component converts separately.
+		float values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		if(attribute.semantic == VertexAttribute::Semantic::Normal && attribute.count == 2)
+		{
+			Vector2 encoded = EncodeOctahedral(Vector3(sourceVertex[0], sourceVertex[1], sourceVertex[2]));
+			values[0] = encoded.x;
+			values[1] = encoded.y;
+		}
+		else
+		{
+			// Any extra attribute components (e.g. padding) are zero.
+			for(int j = 0; j < attribute.count && j < sourceCount; ++j)
+			{
+				values[j] = sourceVertex[j];
+			}
+		}
+		
+		for(int j = 0; j < attribute.count && j < 4; ++j)
+		{
+			switch(attribute.type)
+			{
+			case VertexAttribute::Type::Float:
+				memcpy(outputVertex + j * sizeof(float), &values[j], sizeof(float));
+				break;
+			case VertexAttribute::Type::HalfFloat:
+			{
+				uint16_t half = FloatToHalf(values[j]);
+				memcpy(outputVertex + j * sizeof(uint16_t), &half, sizeof(uint16_t));
+				break;
+			}
+			case VertexAttribute::Type::Short:
+			{
+				// Non-normalized shorts are just truncated to integers.
+				int16_t value = attribute.normalize ? FloatToSnorm16(values[j]) : static_cast<int16_t>(values[j]);
+				memcpy(outputVertex + j * sizeof(int16_t), &value, sizeof(int16_t));
+				break;
+			}
+			case VertexAttribute::Type::UnsignedShort:
+			{
+				uint16_t value = attribute.normalize ? FloatToUnorm16(values[j]) : static_cast<uint16_t>(values[j]);
+				memcpy(outputVertex + j * sizeof(uint16_t), &value, sizeof(uint16_t));
+				break;
+			}
+			}
+		}
+	}
+}
@@ -0,0 +1,41 @@
+//
+// VertexCompression.h
+//
+// Clark Kromenaker
+//
+// Helpers for storing vertex data in compact formats.
+//
+// Full precision floats are often more than a vertex attribute needs. For example:
+//  - A unit normal can be mapped onto an octahedron and unfolded into a square, leaving two values in [-1, 1] (octahedral encoding).
+//    At 16 bits each, that's 4 bytes rather than 12, with error well under a tenth of a degree.
+//  - Half floats (16-bit) are precise enough for UVs, as long as they don't get too large (e.g. lots of texture tiling).
+//  - Values in a known range can be stored as 16-bit normalized integers (unorm16/snorm16), which the GPU converts back to floats.
+//
+#pragma once
+#include <cstdint>
+
+#include "Vector2.h"
+#include "Vector3.h"
+#include "VertexDefinition.h"
+
+namespace VertexCompression
+{
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+	
+	// Values are clamped to [-1, 1] or [0, 1] respectively.
+	int16_t FloatToSnorm16(float value);
+	uint16_t FloatToUnorm16(float value);
+	
+	// Maps a unit vector to a point in the [-1, 1] square, and back.
+	Vector2 EncodeOctahedral(const Vector3& normal);
+	Vector3 DecodeOctahedral(const Vector2& encoded);
+	
+	// Returns true if all values are within [min, max]. Handy for deciding whether a compact format is usable.
+	bool IsInRange(const float* values, int count, float min, float max);
+	
+	// Converts one attribute's float data into the attribute's format.
+	// Source data is 3 floats per vertex for positions and normals, 4 for colors, and 2 for UVs, regardless of the attribute's format.
+	// Each vertex is written "stride" bytes after the previous one, so this works for both packed and interleaved layouts.
+	void EncodeAttribute(const VertexAttribute& attribute, const float* source, int vertexCount, uint8_t* output, int stride);
+}
@@ -48,16 +48,66 @@ VertexAttribute VertexAttribute::UV2 {
     true
 };
 
+// Position has a fourth (unused) component, so attributes after it stay 4-byte aligned.
+VertexAttribute VertexAttribute::PositionQuantized {
+    Semantic::Position,
+    Type::UnsignedShort,
+    4,
+    true
+};
+
+VertexAttribute VertexAttribute::NormalOctahedral {
+    Semantic::Normal,
+    Type::Short,
+    2,
+    true
+};
+
+VertexAttribute VertexAttribute::UV1Half {
+    Semantic::UV1,
+    Type::HalfFloat,
+    2,
+    false
+};
+
+VertexAttribute VertexAttribute::UV2Unorm16 {
+    Semantic::UV2,
+    Type::UnsignedShort,
+    2,
+    true
+};
+
 int VertexAttribute::GetSize() const
 {
-    //TODO: Since the only Type is "Float" right now, assume byte size of 4.
-    //TODO: When more types are added, we'll need some sort of switch statement probably.
     int byteSize = 4;
+    switch(type)
+    {
+    case Type::Float:
+        byteSize = 4;
+        break;
+    case Type::HalfFloat:
+    case Type::Short:
+    case Type::UnsignedShort:
+        byteSize = 2;
+        break;
+    }
     
     // Size of an attribute is just byte size (based on type) and the count of the type.
     return byteSize * count;
 }
 
+const VertexAttribute* VertexDefinition::GetAttribute(VertexAttribute::Semantic semantic) const
+{
+    for(auto& attribute : attributes)
+    {
+        if(attribute.semantic == semantic)
+        {
+            return &attribute;
+        }
+    }
+    return nullptr;
+}
+
 int VertexDefinition::CalculateSize() const
 {
     // The size of a single vertex is just the summed size of all attributes.
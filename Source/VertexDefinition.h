@@ -34,10 +34,13 @@ struct VertexAttribute
     };
     
     // See https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glVertexAttribPointer.xhtml for other possible types.
-    // Currently only using Float, so no need to add them all yet.
+    // Smaller types save memory and bandwidth, at the cost of precision (see VertexCompression.h).
     enum class Type
     {
-        Float
+        Float,
+        HalfFloat,
+        Short,
+        UnsignedShort
     };
     
     // Different combinations of type/count/normalized allow for great flexibility in the format of an attribute.
@@ -48,6 +51,14 @@ struct VertexAttribute
     static VertexAttribute UV1;
     static VertexAttribute UV2;
     
+    // Compact variants of the common attributes.
+    // Quantized positions are unorm16 in [0, 1] relative to mesh bounds - decode by scaling/offsetting the object-to-world matrix.
+    // Octahedral normals are two snorm16 values. Half UVs suit most textures; unorm16 UVs only work for UVs in [0, 1].
+    static VertexAttribute PositionQuantized;
+    static VertexAttribute NormalOctahedral;
+    static VertexAttribute UV1Half;
+    static VertexAttribute UV2Unorm16;
+    
     // Semantic acts as a unique identifier for the attribute.
     Semantic semantic = Semantic::Position;
     
@@ -82,6 +93,9 @@ struct VertexDefinition
     // Order IS important!
     std::vector<VertexAttribute> attributes;
     
+    // Gets attribute with a semantic, or null if this definition doesn't have it.
+    const VertexAttribute* GetAttribute(VertexAttribute::Semantic semantic) const;
+    
     int CalculateSize() const;
     
     // "Stride" is the byte offset between attributes of the same type.
@@ -64,3 +64,16 @@ TEST_CASE("AABB get closest point works")
 	REQUIRE(aabb.GetClosestPoint(Vector3(0.0f, -90.0f, 5.0f)) == min);
 	REQUIRE(aabb.GetClosestPoint(Vector3(76.0f, 0.0f, 5.0f)) == Vector3(76.0f, -10.0f, 8.5f));
 }
+
+TEST_CASE("AABB grow to contain AABB works")
+{
+	AABB aabb(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+	aabb.GrowToContain(AABB(Vector3(-2.0f, 0.5f, 0.5f), Vector3(0.5f, 3.0f, 0.5f)));
+	REQUIRE(aabb.GetMin() == Vector3(-2.0f, 0.0f, 0.0f));
+	REQUIRE(aabb.GetMax() == Vector3(1.0f, 3.0f, 1.0f));
+	
+	// Growing to contain an invalid (empty) AABB has no effect.
+	aabb.GrowToContain(AABB(Vector3(10.0f, 10.0f, 10.0f), Vector3(-10.0f, -10.0f, -10.0f)));
+	REQUIRE(aabb.GetMin() == Vector3(-2.0f, 0.0f, 0.0f));
+	REQUIRE(aabb.GetMax() == Vector3(1.0f, 3.0f, 1.0f));
+}
@@ -0,0 +1,213 @@
+//
+// BVHTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for triangle BVH raycasts.
+//
+#include "catch.hh"
+#include "BVH.h"
+
+#include <random>
+
+namespace
+{
+	// Generates a "scene" of small random triangles. Fixed seed, so results are repeatable.
+	std::vector<Triangle> CreateRandomTriangles(int count)
+	{
+		std::mt19937 generator(1234);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+
+		std::vector<Triangle> triangles;
+		for(int i = 0; i < count; ++i)
+		{
+			Vector3 p0(position(generator), position(generator), position(generator));
+			Vector3 p1 = p0 + Vector3(offset(generator), offset(generator), offset(generator));
+			Vector3 p2 = p0 + Vector3(offset(generator), offset(generator), offset(generator));
+			triangles.emplace_back(p0, p1, p2);
+		}
+		return triangles;
+	}
+}
+
+TEST_CASE("BVH raycast matches brute force")
+{
+	std::vector<Triangle> triangles = CreateRandomTriangles(500);
+	BVH bvh;
+	bvh.Build(triangles);
+	REQUIRE(bvh.GetTriangleCount() == 500);
+
+	// Fire a bunch of rays through the scene.
+	std::mt19937 generator(5678);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	for(int i = 0; i < 200; ++i)
+	{
+		Vector3 origin(position(generator), 150.0f, position(generator));
+		Vector3 target(position(generator), -150.0f, position(generator));
+		Ray ray(origin, (target - origin).Normalize());
+
+		// Brute force: test every triangle to find nearest and count all hits.
+		float nearestT = FLT_MAX;
+		int hitCount = 0;
+		for(auto& triangle : triangles)
+		{
+			RaycastHit hitInfo;
+			if(Collisions::TestRayTriangle(ray, triangle, hitInfo))
+			{
+				nearestT = std::min(nearestT, hitInfo.t);
+				++hitCount;
+			}
+		}
+
+		// Nearest hit should match.
+		RaycastHit hitInfo;
+		int triangleIndex = -1;
+		bool hit = bvh.RaycastNearest(ray, [](int) { return true; }, hitInfo, triangleIndex);
+		REQUIRE(hit == (hitCount > 0));
+		if(hit)
+		{
+			REQUIRE(hitInfo.t == nearestT);
+
+			// Triangle index should refer to original triangle order.
+			RaycastHit triangleHitInfo;
+			REQUIRE(Collisions::TestRayTriangle(ray, triangles[triangleIndex], triangleHitInfo));
+			REQUIRE(triangleHitInfo.t == nearestT);
+		}
+
+		// Any hit should succeed in the same cases.
+		REQUIRE(bvh.RaycastAny(ray, [](int) { return true; }, hitInfo, triangleIndex) == (hitCount > 0));
+
+		// All hits should find the same number of triangles.
+		int bvhHitCount = 0;
+		bvh.RaycastAll(ray, [](int) { return true; }, [&bvhHitCount](int, float) { ++bvhHitCount; });
+		REQUIRE(bvhHitCount == hitCount);
+	}
+}
+
+TEST_CASE("BVH raycast filter works")
+{
+	// Two triangles facing down the z-axis, one behind the other.
+	std::vector<Triangle> triangles;
+	triangles.emplace_back(Vector3(-1.0f, -1.0f, 5.0f), Vector3(1.0f, -1.0f, 5.0f), Vector3(0.0f, 1.0f, 5.0f));
+	triangles.emplace_back(Vector3(-1.0f, -1.0f, 10.0f), Vector3(1.0f, -1.0f, 10.0f), Vector3(0.0f, 1.0f, 10.0f));
+	BVH bvh;
+	bvh.Build(triangles);
+
+	Ray ray(Vector3::Zero, Vector3::UnitZ);
+	RaycastHit hitInfo;
+	int triangleIndex = -1;
+
+	// Nearest should be the first triangle.
+	REQUIRE(bvh.RaycastNearest(ray, [](int) { return true; }, hitInfo, triangleIndex));
+	REQUIRE(triangleIndex == 0);
+	REQUIRE(Math::AreEqual(hitInfo.t, 5.0f));
+
+	// Filtering out the first triangle should give us the second one.
+	REQUIRE(bvh.RaycastNearest(ray, [](int index) { return index != 0; }, hitInfo, triangleIndex));
+	REQUIRE(triangleIndex == 1);
+	REQUIRE(Math::AreEqual(hitInfo.t, 10.0f));
+
+	// Filtering out everything means no hit.
+	REQUIRE(!bvh.RaycastAny(ray, [](int) { return false; }, hitInfo, triangleIndex));
+
+	// Empty BVH never hits anything.
+	BVH empty;
+	empty.Build(std::vector<Triangle>());
+	REQUIRE(!empty.RaycastNearest(ray, [](int) { return true; }, hitInfo, triangleIndex));
+}
+
+TEST_CASE("BVH raycast matches brute force after refit")
+{
+	std::vector<Triangle> triangles = CreateRandomTriangles(500);
+	BVH bvh;
+	bvh.Build(triangles);
+
+	// Move every triangle (like a vertex animation would), and shift the whole set so old bounds are definitely wrong.
+	std::mt19937 generator(4321);
+	std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+	for(auto& triangle : triangles)
+	{
+		Vector3 move(offset(generator) + 50.0f, offset(generator), offset(generator));
+		triangle = Triangle(triangle.p0 + move, triangle.p1 + move, triangle.p2 + move);
+	}
+	bvh.Refit(triangles);
+
+	// Bounds should contain all moved triangles.
+	AABB bounds = bvh.GetBounds();
+	for(auto& triangle : triangles)
+	{
+		REQUIRE(bounds.ContainsPoint(triangle.p0));
+		REQUIRE(bounds.ContainsPoint(triangle.p1));
+		REQUIRE(bounds.ContainsPoint(triangle.p2));
+	}
+
+	std::uniform_real_distribution<float> position(-50.0f, 150.0f);
+	for(int i = 0; i < 200; ++i)
+	{
+		Vector3 origin(position(generator), 150.0f, position(generator));
+		Vector3 target(position(generator), -150.0f, position(generator));
+		Ray ray(origin, (target - origin).Normalize());
+
+		float nearestT = FLT_MAX;
+		for(auto& triangle : triangles)
+		{
+			RaycastHit hitInfo;
+			if(Collisions::TestRayTriangle(ray, triangle, hitInfo))
+			{
+				nearestT = std::min(nearestT, hitInfo.t);
+			}
+		}
+
+		RaycastHit hitInfo;
+		int triangleIndex = -1;
+		bool hit = bvh.RaycastNearest(ray, [](int) { return true; }, hitInfo, triangleIndex);
+		REQUIRE(hit == (nearestT != FLT_MAX));
+		if(hit)
+		{
+			REQUIRE(hitInfo.t == nearestT);
+		}
+	}
+}
+
+TEST_CASE("BVH overlap query matches brute force")
+{
+	std::vector<Triangle> triangles = CreateRandomTriangles(500);
+	BVH bvh;
+	bvh.Build(triangles);
+
+	std::mt19937 generator(8765);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> extents(1.0f, 30.0f);
+	for(int i = 0; i < 100; ++i)
+	{
+		AABB box(Vector3(position(generator), position(generator), position(generator)), extents(generator), extents(generator), extents(generator));
+
+		// Brute force: a triangle overlaps if its bounds overlap the box.
+		std::vector<bool> expected(triangles.size(), false);
+		for(int j = 0; j < triangles.size(); ++j)
+		{
+			AABB triangleBox(triangles[j].p0, triangles[j].p0);
+			triangleBox.GrowToContain(triangles[j].p1);
+			triangleBox.GrowToContain(triangles[j].p2);
+
+			Vector3 min = box.GetMin();
+			Vector3 max = box.GetMax();
+			Vector3 triangleMin = triangleBox.GetMin();
+			Vector3 triangleMax = triangleBox.GetMax();
+			expected[j] = triangleMin.x <= max.x && triangleMax.x >= min.x &&
+						  triangleMin.y <= max.y && triangleMax.y >= min.y &&
+						  triangleMin.z <= max.z && triangleMax.z >= min.z;
+		}
+
+		// Every overlapping triangle should be reported exactly once.
+		std::vector<int> found(triangles.size(), 0);
+		bvh.QueryOverlaps(box, [&found](int triangleIndex) { ++found[triangleIndex]; });
+		bool allMatch = true;
+		for(int j = 0; j < triangles.size(); ++j)
+		{
+			allMatch &= found[j] == (expected[j] ? 1 : 0);
+		}
+		REQUIRE(allMatch);
+	}
+}
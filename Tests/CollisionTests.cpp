@@ -7,9 +7,12 @@
 //
 #include "catch.hh"
 #include "Collisions.h"
+#include "Ray.h"
 #include "Sphere.h"
 #include "Triangle.h"
 
+#include <random>
+
 TEST_CASE("Sphere intersect triangle works")
 {
 	// Create a sphere at the origin.
@@ -28,3 +31,90 @@ TEST_CASE("Sphere intersect triangle works")
 	Sphere s2(Vector3::Zero + intersect, 10.0f);
 	REQUIRE(!Collisions::TestSphereTriangle(s2, t, intersect));
 }
+
+TEST_CASE("Sphere intersect triangle packet works")
+{
+	// Same sphere and triangle as above, in the second lane of a packet.
+	Sphere s(Vector3::Zero, 10.0f);
+	TrianglePacket4 packet;
+	packet.Set(1, Vector3(5.0f, -2.0f, -2.0f), Vector3(5.0f, -2.0f,  2.0f), Vector3(5.0f,  2.0f,  0.0f));
+	
+	// A triangle far away in the third lane.
+	packet.Set(2, Vector3(50.0f, -2.0f, -2.0f), Vector3(50.0f, -2.0f,  2.0f), Vector3(50.0f,  2.0f,  0.0f));
+	
+	// Only the second lane may intersect. Unused lanes never intersect.
+	REQUIRE(Collisions::TestSphereTrianglePacket4(s, packet) == (1 << 1));
+	
+	// After moving the sphere out of the triangle, nothing intersects.
+	Sphere s2(Vector3(-5.0f, 0.0f, 0.0f), 10.0f);
+	REQUIRE(Collisions::TestSphereTrianglePacket4(s2, packet) == 0);
+	
+	// Packet test is conservative - it must never reject a triangle that the exact test says intersects.
+	std::mt19937 generator(4321);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	for(int i = 0; i < 500; ++i)
+	{
+		Triangle triangles[4];
+		for(int lane = 0; lane < 4; ++lane)
+		{
+			triangles[lane] = Triangle(Vector3(position(generator), position(generator), position(generator)),
+									   Vector3(position(generator), position(generator), position(generator)),
+									   Vector3(position(generator), position(generator), position(generator)));
+			packet.Set(lane, triangles[lane].p0, triangles[lane].p1, triangles[lane].p2);
+		}
+		
+		Sphere sphere(Vector3(position(generator), position(generator), position(generator)), 5.0f);
+		int mask = Collisions::TestSphereTrianglePacket4(sphere, packet);
+		for(int lane = 0; lane < 4; ++lane)
+		{
+			Vector3 intersection;
+			if(Collisions::TestSphereTriangle(sphere, triangles[lane], intersection))
+			{
+				REQUIRE((mask & (1 << lane)) != 0);
+			}
+		}
+	}
+}
+
+TEST_CASE("Ray intersect triangle packet matches single triangle test")
+{
+	std::mt19937 generator(8765);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	int hitCount = 0;
+	for(int i = 0; i < 500; ++i)
+	{
+		// Some large triangles, so plenty of rays hit. Leave the last lane unused.
+		Triangle triangles[3];
+		TrianglePacket4 packet;
+		for(int lane = 0; lane < 3; ++lane)
+		{
+			triangles[lane] = Triangle(Vector3(position(generator), position(generator), position(generator)),
+									   Vector3(position(generator), position(generator), position(generator)),
+									   Vector3(position(generator), position(generator), position(generator)));
+			packet.Set(lane, triangles[lane].p0, triangles[lane].p1, triangles[lane].p2);
+		}
+		
+		Vector3 origin(position(generator), position(generator), position(generator));
+		Vector3 target(position(generator) * 0.5f, position(generator) * 0.5f, position(generator) * 0.5f);
+		Ray ray(origin, (target - origin).Normalize());
+		
+		// Hit lanes and "t" values should exactly match the single triangle test.
+		float t[4];
+		int mask = Collisions::TestRayTrianglePacket4(ray, packet, t);
+		for(int lane = 0; lane < 3; ++lane)
+		{
+			RaycastHit hitInfo;
+			bool hit = Collisions::TestRayTriangle(ray, triangles[lane], hitInfo);
+			REQUIRE(hit == ((mask & (1 << lane)) != 0));
+			if(hit)
+			{
+				REQUIRE(t[lane] == hitInfo.t);
+				++hitCount;
+			}
+		}
+		REQUIRE((mask & (1 << 3)) == 0);
+	}
+	
+	// Make sure the test actually exercised hits.
+	REQUIRE(hitCount > 50);
+}
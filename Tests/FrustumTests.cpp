@@ -0,0 +1,92 @@
+//
+// FrustumTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for view frustum culling.
+//
+#include "catch.hh"
+#include "Frustum.h"
+
+namespace
+{
+	// A frustum at the origin looking down +z, with 90 degree FOV, near plane at 1, and far plane at 100.
+	Frustum CreateTestFrustum()
+	{
+		float near = 1.0f;
+		float far = 100.0f;
+		Matrix4 projection = Matrix4::Zero;
+		projection(0, 0) = 1.0f;
+		projection(1, 1) = 1.0f;
+		projection(2, 2) = (far + near) / (far - near);
+		projection(2, 3) = (-2.0f * far * near) / (far - near);
+		projection(3, 2) = 1.0f;
+		return Frustum(projection);
+	}
+}
+
+TEST_CASE("Frustum contains points")
+{
+	Frustum frustum = CreateTestFrustum();
+	
+	// Planes should be normalized and face inward. Far plane loses a bit of precision from the projection math.
+	REQUIRE(Math::AreEqual(frustum.GetPlane(4).normal.z, 1.0f));
+	REQUIRE(Math::AreEqual(frustum.GetPlane(4).distance, -1.0f));
+	REQUIRE(Math::AreEqual(frustum.GetPlane(5).normal.z, -1.0f));
+	REQUIRE(Math::Abs(frustum.GetPlane(5).distance - 100.0f) < 0.01f);
+	
+	REQUIRE(frustum.ContainsPoint(Vector3(0.0f, 0.0f, 10.0f)));
+	REQUIRE(frustum.ContainsPoint(Vector3(9.0f, -9.0f, 10.0f)));
+	
+	// Behind camera, in front of near plane, beyond far plane, and outside the sides.
+	REQUIRE(!frustum.ContainsPoint(Vector3(0.0f, 0.0f, -10.0f)));
+	REQUIRE(!frustum.ContainsPoint(Vector3(0.0f, 0.0f, 0.5f)));
+	REQUIRE(!frustum.ContainsPoint(Vector3(0.0f, 0.0f, 101.0f)));
+	REQUIRE(!frustum.ContainsPoint(Vector3(11.0f, 0.0f, 10.0f)));
+	REQUIRE(!frustum.ContainsPoint(Vector3(0.0f, -11.0f, 10.0f)));
+}
+
+TEST_CASE("Frustum AABB tests")
+{
+	Frustum frustum = CreateTestFrustum();
+	
+	// Box fully inside - all planes are cleared from the mask.
+	unsigned int planeMask = Frustum::kAllPlanes;
+	REQUIRE(frustum.IntersectsAABB(AABB(Vector3(-1.0f, -1.0f, 10.0f), Vector3(1.0f, 1.0f, 12.0f)), planeMask));
+	REQUIRE(planeMask == 0);
+	
+	// Box straddling the right plane - only the right plane is left in the mask.
+	planeMask = Frustum::kAllPlanes;
+	REQUIRE(frustum.IntersectsAABB(AABB(Vector3(5.0f, -1.0f, 10.0f), Vector3(15.0f, 1.0f, 12.0f)), planeMask));
+	REQUIRE(planeMask == (1 << 1));
+	
+	// Boxes fully outside.
+	REQUIRE(!frustum.IntersectsAABB(AABB(Vector3(-1.0f, -1.0f, -12.0f), Vector3(1.0f, 1.0f, -10.0f))));
+	REQUIRE(!frustum.IntersectsAABB(AABB(Vector3(20.0f, -1.0f, 10.0f), Vector3(30.0f, 1.0f, 12.0f))));
+	REQUIRE(!frustum.IntersectsAABB(AABB(Vector3(-1.0f, -1.0f, 150.0f), Vector3(1.0f, 1.0f, 160.0f))));
+	
+	// Box surrounding the camera intersects.
+	REQUIRE(frustum.IntersectsAABB(AABB(Vector3(-50.0f, -50.0f, -50.0f), Vector3(50.0f, 50.0f, 50.0f))));
+	
+	// Planes not in the mask are skipped - a box outside only the right plane passes if that plane isn't tested.
+	planeMask = Frustum::kAllPlanes & ~(1 << 1);
+	REQUIRE(frustum.IntersectsAABB(AABB(Vector3(20.0f, -1.0f, 10.0f), Vector3(30.0f, 1.0f, 12.0f)), planeMask));
+}
+
+TEST_CASE("Frustum equality")
+{
+	// Frustums from the same matrix are equal.
+	REQUIRE(CreateTestFrustum() == CreateTestFrustum());
+	
+	// Moving the camera changes the frustum.
+	Matrix4 translation = Matrix4::Identity;
+	translation(0, 3) = 5.0f;
+	Matrix4 projection = Matrix4::Zero;
+	projection(0, 0) = 1.0f;
+	projection(1, 1) = 1.0f;
+	projection(2, 2) = 101.0f / 99.0f;
+	projection(2, 3) = -200.0f / 99.0f;
+	projection(3, 2) = 1.0f;
+	REQUIRE(Frustum(projection) == CreateTestFrustum());
+	REQUIRE(Frustum(projection * translation) != CreateTestFrustum());
+}
@@ -0,0 +1,222 @@
+//
+// GLStateTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for the GL state cache, and the null render backend it can run on.
+//
+#include "catch.hh"
+#include "GLState.h"
+#include "NullRenderBackend.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST_CASE("GL state cache skips redundant calls")
+{
+	NullRenderBackend backend;
+	GLState::SetBackend(&backend);
+	GLState::EndFrame();
+
+	// Repeats of the same state are skipped.
+	GLState::UseProgram(1);
+	GLState::UseProgram(1);
+	GLState::Enable(GL_BLEND);
+	GLState::Enable(GL_BLEND);
+	GLState::Disable(GL_BLEND);
+	GLState::DepthMask(GL_FALSE);
+	GLState::DepthMask(GL_FALSE);
+
+	// Texture binds are per unit.
+	GLState::ActiveTexture(0);
+	GLState::BindTexture(GL_TEXTURE_2D, 5);
+	GLState::ActiveTexture(1);
+	GLState::BindTexture(GL_TEXTURE_2D, 5);
+	GLState::ActiveTexture(0);
+	GLState::BindTexture(GL_TEXTURE_2D, 5);
+
+	// The element array buffer belongs to the VAO, so it must be bound again after the VAO changes.
+	GLState::BindVertexArray(1);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+	GLState::BindVertexArray(2);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+
+	// A deleted buffer's name may be reused, so binding it again must be issued.
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 3);
+	GLState::DeleteBuffer(3);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 3);
+
+	// Everything the cache issued reached the backend, and nothing else did.
+	backend.Present();
+	GLState::EndFrame();
+	const GLStateStats& stats = GLState::GetFrameStats();
+	REQUIRE(stats.issued == 15);
+	REQUIRE(stats.elided == 5);
+	REQUIRE(backend.GetFrameStats().stateChanges == stats.issued);
+
+	// Forgetting state issues everything again.
+	GLState::Invalidate();
+	GLState::UseProgram(1);
+	GLState::EndFrame();
+	REQUIRE(GLState::GetFrameStats().issued == 1);
+	REQUIRE(GLState::GetFrameStats().elided == 0);
+
+	// Without a backend, deletes do nothing.
+	GLState::SetBackend(nullptr);
+	GLState::DeleteBuffer(3);
+	GLState::DeleteTexture(5);
+}
+
+TEST_CASE("Null render backend records draws and uploads")
+{
+	NullRenderBackend backend;
+	REQUIRE(backend.Initialize("Test", 640, 480));
+
+	// Objects get unique, nonzero names.
+	GLuint buffer = backend.CreateBuffer();
+	GLuint texture = backend.CreateTexture();
+	REQUIRE(buffer != GL_NONE);
+	REQUIRE(texture != GL_NONE);
+	REQUIRE(buffer != texture);
+
+	// Shaders compile and link.
+	GLint status = GL_FALSE;
+	backend.GetShaderiv(backend.CreateShader(GL_VERTEX_SHADER), GL_COMPILE_STATUS, &status);
+	REQUIRE(status == GL_TRUE);
+	GLuint program = backend.CreateProgram();
+	backend.GetProgramiv(program, GL_LINK_STATUS, &status);
+	REQUIRE(status == GL_TRUE);
+
+	// Allocating without data isn't an upload.
+	unsigned char data[100] = { 0 };
+	backend.BufferData(GL_ARRAY_BUFFER, 100, data, GL_STATIC_DRAW);
+	backend.BufferData(GL_ARRAY_BUFFER, 100, nullptr, GL_DYNAMIC_DRAW);
+	backend.BufferSubData(GL_ARRAY_BUFFER, 0, 20, data);
+	backend.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 4, 2, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+	// Instanced draws count every instance's vertices.
+	backend.DrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+	backend.DrawArraysInstanced(GL_TRIANGLES, 0, 3, 4);
+	backend.Uniform1f(0, 1.0f);
+	backend.Present();
+
+	const NullRenderBackendStats& frame = backend.GetFrameStats();
+	REQUIRE(frame.bufferBytesUploaded == 120);
+	REQUIRE(frame.textureBytesUploaded == 32);
+	REQUIRE(frame.drawCalls == 2);
+	REQUIRE(frame.instancedDrawCalls == 1);
+	REQUIRE(frame.verticesDrawn == 18);
+	REQUIRE(frame.uniformChanges == 1);
+
+	// Frame stats start over each frame; totals keep adding up.
+	backend.DrawArrays(GL_TRIANGLES, 0, 3);
+	backend.Present();
+	REQUIRE(backend.GetFrameStats().drawCalls == 1);
+	REQUIRE(backend.GetFrameStats().bufferBytesUploaded == 0);
+	REQUIRE(backend.GetTotalStats().drawCalls == 3);
+	REQUIRE(backend.GetFrameCount() == 2);
+}
+
+TEST_CASE("Null render backend finds shader inputs from source")
+{
+	NullRenderBackend backend;
+	GLuint vertexShader = backend.CreateShader(GL_VERTEX_SHADER);
+	backend.ShaderSource(vertexShader, R"(#version 150
+		in vec3 vPos;
+		layout(location = 2) in vec2 vUV1;
+		layout(std140) uniform CameraUniforms
+		{
+			mat4 gViewMatrix;
+			mat4 gWorldToProjMatrix;
+		};
+		uniform mat4 gObjectToWorldMatrix;
+		uniform int gInstanced = 0; // uniform float gCommentedOut;
+		vec4 Transform(in vec3 position) { return gWorldToProjMatrix * gObjectToWorldMatrix * vec4(position, 1.0f); }
+		void main() { gl_Position = Transform(vPos); }
+	)");
+	GLuint fragmentShader = backend.CreateShader(GL_FRAGMENT_SHADER);
+	backend.ShaderSource(fragmentShader, R"(#version 150
+		in vec2 fUV1;
+		/* uniform vec4 uCommentedOut; */
+		uniform sampler2D uDiffuse;
+		uniform int gInstanced;
+		void main() { }
+	)");
+
+	GLuint program = backend.CreateProgram();
+	backend.AttachShader(program, vertexShader);
+	backend.AttachShader(program, fragmentShader);
+	backend.BindAttribLocation(program, 5, "vUV1");
+	backend.LinkProgram(program);
+	backend.DetachShader(program, vertexShader);
+	backend.DetachShader(program, fragmentShader);
+	backend.DeleteShader(vertexShader);
+	backend.DeleteShader(fragmentShader);
+
+	// Every declared uniform is active, including uniform block members. Shared declarations are only counted once.
+	GLint uniformCount = 0;
+	backend.GetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	REQUIRE(uniformCount == 5);
+	GLint blockCount = 0;
+	backend.GetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	REQUIRE(blockCount == 1);
+
+	// Uniforms can be listed by index, and their locations are distinct and stable. Block members have no location.
+	std::vector<GLint> locations;
+	for(GLint i = 0; i < uniformCount; ++i)
+	{
+		GLchar name[64];
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		backend.GetActiveUniform(program, i, sizeof(name), &length, &size, &type, name);
+		REQUIRE(length == static_cast<GLsizei>(strlen(name)));
+		REQUIRE(type != GL_NONE);
+
+		GLint location = backend.GetUniformLocation(program, name);
+		REQUIRE(location == backend.GetUniformLocation(program, name));
+		if(strncmp(name, "gView", 5) == 0 || strncmp(name, "gWorld", 6) == 0)
+		{
+			REQUIRE(location == -1);
+		}
+		else
+		{
+			REQUIRE(location >= 0);
+			REQUIRE(std::find(locations.begin(), locations.end(), location) == locations.end());
+			locations.push_back(location);
+		}
+	}
+	REQUIRE(locations.size() == 3);
+
+	// Names that don't fit are cut off, with room left for the null terminator.
+	GLchar name[8];
+	GLsizei length = 0;
+	GLint size = 0;
+	GLenum type = GL_NONE;
+	backend.GetActiveUniform(program, 4, sizeof(name), &length, &size, &type, name);
+	REQUIRE(std::string(name) == "uDiffus");
+	REQUIRE(length == 7);
+	REQUIRE(type == GL_SAMPLER_2D);
+
+	// Undeclared and commented out names aren't found.
+	REQUIRE(backend.GetUniformLocation(program, "gCommentedOut") == -1);
+	REQUIRE(backend.GetUniformLocation(program, "uCommentedOut") == -1);
+	REQUIRE(backend.GetUniformLocation(program, "position") == -1);
+
+	// Uniform blocks and vertex attributes are found too. Bound attribute locations are used.
+	REQUIRE(backend.GetUniformBlockIndex(program, "CameraUniforms") == 0);
+	REQUIRE(backend.GetUniformBlockIndex(program, "LightUniforms") == GL_INVALID_INDEX);
+	REQUIRE(backend.GetAttribLocation(program, "vPos") >= 0);
+	REQUIRE(backend.GetAttribLocation(program, "vUV1") == 5);
+	REQUIRE(backend.GetAttribLocation(program, "fUV1") == -1);
+	REQUIRE(backend.GetAttribLocation(program, "vInstanceMatrix") == -1);
+
+	// Nothing is found for a deleted program.
+	backend.DeleteProgram(program);
+	backend.GetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	REQUIRE(uniformCount == 0);
+	REQUIRE(backend.GetUniformLocation(program, "gObjectToWorldMatrix") == -1);
+}
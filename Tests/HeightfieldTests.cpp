@@ -0,0 +1,54 @@
+//
+// HeightfieldTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for floor heightfield queries.
+//
+#include "catch.hh"
+#include "Heightfield.h"
+
+TEST_CASE("Heightfield height and surface queries work")
+{
+	// A 100x100 floor made of two triangles, sloping up along the x-axis (y = x / 10).
+	std::vector<Triangle> triangles;
+	std::vector<int> surfaceIndexes;
+	triangles.emplace_back(Vector3(0.0f, 0.0f, 0.0f), Vector3(100.0f, 10.0f, 0.0f), Vector3(100.0f, 10.0f, 100.0f));
+	surfaceIndexes.push_back(3);
+	triangles.emplace_back(Vector3(0.0f, 0.0f, 0.0f), Vector3(100.0f, 10.0f, 100.0f), Vector3(0.0f, 0.0f, 100.0f));
+	surfaceIndexes.push_back(7);
+
+	// A vertical wall, which should be ignored.
+	triangles.emplace_back(Vector3(50.0f, 0.0f, 50.0f), Vector3(50.0f, 100.0f, 50.0f), Vector3(50.0f, 0.0f, 60.0f));
+	surfaceIndexes.push_back(9);
+
+	Heightfield heightfield;
+	heightfield.Build(triangles, surfaceIndexes);
+
+	// Height should match slope, and surface should match the triangle under the point.
+	float height = 0.0f;
+	int surfaceIndex = -1;
+	REQUIRE(heightfield.GetHeight(Vector3(75.0f, 1000.0f, 25.0f), height, surfaceIndex));
+	REQUIRE(Math::AreEqual(height, 7.5f));
+	REQUIRE(surfaceIndex == 3);
+
+	REQUIRE(heightfield.GetHeight(Vector3(25.0f, -1000.0f, 75.0f), height, surfaceIndex));
+	REQUIRE(Math::AreEqual(height, 2.5f));
+	REQUIRE(surfaceIndex == 7);
+
+	// Points on the edge of the floor still count as being on the floor.
+	REQUIRE(heightfield.GetHeight(Vector3(100.0f, 0.0f, 100.0f), height));
+	REQUIRE(Math::AreEqual(height, 10.0f));
+
+	// Outside the floor, no height.
+	REQUIRE(!heightfield.GetHeight(Vector3(-1.0f, 0.0f, 50.0f), height));
+	REQUIRE(!heightfield.GetHeight(Vector3(50.0f, 0.0f, 101.0f), height));
+
+	// Add a raised platform overlapping part of the floor - highest floor should win.
+	triangles.emplace_back(Vector3(10.0f, 50.0f, 10.0f), Vector3(30.0f, 50.0f, 10.0f), Vector3(10.0f, 50.0f, 30.0f));
+	surfaceIndexes.push_back(11);
+	heightfield.Build(triangles, surfaceIndexes);
+	REQUIRE(heightfield.GetHeight(Vector3(15.0f, 0.0f, 15.0f), height, surfaceIndex));
+	REQUIRE(Math::AreEqual(height, 50.0f));
+	REQUIRE(surfaceIndex == 11);
+}
@@ -0,0 +1,116 @@
+//
+// JobSystemTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for running jobs on worker threads.
+//
+#include "catch.hh"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <vector>
+
+TEST_CASE("Job system runs parallel for batches exactly once")
+{
+	for(int workerCount : { 0, 1, 3 })
+	{
+		JobSystem jobSystem;
+		jobSystem.Initialize(workerCount);
+		REQUIRE(jobSystem.GetThreadCount() == workerCount + 1);
+
+		// Every index should be visited once, including a partial final batch.
+		std::vector<std::atomic<int>> visits(1003);
+		jobSystem.ParallelFor(static_cast<int>(visits.size()), 16, [&visits](int start, int end) {
+			for(int i = start; i < end; ++i)
+			{
+				++visits[i];
+			}
+		});
+
+		bool allVisitedOnce = true;
+		for(auto& visit : visits)
+		{
+			allVisitedOnce &= visit == 1;
+		}
+		REQUIRE(allVisitedOnce);
+
+		// Nothing to do is fine too.
+		jobSystem.ParallelFor(0, 16, [](int, int) { FAIL("Shouldn't run any batches."); });
+		jobSystem.Shutdown();
+	}
+}
+
+TEST_CASE("Job system parents wait for children")
+{
+	JobSystem jobSystem;
+	jobSystem.Initialize(3);
+
+	// A parent that forks more jobs while running. Waiting on the parent joins all of them.
+	std::atomic<int> count(0);
+	JobSystem::Job* parent = nullptr;
+	parent = jobSystem.CreateJob([&jobSystem, &count, &parent]() {
+		for(int i = 0; i < 100; ++i)
+		{
+			JobSystem::Job* child = jobSystem.CreateJob([&count]() { ++count; }, parent);
+			jobSystem.Run(child);
+			jobSystem.Release(child);
+		}
+	});
+	jobSystem.Run(parent);
+	jobSystem.Wait(parent);
+	REQUIRE(count == 100);
+	jobSystem.Shutdown();
+}
+
+TEST_CASE("Job system runs jobs after their dependencies")
+{
+	for(int workerCount : { 0, 3 })
+	{
+		JobSystem jobSystem;
+		jobSystem.Initialize(workerCount);
+
+		// A diamond: "first" runs, then "left" and "right", then "last".
+		// Jobs are run in reverse order to make sure dependencies (not run order) decide when they start.
+		std::atomic<int> step(0);
+		int firstStep = -1;
+		int leftStep = -1;
+		int rightStep = -1;
+		int lastStep = -1;
+		JobSystem::Job* first = jobSystem.CreateJob([&]() { firstStep = step++; });
+		JobSystem::Job* left = jobSystem.CreateJob([&]() { leftStep = step++; });
+		JobSystem::Job* right = jobSystem.CreateJob([&]() { rightStep = step++; });
+		JobSystem::Job* last = jobSystem.CreateJob([&]() { lastStep = step++; });
+		jobSystem.AddDependency(left, first);
+		jobSystem.AddDependency(right, first);
+		jobSystem.AddDependency(last, left);
+		jobSystem.AddDependency(last, right);
+
+		jobSystem.Run(last);
+		jobSystem.Run(right);
+		jobSystem.Run(left);
+		REQUIRE(!jobSystem.IsFinished(last));
+		jobSystem.Run(first);
+		jobSystem.Wait(last);
+		jobSystem.Release(right);
+		jobSystem.Release(left);
+		jobSystem.Wait(first);
+
+		REQUIRE(firstStep == 0);
+		REQUIRE(leftStep > firstStep);
+		REQUIRE(rightStep > firstStep);
+		REQUIRE(lastStep == 3);
+
+		// Depending on an already finished job doesn't hold anything up.
+		JobSystem::Job* done = jobSystem.CreateJob(nullptr);
+		jobSystem.Run(done);
+		while(!jobSystem.IsFinished(done)) { }
+		JobSystem::Job* after = jobSystem.CreateJob([&]() { ++step; });
+		jobSystem.AddDependency(after, done);
+		jobSystem.Run(after);
+		jobSystem.Wait(after);
+		jobSystem.Release(done);
+		REQUIRE(step == 5);
+		jobSystem.Shutdown();
+	}
+}
@@ -0,0 +1,94 @@
+//
+// MeshOptimizerTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for mesh vertex cache optimization.
+//
+#include "catch.hh"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace
+{
+	// Rotates a triangle so its lowest vertex index is first, so triangles can be compared regardless of starting vertex.
+	// Rotation (rather than full sort) keeps winding significant.
+	std::array<unsigned short, 3> GetCanonicalTriangle(const unsigned short* triangle)
+	{
+		int first = 0;
+		if(triangle[1] < triangle[first]) { first = 1; }
+		if(triangle[2] < triangle[first]) { first = 2; }
+		return { triangle[first], triangle[(first + 1) % 3], triangle[(first + 2) % 3] };
+	}
+}
+
+TEST_CASE("Vertex cache optimization improves ACMR and keeps triangles")
+{
+	// A 40x40 grid of quads, with triangles in random order. Random order is about as bad as it gets for the vertex cache.
+	const int kGridSize = 40;
+	const int kVertexCount = (kGridSize + 1) * (kGridSize + 1);
+	std::vector<unsigned short> indexes;
+	for(int z = 0; z < kGridSize; ++z)
+	{
+		for(int x = 0; x < kGridSize; ++x)
+		{
+			unsigned short v0 = z * (kGridSize + 1) + x;
+			unsigned short v1 = v0 + 1;
+			unsigned short v2 = v0 + (kGridSize + 1);
+			unsigned short v3 = v2 + 1;
+			indexes.insert(indexes.end(), { v0, v2, v1 });
+			indexes.insert(indexes.end(), { v1, v2, v3 });
+		}
+	}
+	int triangleCount = static_cast<int>(indexes.size()) / 3;
+	std::vector<int> triangleOrder(triangleCount);
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		triangleOrder[i] = i;
+	}
+	std::shuffle(triangleOrder.begin(), triangleOrder.end(), std::mt19937(1234));
+	std::vector<unsigned short> shuffled;
+	for(int triangleIndex : triangleOrder)
+	{
+		shuffled.insert(shuffled.end(), indexes.begin() + triangleIndex * 3, indexes.begin() + triangleIndex * 3 + 3);
+	}
+
+	// Shuffled ACMR should be near worst case. Optimized should be much better - a grid optimizes to below 1.0.
+	float acmrBefore = MeshOptimizer::CalculateACMR(&shuffled[0], static_cast<int>(shuffled.size()), kVertexCount);
+	REQUIRE(acmrBefore > 2.0f);
+
+	std::vector<unsigned short> optimized = shuffled;
+	MeshOptimizer::OptimizeVertexCache(&optimized[0], static_cast<int>(optimized.size()), kVertexCount);
+	float acmrAfter = MeshOptimizer::CalculateACMR(&optimized[0], static_cast<int>(optimized.size()), kVertexCount);
+	REQUIRE(acmrAfter < 1.0f);
+
+	// Should have exactly the same triangles, with the same winding.
+	std::vector<std::array<unsigned short, 3>> trianglesBefore;
+	std::vector<std::array<unsigned short, 3>> trianglesAfter;
+	for(int i = 0; i < triangleCount; ++i)
+	{
+		trianglesBefore.push_back(GetCanonicalTriangle(&shuffled[i * 3]));
+		trianglesAfter.push_back(GetCanonicalTriangle(&optimized[i * 3]));
+	}
+	std::sort(trianglesBefore.begin(), trianglesBefore.end());
+	std::sort(trianglesAfter.begin(), trianglesAfter.end());
+	REQUIRE(trianglesBefore == trianglesAfter);
+
+	// Stats should include this mesh.
+	const MeshOptimizer::Stats& stats = MeshOptimizer::GetStats();
+	REQUIRE(stats.meshCount >= 1);
+	REQUIRE(stats.GetACMRAfter() < stats.GetACMRBefore());
+
+	// Optimizing again shouldn't make it any worse.
+	MeshOptimizer::OptimizeVertexCache(&optimized[0], static_cast<int>(optimized.size()), kVertexCount);
+	REQUIRE(MeshOptimizer::CalculateACMR(&optimized[0], static_cast<int>(optimized.size()), kVertexCount) <= acmrAfter);
+
+	// Out of range indexes are left alone.
+	std::vector<unsigned short> invalid = { 0, 1, 2, 2, 1, 50 };
+	std::vector<unsigned short> invalidCopy = invalid;
+	MeshOptimizer::OptimizeVertexCache(&invalid[0], static_cast<int>(invalid.size()), 3);
+	REQUIRE(invalid == invalidCopy);
+}
@@ -0,0 +1,93 @@
+//
+// RenderQueueTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for render queue sort keys and sorting.
+//
+#include "catch.hh"
+#include "RenderQueue.h"
+
+namespace
+{
+	// Stand-ins for shaders, textures, and meshes. Sort keys only use their addresses.
+	int shaders[2];
+	int textures[2];
+	int meshes[2];
+}
+
+TEST_CASE("Render queue sorts opaque items by state, then front-to-back")
+{
+	RenderQueue::Pass opaque = RenderQueue::Pass::Opaque;
+	
+	// Same state: nearer items first.
+	uint64_t near = RenderQueue::MakeKey(opaque, &shaders[0], &textures[0], &meshes[0], 5.0f);
+	uint64_t far = RenderQueue::MakeKey(opaque, &shaders[0], &textures[0], &meshes[0], 500.0f);
+	REQUIRE(near < far);
+	
+	// Negative depth (behind the camera) is treated as zero.
+	REQUIRE(RenderQueue::MakeKey(opaque, &shaders[0], &textures[0], &meshes[0], -10.0f) == RenderQueue::MakeKey(opaque, &shaders[0], &textures[0], &meshes[0], 0.0f));
+	
+	// Different shaders never interleave, no matter the depth.
+	uint64_t shaderANear = RenderQueue::MakeKey(opaque, &shaders[0], &textures[0], &meshes[0], 1.0f);
+	uint64_t shaderAFar = RenderQueue::MakeKey(opaque, &shaders[0], &textures[1], &meshes[1], 1000.0f);
+	uint64_t shaderBNear = RenderQueue::MakeKey(opaque, &shaders[1], &textures[0], &meshes[0], 1.0f);
+	uint64_t shaderBFar = RenderQueue::MakeKey(opaque, &shaders[1], &textures[1], &meshes[1], 1000.0f);
+	bool aBeforeB = shaderANear < shaderBNear;
+	REQUIRE(aBeforeB == (shaderAFar < shaderBNear));
+	REQUIRE(aBeforeB == (shaderANear < shaderBFar));
+	REQUIRE(aBeforeB == (shaderAFar < shaderBFar));
+}
+
+TEST_CASE("Render queue sorts translucent items back-to-front")
+{
+	RenderQueue::Pass translucent = RenderQueue::Pass::Translucent;
+	
+	// Depth wins over state.
+	uint64_t near = RenderQueue::MakeKey(translucent, &shaders[0], &textures[0], &meshes[0], 5.0f);
+	uint64_t far = RenderQueue::MakeKey(translucent, &shaders[1], &textures[1], &meshes[1], 6.0f);
+	REQUIRE(far < near);
+	
+	// All translucent items come after all opaque items.
+	uint64_t opaque = RenderQueue::MakeKey(RenderQueue::Pass::Opaque, &shaders[1], &textures[1], &meshes[1], 100000.0f);
+	REQUIRE(opaque < near);
+	REQUIRE(RenderQueue::GetPass(opaque) == RenderQueue::Pass::Opaque);
+	REQUIRE(RenderQueue::GetPass(near) == RenderQueue::Pass::Translucent);
+}
+
+TEST_CASE("Render queue groups items by pass")
+{
+	RenderQueue queue;
+	int start = -1;
+	int end = -1;
+	queue.GetPassRange(RenderQueue::Pass::Opaque, start, end);
+	REQUIRE(start == end);
+	
+	// Add items out of order. Submesh index tracks the order they were added in.
+	float depths[] = { 30.0f, 10.0f, 20.0f };
+	for(int i = 0; i < 3; ++i)
+	{
+		queue.Add(RenderQueue::MakeKey(RenderQueue::Pass::Translucent, &shaders[0], &textures[0], &meshes[0], depths[i])).submeshIndex = i;
+		queue.Add(RenderQueue::MakeKey(RenderQueue::Pass::Opaque, &shaders[0], &textures[0], &meshes[0], depths[i])).submeshIndex = i;
+	}
+	
+	// Identical keys stay in the order they were added.
+	queue.Add(RenderQueue::MakeKey(RenderQueue::Pass::Opaque, &shaders[0], &textures[0], &meshes[0], 10.0f)).submeshIndex = 3;
+	queue.Sort();
+	
+	const std::vector<RenderQueue::Item>& items = queue.GetItems();
+	queue.GetPassRange(RenderQueue::Pass::Opaque, start, end);
+	REQUIRE(start == 0);
+	REQUIRE(end == 4);
+	REQUIRE(items[0].submeshIndex == 1);
+	REQUIRE(items[1].submeshIndex == 3);
+	REQUIRE(items[2].submeshIndex == 2);
+	REQUIRE(items[3].submeshIndex == 0);
+	
+	queue.GetPassRange(RenderQueue::Pass::Translucent, start, end);
+	REQUIRE(start == 4);
+	REQUIRE(end == 7);
+	REQUIRE(items[4].submeshIndex == 0);
+	REQUIRE(items[5].submeshIndex == 2);
+	REQUIRE(items[6].submeshIndex == 1);
+}
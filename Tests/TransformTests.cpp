@@ -0,0 +1,45 @@
+//
+// TransformTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for the Transform class.
+//
+#include "catch.hh"
+#include "Transform.h"
+
+#include "Actor.h"
+#include "GMath.h"
+
+// The test target doesn't build Actor (it pulls in the whole engine), but Component needs this one function.
+bool Actor::IsActive() const { return true; }
+
+TEST_CASE("Setting world rotation marks transform and children dirty")
+{
+	Transform parent(nullptr);
+	Transform child(nullptr);
+	child.SetParent(&parent);
+	child.SetPosition(Vector3(0.0f, 0.0f, 10.0f));
+
+	// Cache matrices before changing rotation.
+	REQUIRE(parent.GetLocalToWorldMatrix().TransformPoint(Vector3::UnitZ) == Vector3::UnitZ);
+	REQUIRE(child.GetWorldPosition() == Vector3(0.0f, 0.0f, 10.0f));
+	uint32_t parentChangeCount = parent.GetChangeCount();
+	uint32_t childChangeCount = child.GetChangeCount();
+
+	// Cached matrices must be rebuilt with the new rotation, for this transform and its children.
+	parent.SetWorldRotation(Quaternion(Vector3::UnitY, Math::kPiOver2));
+	REQUIRE(parent.GetChangeCount() != parentChangeCount);
+	REQUIRE(child.GetChangeCount() != childChangeCount);
+	REQUIRE(parent.GetLocalToWorldMatrix().TransformPoint(Vector3::UnitZ) == Vector3::UnitX);
+	REQUIRE(child.GetWorldPosition() == Vector3(10.0f, 0.0f, 0.0f));
+
+	// Rotating in world space goes through SetWorldRotation too.
+	childChangeCount = child.GetChangeCount();
+	child.Rotate(Vector3::UnitY, Math::kPiOver2, Transform::Space::World);
+	REQUIRE(child.GetChangeCount() != childChangeCount);
+	REQUIRE(child.GetLocalToWorldMatrix().TransformPoint(Vector3::Zero) == Vector3(10.0f, 0.0f, 0.0f));
+	REQUIRE(child.GetLocalToWorldMatrix().TransformPoint(Vector3::UnitZ) == Vector3(10.0f, 0.0f, -1.0f));
+
+	child.SetParent(nullptr);
+}
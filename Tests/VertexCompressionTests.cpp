@@ -0,0 +1,114 @@
+//
+// VertexCompressionTests.cpp
+//
+// Clark Kromenaker
+//
+// Tests for compact vertex formats.
+//
+#include "catch.hh"
+#include "VertexCompression.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+TEST_CASE("Half float conversion round trips")
+{
+	// Values that are exactly representable should survive unchanged.
+	for(float value : { 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 2.0f, 1024.0f, 65504.0f, 0.25f, -3.5f, 6.103515625e-05f, 5.9604644775390625e-08f })
+	{
+		REQUIRE(VertexCompression::HalfToFloat(VertexCompression::FloatToHalf(value)) == value);
+	}
+	
+	// Known bit patterns.
+	REQUIRE(VertexCompression::FloatToHalf(1.0f) == 0x3C00);
+	REQUIRE(VertexCompression::FloatToHalf(-2.0f) == 0xC000);
+	REQUIRE(VertexCompression::FloatToHalf(65504.0f) == 0x7BFF);
+	
+	// Too big becomes infinity, and infinity stays infinity.
+	REQUIRE(VertexCompression::FloatToHalf(100000.0f) == 0x7C00);
+	REQUIRE(VertexCompression::FloatToHalf(-INFINITY) == 0xFC00);
+	REQUIRE(std::isnan(VertexCompression::HalfToFloat(VertexCompression::FloatToHalf(NAN))));
+	
+	// Other values round to nearest. Relative error is at most half a unit in the last place (2^-11).
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> distribution(-4.0f, 4.0f);
+	for(int i = 0; i < 1000; ++i)
+	{
+		float value = distribution(generator);
+		float result = VertexCompression::HalfToFloat(VertexCompression::FloatToHalf(value));
+		REQUIRE(std::fabs(result - value) <= std::fabs(value) / 2048.0f + 1e-7f);
+	}
+}
+
+TEST_CASE("Normalized 16-bit conversion clamps and rounds")
+{
+	REQUIRE(VertexCompression::FloatToUnorm16(0.0f) == 0);
+	REQUIRE(VertexCompression::FloatToUnorm16(1.0f) == 65535);
+	REQUIRE(VertexCompression::FloatToUnorm16(2.0f) == 65535);
+	REQUIRE(VertexCompression::FloatToUnorm16(-1.0f) == 0);
+	REQUIRE(VertexCompression::FloatToSnorm16(1.0f) == 32767);
+	REQUIRE(VertexCompression::FloatToSnorm16(-1.0f) == -32767);
+	REQUIRE(VertexCompression::FloatToSnorm16(0.0f) == 0);
+	REQUIRE(VertexCompression::FloatToSnorm16(-5.0f) == -32767);
+}
+
+TEST_CASE("Octahedral normals round trip")
+{
+	// Axes, including the folded lower half.
+	for(const Vector3& normal : { Vector3::UnitX, -Vector3::UnitX, Vector3::UnitY, -Vector3::UnitY, Vector3::UnitZ, -Vector3::UnitZ })
+	{
+		Vector3 decoded = VertexCompression::DecodeOctahedral(VertexCompression::EncodeOctahedral(normal));
+		REQUIRE(Vector3::Dot(decoded, normal) > 0.9999f);
+	}
+	
+	// Random directions, encoded at 16-bit precision like the GPU sees them.
+	std::mt19937 generator(5678);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	for(int i = 0; i < 1000; ++i)
+	{
+		Vector3 normal(distribution(generator), distribution(generator), distribution(generator));
+		if(normal.GetLengthSq() < 0.01f) { continue; }
+		normal.Normalize();
+		
+		Vector2 encoded = VertexCompression::EncodeOctahedral(normal);
+		REQUIRE(std::fabs(encoded.x) <= 1.0f);
+		REQUIRE(std::fabs(encoded.y) <= 1.0f);
+		
+		Vector2 quantized(VertexCompression::FloatToSnorm16(encoded.x) / 32767.0f, VertexCompression::FloatToSnorm16(encoded.y) / 32767.0f);
+		Vector3 decoded = VertexCompression::DecodeOctahedral(quantized);
+		REQUIRE(Vector3::Dot(decoded, normal) > 0.99999f);
+	}
+}
+
+TEST_CASE("Encoding attributes writes compact data at stride")
+{
+	// Two normals encoded into an interleaved buffer with 8-byte stride. Bytes between vertices are left alone.
+	float normals[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -1.0f };
+	uint8_t output[16];
+	memset(output, 0xAB, sizeof(output));
+	VertexCompression::EncodeAttribute(VertexAttribute::NormalOctahedral, normals, 2, output, 8);
+	
+	int16_t encoded[2];
+	memcpy(encoded, output, sizeof(encoded));
+	REQUIRE(encoded[0] == 0);
+	REQUIRE(encoded[1] == 0);
+	memcpy(encoded, output + 8, sizeof(encoded));
+	REQUIRE(std::abs(encoded[0]) == 32767);
+	REQUIRE(std::abs(encoded[1]) == 32767);
+	REQUIRE(output[4] == 0xAB);
+	REQUIRE(output[15] == 0xAB);
+	
+	// Positions padded to four components get a zero fourth component.
+	float positions[] = { 0.0f, 0.5f, 1.0f };
+	uint16_t quantized[4];
+	VertexCompression::EncodeAttribute(VertexAttribute::PositionQuantized, positions, 1, reinterpret_cast<uint8_t*>(quantized), 8);
+	REQUIRE(quantized[0] == 0);
+	REQUIRE(quantized[1] == 32768);
+	REQUIRE(quantized[2] == 65535);
+	REQUIRE(quantized[3] == 0);
+	
+	REQUIRE(VertexCompression::IsInRange(positions, 3, 0.0f, 1.0f));
+	REQUIRE(!VertexCompression::IsInRange(positions, 3, 0.0f, 0.75f));
+}